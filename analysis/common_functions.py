@@ -19,6 +19,13 @@ from numba import njit, prange
 import numpy as np
 import glob
 import h5py, re
+import json
+import sys
+
+# the binary column readers are shared with the slurm scripts
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                "..", "g4chargeit", "slurm-scripts"))
+from shared_utils import column_directory, read_columnfile, columns_to_dataframe
 
 def load_h5_to_dict(filename):
     data_dict = {}
@@ -56,6 +63,14 @@ def read_rootfile(file, directory_path=None, columns=None):
     file_path = f"{directory_path}/{file}" if directory_path else file
     tree_name = "Hit Data"
 
+    # Binary column output is read directly when present
+    binary_dir = column_directory(file_path)
+    if binary_dir is not None:
+        df = columns_to_dataframe(read_columnfile(binary_dir, columns))
+        if 'Kinetic_Energy_Pre_MeV' in df.columns and 'Kinetic_Energy_Post_MeV' in df.columns:
+            df['Kinetic_Energy_Diff_eV'] = (df['Kinetic_Energy_Pre_MeV'] - df['Kinetic_Energy_Post_MeV']) * 1e6
+        return df
+
     with uproot.open(file_path) as root_file:
         tree = root_file[tree_name]
 
@@ -31,6 +31,7 @@
 #include "G4Types.hh"
 #include "G4MTRunManager.hh"
 #include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
 
 #include "G4UImanager.hh"
 #include "G4UIExecutive.hh"
@@ -39,11 +40,14 @@
 
 #include "DetectorConstruction.hh"
 #include "ActionInitialization.hh"
+#include "ThreadCoordinator.hh"
 
 #include "G4PhysListFactory.hh"
 #include "G4VModularPhysicsList.hh"
 #include "G4ParticleHPManager.hh"
-#include "G4PeriodicBoundaryPhysics.hh"
+#include "WorldPeriodicBoundaryProcess.hh"
+#include "TrappedElectronProcess.hh"
+#include "LooperWatchdogProcess.hh"
 
 #include "G4EmStandardPhysics_option4.hh"
 #include "G4EmStandardPhysicsSS.hh"
@@ -65,6 +69,9 @@
 
 #include <omp.h>
 
+#include <algorithm>
+#include <cstdlib>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 int main(int argc,char** argv) {
@@ -88,8 +95,19 @@ int main(int argc,char** argv) {
       G4cout << "OpenMP is NOT enabled" << G4endl;
   #endif
 
-  /// construct the default run manager
-  G4RunManager* runManager = new G4RunManager;
+  /// construct the run manager: sequential by default, multithreaded
+  /// (MT or tasking, see G4RUN_MANAGER_TYPE) when a thread count is given
+  /// as second argument, e.g. "g4chargeit run.mac 24"
+  G4int nThreads = (argc > 2) ? std::max(1, std::atoi(argv[2])) : 1;
+  auto runManagerType = (nThreads > 1) ? G4RunManagerType::Default : G4RunManagerType::Serial;
+  G4RunManager* runManager = G4RunManagerFactory::CreateRunManager(runManagerType);
+  if (nThreads > 1) {
+    runManager->SetNumberOfThreads(nThreads);
+    G4cout << "Event processing on " << nThreads << " worker threads" << G4endl;
+  }
+
+  /// OpenMP (field map) and the workers (tracking) take turns on the cores
+  ThreadCoordinator::GetInstance()->SetCores(std::max(nThreads, omp_get_max_threads()), nThreads);
 
   /// set mandatory initialization classes
   DetectorConstruction* det= new DetectorConstruction;
@@ -105,11 +123,17 @@ int main(int argc,char** argv) {
   emParams->SetAuger(true);  // Enable Auger electrons
   emParams->SetPixe(true);   // Enable PIXE
 
-  // Add periodic boundary conditions
-  G4PeriodicBoundaryPhysics* pbc = new G4PeriodicBoundaryPhysics("PBC", true, true, false); // Turn off pbc in Z direction
+  // Add periodic boundary conditions, invoked only for steps in the world volume
+  WorldPeriodicBoundaryPhysics* pbc = new WorldPeriodicBoundaryPhysics("PBC", true, true, false); // Turn off pbc in Z direction
   pbc->SetVerboseLevel(0);
   physList->RegisterPhysics(pbc);
 
+  // early stop of electrons that cannot leave their grain (/charging/trapElectrons)
+  physList->RegisterPhysics(new TrappedElectronPhysics());
+
+  // stop of charged tracks looping between the charged grains (/looper/)
+  physList->RegisterPhysics(new LooperWatchdogPhysics());
+
   runManager->SetUserInitialization(physList);
   runManager->SetUserInitialization(new ActionInitialization());
 
@@ -146,6 +170,7 @@ int main(int argc,char** argv) {
   }
 
   // job termination
+  ThreadCoordinator::GetInstance()->PrintReport();
   delete visManager;
   delete runManager;
 
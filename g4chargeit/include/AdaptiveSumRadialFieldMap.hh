@@ -9,6 +9,7 @@
 #include "G4VSolid.hh"
 
 #include <vector>
+#include <utility>             // For std::pair
 #include <string>
 #include <memory>              // For std::unique_ptr
 #include <fstream>             // For std::ofstream
@@ -40,7 +41,8 @@ public:
         int max_depth_default = 10,
         int initial_depth_default = 5,
         bool dissipateCharge_default = true,
-        StorageType storage = StorageType::Double
+        StorageType storage = StorageType::Double,
+        bool periodicXY = false
     );
 
     ~AdaptiveSumRadialFieldMap() override;
@@ -51,6 +53,17 @@ public:
     void SaveFinalParticleState(const std::string& filename) const;
     void PrintMeshStatistics() const;
     G4ThreeVector evaluateField(const G4ThreeVector& point) const;
+    // Final leaf containing the point: its constant field and bounds (false outside the map)
+    bool GetLeaf(const G4ThreeVector& point, G4ThreeVector& field, G4ThreeVector& leafMin, G4ThreeVector& leafMax) const;
+    // Spread of the vacuum potential over the final leaf centres: the most
+    // energy a unit charge can gain or lose crossing the map
+    G4double GetPotentialRange() const { return potentialRange_; }
+    // Field lookups (GetFieldValue, GetLeaf) by the calling thread since the last call
+    static G4long TakeFieldCallCount();
+    // Re-apply the dielectric scaling of the final leaves for a new constant
+    void SetDielectricConstant(G4double dielectricConstant);
+    // Charges are summed with their periodic images in x and y (period = map size)
+    bool IsPeriodicXY() const { return periodicXY_; }
 
 
 private:
@@ -69,6 +82,23 @@ private:
         bool is_leaf = true;
     };
 
+    // Values on a grid that is uniform in x and y and uniform in
+    // t = asinh((z - zCenter)/zScale) along z, so it is fine around zCenter
+    // and coarse far from it; four values per node (Ex, Ey, Ez, V).
+    struct LatticeTable {
+        int nx = 0, ny = 0, nz = 0;
+        G4double x0 = 0, dx = 0, y0 = 0, dy = 0;
+        G4double zCenter = 0, zScale = 1, t0 = 0, dt = 0;
+        std::vector<G4double> values;
+
+        void Define(const G4ThreeVector& min, const G4ThreeVector& max, int cellsXY,
+                    G4double zCenter, G4double zScale, G4double tStep);
+        G4ThreeVector NodePosition(int i, int j, int k) const;
+        G4double* Node(int i, int j, int k) { return &values[4*((std::size_t(k)*ny + j)*nx + i)]; }
+        // trilinear interpolation, clamped to the grid
+        void Interpolate(const G4ThreeVector& p, G4double out[4]) const;
+    };
+
     int max_depth_;
     G4double minStepSize_;
     G4ThreeVector worldMin_;
@@ -80,6 +110,21 @@ private:
     bool dissipateCharge_;
     G4VSolid* geometry_;
     G4double dielectricConstant_;
+    G4double potentialRange_ = 0.0;
+    static G4ThreadLocal G4long fieldCalls_;
+
+    // 2D-periodic summation: the cell is cut into columns in x and y; the
+    // charges of the 3x3 columns around the point (periodically wrapped) go
+    // through the Barnes-Hut walk, all other charges and images are a smooth
+    // correction looked up in the table of the point's column (see
+    // buildLatticeCorrection)
+    bool periodicXY_;
+    struct ColumnNode {
+        const ChargeNode* node;
+        G4ThreeVector min, max;
+    };
+    std::vector<std::vector<ColumnNode>> columnNodes_;
+    std::vector<LatticeTable> columnCorrection_;
 
     std::vector<G4ThreeVector>& fPositions;
     std::vector<G4double>& fCharges;
@@ -117,6 +162,15 @@ private:
     void insertCharge(ChargeNode* node, int particle_index, const G4ThreeVector& min_bounds, const G4ThreeVector& max_bounds);
     G4ThreeVector computeFieldWithApproximation(const G4ThreeVector& point, const ChargeNode* node, const G4ThreeVector& node_min, const G4ThreeVector& node_max) const;
     G4ThreeVector computeFieldFromCharges(const G4ThreeVector& point) const;
+    G4double computePotentialWithApproximation(const G4ThreeVector& point, const ChargeNode* node, const G4ThreeVector& node_min, const G4ThreeVector& node_max) const;
+    G4double computePotentialFromCharges(const G4ThreeVector& point) const;
+    void buildLatticeCorrection();
+    void collectColumnNodes(const ChargeNode* node, const G4ThreeVector& node_min, const G4ThreeVector& node_max, int depth);
+    int columnOf(const G4ThreeVector& point) const;
+    // walks the 3x3 columns around 'column' (near) or all other columns of the cell and its eight neighbour images
+    void sumColumnImages(const G4ThreeVector& point, int column, bool near, G4ThreeVector* field, G4double* potential) const;
+    void collectLatticeSources(const ChargeNode* node, const G4ThreeVector& node_min, const G4ThreeVector& node_max,
+                               G4double max_extent, std::vector<std::pair<G4ThreeVector, G4double>>& sources) const;
     void buildUniformGrid(Node* node, int depth);
     Node* findLeafNode(const G4ThreeVector& point, Node* node) const; // <-- Add this
     void ApplyChargeDissipation(G4double dt, G4double temp_K);
@@ -0,0 +1,171 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file BVHTessellatedSolid.hh
+/// \brief Definition of the BVHTessellatedSolid class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef BVHTessellatedSolid_h
+#define BVHTessellatedSolid_h 1
+
+#include "G4VSolid.hh"
+#include "FastSTLReader.hh"
+
+#include <array>
+#include <vector>
+
+/// Closed triangle mesh solid navigated through a bounding volume hierarchy.
+/** An alternative to G4TessellatedSolid for large grain meshes
+ * (/geometry/cadinput/solid bvh). The facets are sorted into a binned
+ * surface-area-heuristic BVH, so ray and distance queries visit O(log n)
+ * nodes instead of depending on the voxel grid of G4TessellatedSolid.
+ *
+ * Facet data is stored as structure of arrays and leaves hold at most
+ * kLeafSize facets, which are intersected together in one loop that the
+ * compiler vectorises (-march=native, omp simd).
+ *
+ *  - Inside: kSurface within kCarTolerance/2 of a facet, otherwise the parity
+ *    of ray crossings, re-cast along another direction when a ray grazes an
+ *    edge or lies in a facet plane.
+ *  - DistanceToIn/Out(p,v): nearest entering/leaving facet along v.
+ *  - DistanceToIn/Out(p): distance to the nearest facet, or a lower bound
+ *    on it from the unvisited nodes when that search gets long.
+ *
+ * The mesh must be closed and consistently oriented (outward normals by the
+ * right-hand rule), as for G4TessellatedSolid. All queries are const and
+ * use no mutable state, so one instance is shared by all worker threads.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class BVHTessellatedSolid : public G4VSolid
+{
+  public:
+
+    static constexpr G4int kLeafSize = 4;
+
+    /// Build the solid from an indexed mesh, vertices multiplied by scale.
+    BVHTessellatedSolid(const G4String& name, const TriangleMesh& mesh, G4double scale = 1.);
+    BVHTessellatedSolid(const BVHTessellatedSolid& other) = default;
+   ~BVHTessellatedSolid() override = default;
+
+    EInside Inside(const G4ThreeVector& p) const override;
+    G4ThreeVector SurfaceNormal(const G4ThreeVector& p) const override;
+    G4double DistanceToIn(const G4ThreeVector& p, const G4ThreeVector& v) const override;
+    G4double DistanceToIn(const G4ThreeVector& p) const override;
+    G4double DistanceToOut(const G4ThreeVector& p, const G4ThreeVector& v,
+                           const G4bool calcNorm = false, G4bool* validNorm = nullptr,
+                           G4ThreeVector* n = nullptr) const override;
+    G4double DistanceToOut(const G4ThreeVector& p) const override;
+
+    void BoundingLimits(G4ThreeVector& pMin, G4ThreeVector& pMax) const override;
+    G4bool CalculateExtent(const EAxis pAxis, const G4VoxelLimits& pVoxelLimit,
+                           const G4AffineTransform& pTransform,
+                           G4double& pMin, G4double& pMax) const override;
+
+    G4double GetCubicVolume() override { return cubicVolume_; }
+    G4double GetSurfaceArea() override { return surfaceArea_; }
+    G4ThreeVector GetPointOnSurface() const override;
+
+    G4GeometryType GetEntityType() const override { return "BVHTessellatedSolid"; }
+    G4VSolid* Clone() const override { return new BVHTessellatedSolid(*this); }
+    std::ostream& StreamInfo(std::ostream& os) const override;
+
+    void DescribeYourselfTo(G4VGraphicsScene& scene) const override;
+    G4Polyhedron* CreatePolyhedron() const override;
+
+    std::size_t GetNumberOfFacets() const { return area2_.size(); }
+    std::size_t GetNumberOfNodes() const { return nodes_.size(); }
+
+  private:
+
+    /// Inner nodes (count == 0) have their children at first and first + 1,
+    /// leaves hold the facets first ... first + count - 1.
+    struct Node
+    {
+        G4double lo[3];
+        G4double hi[3];
+        G4int first = 0;
+        G4int count = 0;
+    };
+
+    /// Ray/facet results of one leaf block.
+    struct Lanes
+    {
+        G4double t[kLeafSize];
+        G4double det[kLeafSize];
+        G4double u[kLeafSize];
+        G4double w[kLeafSize];
+    };
+
+    void Build(std::vector<std::array<G4ThreeVector, 3>>& corners);
+    void Subdivide(G4int node, G4int first, G4int count, G4int depth,
+                   std::vector<G4int>& order, const std::vector<Node>& boxes,
+                   const std::vector<G4ThreeVector>& centroids);
+
+    void IntersectLeaf(G4int first, G4int n, const G4double o[3], const G4double d[3],
+                       Lanes& lanes) const;
+    /// Nearest facet crossed along p + t v, t > tMin; sense -1 keeps only
+    /// entering facets, +1 only leaving ones. Returns kInfinity and
+    /// facet = -1 when nothing is hit.
+    G4double Intersect(const G4ThreeVector& p, const G4ThreeVector& v, G4int sense,
+                       G4double tMin, G4int& facet) const;
+    /// Number of facets crossed by the ray from p along v.
+    G4int CountCrossings(const G4ThreeVector& p, const G4ThreeVector& v, G4bool& ambiguous) const;
+    /// Distance to the nearest facet closer than maxDistance (else maxDistance,
+    /// facet = -1). With maxLeaves > 0 the search stops after that many leaves
+    /// and returns a lower bound, which is all a safety needs.
+    G4double ClosestFacet(const G4ThreeVector& p, G4double maxDistance, G4int& facet,
+                          G4int maxLeaves = 0) const;
+    G4double DistanceToFacet2(const G4ThreeVector& p, G4int i) const;
+
+    G4ThreeVector Normal(G4int i) const { return {n_[0][i], n_[1][i], n_[2][i]}; }
+
+    // facets in BVH order, structure of arrays: first vertex, the two edges
+    // from it, unit outward normal and twice the area
+    std::vector<G4double> p0_[3];
+    std::vector<G4double> e1_[3];
+    std::vector<G4double> e2_[3];
+    std::vector<G4double> n_[3];
+    std::vector<G4double> area2_;
+    std::vector<G4double> cumulativeArea_;
+
+    std::vector<Node> nodes_;
+    G4int depth_;
+
+    // indexed mesh kept for visualisation
+    std::vector<G4ThreeVector> vertices_;
+    std::vector<std::array<G4int, 3>> triangles_;
+
+    G4double cubicVolume_;
+    G4double surfaceArea_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
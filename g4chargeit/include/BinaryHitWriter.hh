@@ -0,0 +1,97 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file BinaryHitWriter.hh
+/// \brief Definition of the BinaryHitWriter class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef BinaryHitWriter_h
+#define BinaryHitWriter_h 1
+
+#include "HitOutputWriter.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Native binary column output, an alternative to the ROOT ntuple.
+/** Every entry of kHitColumns is written to its own file <name>.bin inside
+ * an output directory, as fixed-width little-endian values with no framing:
+ * int32 for integers, float64 for doubles, three float64 per hit for the
+ * position vectors and NUL-padded char[kStringWidth] for strings. Close()
+ * writes header.json with the row count and a numpy dtype/shape for every
+ * column, so each file can be opened with numpy.memmap without parsing.
+ *
+ * In multithreaded runs every worker writes its own part directory
+ * (ThreadDirectoryFor) and the master concatenates the parts with Merge at
+ * the end of the run; the columns have no framing, so this is a plain append.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class BinaryHitWriter
+{
+  public:
+
+    static const G4int kStringWidth = 32;
+
+    BinaryHitWriter();
+   ~BinaryHitWriter();
+
+    /// Create the output directory and open one file per column.
+    void Open(const std::string& directory);
+    /// Append a batch of hits to the column files.
+    void Write(const HitBatch& batch);
+    /// Close the column files and write header.json.
+    void Close();
+
+    G4bool IsOpen() const { return !files_.empty(); }
+
+    /// Output directory used for a ROOT file name ("x.root" -> "x.cols").
+    static std::string DirectoryFor(const std::string& rootFileName);
+    /// Part directory of a worker thread ("x.root" -> "x_t<id>.cols").
+    static std::string ThreadDirectoryFor(const std::string& rootFileName, G4int threadId);
+    /// Concatenate part directories into one output directory and remove them.
+    static void Merge(const std::vector<std::string>& parts, const std::string& directory);
+    /// numpy dtype string of a column, e.g. "<f8".
+    static std::string DType(HitColumnType type);
+
+  private:
+
+    void WriteHeader() const;
+
+    std::string directory_;
+    std::vector<std::ofstream> files_;
+    std::vector<char> scratch_;
+    uint64_t rows_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,116 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ChargeCollector.hh
+/// \brief Definition of the ChargeCollector class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ChargeCollector_h
+#define ChargeCollector_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class SensitiveDetectorHit;
+
+/// In-memory collection of the charges deposited during a run.
+/** Used by /charging/iterate instead of writing the hits to a file and
+ * reading them back in the next job. At the end of every event the SD
+ * hands its hits to AddEvent, which applies the same selection as the ROOT
+ * input of DetectorConstruction: electrons and protons stopped in SiO2 at
+ * their post step position, and a hole at the birth position of every
+ * electron whose parent is a primary (PrimarySourceTable::IsPrimaryTrack).
+ *
+ * It also counts the events of the reference particle with the rule used by
+ * get_particle_counts_by_type in the slurm scripts, from which the iteration
+ * time is derived: for gamma the events whose last electron hit leaves the
+ * periodic world, for any other particle the events whose primary reaches
+ * SiO2. The count is per event, so it assumes one primary per event.
+ * Charges and reference events carry the statistical weight of their track,
+ * so biased primary energies (PrimarySourceTable) keep both unbiased.
+ * AddEvent can be called from all worker threads at once.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class ChargeCollector
+{
+  public:
+
+    /// Get instance of the collector
+    static ChargeCollector* GetInstance();
+
+    /// Collection is off unless an iteration loop is running.
+    void SetEnabled(G4bool value) { enabled_ = value; };
+    G4bool IsEnabled() const { return enabled_; };
+
+    void SetReferenceParticle(const G4String& value) { referenceParticle_ = value; };
+    const G4String& GetReferenceParticle() const { return referenceParticle_; };
+
+    /// Select the charges and reference count of one event (thread safe).
+    void AddEvent(const std::vector<SensitiveDetectorHit*>& hits);
+
+    /// Move the collected charges and their weights out and start from empty.
+    void Take(std::vector<G4ThreeVector>& electrons,
+              std::vector<G4ThreeVector>& protons,
+              std::vector<G4ThreeVector>& holes,
+              std::vector<G4double>& electronWeights,
+              std::vector<G4double>& protonWeights,
+              std::vector<G4double>& holeWeights);
+
+    /// Summed weights of the reference events (their number without biasing).
+    G4double GetReferenceCount() const { return referenceCount_; };
+    void Reset();
+
+  private:
+
+    ChargeCollector();
+   ~ChargeCollector() {};
+
+    static ChargeCollector* singletonInstance_;
+
+    std::atomic<G4bool> enabled_;
+    G4String referenceParticle_;
+
+    std::mutex mutex_;
+    std::vector<G4ThreeVector> electrons_;
+    std::vector<G4ThreeVector> protons_;
+    std::vector<G4ThreeVector> holes_;
+    std::vector<G4double> electronWeights_;
+    std::vector<G4double> protonWeights_;
+    std::vector<G4double> holeWeights_;
+    G4double referenceCount_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
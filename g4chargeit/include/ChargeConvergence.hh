@@ -0,0 +1,92 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ChargeConvergence.hh
+/// \brief Definition of the ChargeConvergence class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ChargeConvergence_h
+#define ChargeConvergence_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Statistical uncertainty of the charges of an iteration run in chunks.
+/** Every chunk of equal size is an independent sample of the deposit, so
+ * the spread of the chunks gives the uncertainty of their sum (batch
+ * means). Two measures are kept:
+ *  - "charge": the net charge per cell of a regular grid over the world;
+ *    the error is the norm of the cell uncertainties over the norm of the
+ *    cell charges, so empty and nearly empty cells do not dominate it;
+ *  - "field": the Coulomb field of the charges at probe points, without
+ *    the dielectric and periodic images, which scale both alike; the error
+ *    is the norm of the probe uncertainties over the norm of the fields.
+ * Both are infinite until enough chunks give a spread.
+ */
+
+class ChargeConvergence
+{
+  public:
+
+    ChargeConvergence(const G4ThreeVector& min, const G4ThreeVector& max, G4int cells,
+                      const std::vector<G4ThreeVector>& probes);
+
+    /// Add the charges (in elementary charges) of one chunk.
+    void AddChunk(const std::vector<G4ThreeVector>& positions,
+                  const std::vector<G4double>& charges);
+
+    G4int GetChunks() const { return chunks_; }
+    G4double ChargeError() const;
+    G4double FieldError() const;
+
+  private:
+
+    // relative error of the sum of the chunks from per-bin sums
+    G4double RelativeError(const std::vector<G4double>& sum,
+                           const std::vector<G4double>& sumSquares) const;
+
+    G4ThreeVector min_;
+    G4ThreeVector cellSize_;
+    G4int cells_;
+    std::vector<G4ThreeVector> probes_;
+    G4int chunks_;
+    // sums over the chunks of the value of every cell (probe component)
+    // and of its square
+    std::vector<G4double> charge_;
+    std::vector<G4double> chargeSquares_;
+    std::vector<G4double> field_;
+    std::vector<G4double> fieldSquares_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
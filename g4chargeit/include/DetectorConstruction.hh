@@ -44,6 +44,9 @@ class G4LogicalVolume;
 class DetectorMessenger;
 class G4VPhysicalVolume;
 class G4VSolid;
+class G4EqMagElectricField;
+class G4ChordFinder;
+class TrackFieldManager;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -65,27 +68,109 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     void SetChargesFile (G4String);
     void SetRootInput (G4String);
     void SetCADScale (G4double);
+    void SetCADCache (G4bool);
+    void SetCADSolid (G4String);
+    void SetCADSplit (G4bool);
+    void SetSpheresFile (G4String);
     void SetFieldFile (G4String);
     void SetWorldX (G4double);
     void SetWorldY (G4double);
     void SetWorldZ (G4double);
     void SetFieldMinimumStep (G4double);
     void SetFieldGradThreshold (G4double);
+    void SetFieldStepper (G4String);
+    void SetFieldDriver (G4String);
+    void SetFieldDeltaOneStep (G4double);
+    void SetFieldMinEpsilon (G4double);
+    void SetFieldMaxEpsilon (G4double);
+    void SetFieldDeltaChord (G4double);
+    void SetFieldDriverMinimumStep (G4double);
+    void SetGrainFieldPolicy (G4String);
+    const G4String& GetFieldStepper() const { return fieldStepper_; }
+    const G4String& GetFieldDriver() const { return fieldDriver_; }
+    void SetFieldBypassRatio (G4double);
+    void SetFieldRelaxRatio (G4double);
     void SetOctreeMaxDepth (G4double);
     void SetInitialDepth (G4double);
     void SetMaterialTemperature (G4double);
     void SetEquivalentIterationTime (G4double);
     void SetMaterialDensity(G4double);
     void SetChargeDissipationModel(G4bool);
+    void SetEventsPerIteration(G4int);
+    void SetChargingFlux(G4double);
+    // convergence-driven iterations (see BeamOnConverged)
+    void SetTargetError(G4double value) { targetError_ = value; }
+    void SetMaxEventsPerIteration(G4int value) { maxEventsPerIteration_ = value; }
+    void SetConvergenceMeasure(const G4String& value) { convergenceMeasure_ = value; }
+    void SetConvergenceCells(G4int value) { convergenceCells_ = value; }
+    void AddProbe(const G4ThreeVector& point) { probes_.push_back(point); }
+    void ClearProbes() { probes_.clear(); }
+
+    /// Run iterations in this process, rebuilding the field map in between.
+    void Iterate(G4int iterations);
+    /// Point this thread's field manager at the current field map.
+    void UpdateThreadField();
+    /// Redo the stages invalidated since the last run (master, before a run).
+    void UpdateStages();
                        
   private:
+    // construction stages a setter can invalidate; geometry changes go
+    // through ReinitializeGeometry, the others are redone by UpdateStages
+    enum Stage {
+      kGeometry   = 1 << 0,  // volumes, materials, CAD solid
+      kCharges    = 1 << 1,  // charges read from the ROOT input
+      kFieldMap   = 1 << 2,  // field map precomputation
+      kDielectric = 1 << 3   // dielectric scaling of the map leaves only
+    };
+    void MarkDirty(G4int stages);
+
     G4VPhysicalVolume* ConstructVolumes();  
+    // read the stopped charges of the ROOT input files
+    void LoadCharges();
+    // analytic sphere pack: one G4Orb per radius, one position per sphere
+    void LoadSpheres(const G4String& path, std::vector<G4VSolid*>& solids,
+                     std::vector<G4ThreeVector>& positions);
+    G4bool SpheresOverlap() const;
+    // build the shared field map from the collected charges (master only)
+    void BuildFieldMap();
+    // chord finder of this thread's equation for the selected stepper and driver
+    G4ChordFinder* CreateChordFinder() const;
+    // read stopped charges from binary hit columns (see BinaryHitWriter)
+    void LoadBinaryCharges(const std::string& directory);
+    // per-iteration file name ("x.root", 2 -> "x_it002.root")
+    static G4String IterationFileName(const G4String& name, G4int iteration);
+    // per-chunk file name ("x.root", 2 -> "x_c002.root")
+    static G4String ChunkFileName(const G4String& name, G4int chunk);
+    // run chunks of /charging/events until the charges of the iteration reach
+    // the target error; returns the events run, the outputs and the error
+    G4int BeamOnConverged(const G4String& output, G4bool keepCharges,
+                          std::vector<G4String>& outputs, G4double& error);
+    // charges file as it was before the current iteration's first build
+    void SnapshotChargesFile();
+    void RestoreChargesFile();
     G4bool boolPBC_;
     G4double worldX_;
     G4double worldY_;
     G4double worldZ_;
     G4double fieldMinimumStep_;
     G4double fieldGradThreshold_;
+    // charged-track integration (/field/Stepper, /field/Driver and the
+    // tolerances); fieldConfig_ counts their changes, so every thread
+    // rebuilds its chord finder once after a change
+    G4String fieldStepper_;
+    G4String fieldDriver_;
+    G4double fieldDeltaOneStep_;
+    G4double fieldMinEpsilon_;
+    G4double fieldMaxEpsilon_;
+    G4double fieldDeltaChord_;
+    G4double fieldDriverMinStep_;
+    G4int fieldConfig_;
+    // field inside the grains: "none" (field-free) or "map" (as in vacuum)
+    G4String grainFieldPolicy_;
+    // kinetic energy over the map's potential energy range above which a
+    // track ignores the field / gets relaxed accuracy (see TrackFieldManager)
+    G4double fieldBypassRatio_;
+    G4double fieldRelaxRatio_;
     G4LogicalVolume* logicWorld_; 
     G4double Epsilon_;
     G4String CADFile_;
@@ -93,8 +178,17 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4String charges_filename_;
     G4String filename_;
     G4double Scale_;
+    G4bool useMeshCache_;
+    G4String cadSolidType_;
+    G4bool splitGrains_;
+    G4String spheresFile_;
+    std::vector<std::pair<G4ThreeVector, G4double>> spheres_;  // center, radius
     G4double materialTemperature_;
     std::vector<G4ThreeVector> fHolePositions;
+    // statistical weights of the charges, 1 unless the source was biased
+    std::vector<G4double> fHoleWeights;
+    std::vector<G4double> fElectronWeights;
+    std::vector<G4double> fProtonWeights;
     std::vector<G4ThreeVector> fElectronPositions;
     std::vector<G4ThreeVector> fProtonPositions;
     DetectorMessenger* detectorMessenger_;
@@ -104,6 +198,33 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     G4double density_;
     G4bool boolDissipationModel_;
     G4VSolid* sphereSolid_;
+    // charges of the field map and the map itself, shared by all threads
+    std::vector<G4ThreeVector> allPositions_;
+    std::vector<G4double> allCharges_;
+    AdaptiveSumRadialFieldMap* fieldMap_;
+    G4int eventsPerIteration_;
+    G4int dirty_;
+    G4bool chargesSnapshotValid_;
+    G4bool chargesFileExisted_;
+    std::string chargesSnapshot_;
+    G4double chargingFlux_;
+    // relative error at which an iteration stops (0: a fixed event count),
+    // the event limit (0: 100 chunks), "charge" or "field", the cells per
+    // axis of the charge grid and the probe points of the field
+    G4double targetError_;
+    G4int maxEventsPerIteration_;
+    G4String convergenceMeasure_;
+    G4int convergenceCells_;
+    std::vector<G4ThreeVector> probes_;
+    // counts the builds of the volumes, for the source shadows
+    G4int geometryVersion_;
+    // field manager and equation of this thread (see UpdateThreadField)
+    static G4ThreadLocal TrackFieldManager* threadFieldManager_;
+    static G4ThreadLocal G4EqMagElectricField* threadEquation_;
+    static G4ThreadLocal const AdaptiveSumRadialFieldMap* threadFieldMap_;
+    static G4ThreadLocal G4int threadFieldConfig_;
+    // field manager without a field, for the grains (see UpdateThreadField)
+    static G4ThreadLocal G4FieldManager* threadFreeFieldManager_;
 
 };
 
@@ -44,6 +44,10 @@ class G4UIcmdWithADoubleAndUnit;
 class G4UIcmdWithADouble;
 class G4UIcmdWithAString;
 class G4UIcmdWithABool;
+class G4UIcmdWithAnInteger;
+class G4UIcmdWith3Vector;
+class G4UIcmdWith3VectorAndUnit;
+class G4UIcmdWithoutParameter;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -62,17 +66,36 @@ class DetectorMessenger: public G4UImessenger
     G4RootAnalysisManager*      rootManager_; 
     
     G4UIcmdWithAString*         fileNameCmd_;
+    G4UIcmdWithAString*         OutputFormatCmd_;
+    G4UIcmdWithABool*           AsyncOutputCmd_;
+    G4UIcmdWithAnInteger*       OutputBuffersCmd_;
+    G4UIcmdWithAnInteger*       OutputBatchRowsCmd_;
     G4UIcmdWithABool*           PBCCmd_;
     G4UIcmdWithABool*           ChargeDissipationModelCmd_;
     G4UIcmdWithADouble*         EpsilonCmd_;
     G4UIcmdWithAString*         RootInputCmd_;
     G4UIcmdWithAString*         CADFileCmd_;
     G4UIcmdWithADouble*         ScaleCmd_;
+    G4UIcmdWithABool*           CADCacheCmd_;
+    G4UIcmdWithAString*         CADSolidCmd_;
+    G4UIcmdWithABool*           CADSplitCmd_;
+    G4UIdirectory*              SpheresDir_;
+    G4UIcmdWithAString*         SpheresFileCmd_;
     G4UIcmdWithADoubleAndUnit*  WorldXCmd_;
     G4UIcmdWithADoubleAndUnit*  WorldYCmd_;
     G4UIcmdWithADoubleAndUnit*  WorldZCmd_;
     G4UIcmdWithADoubleAndUnit*  FieldMinimumStepCmd_;
     G4UIcmdWithADouble*         FieldGradThresholdCmd_;
+    G4UIcmdWithAString*         FieldStepperCmd_;
+    G4UIcmdWithAString*         FieldDriverCmd_;
+    G4UIcmdWithADoubleAndUnit*  FieldDeltaOneStepCmd_;
+    G4UIcmdWithADouble*         FieldMinEpsilonCmd_;
+    G4UIcmdWithADouble*         FieldMaxEpsilonCmd_;
+    G4UIcmdWithADoubleAndUnit*  FieldDeltaChordCmd_;
+    G4UIcmdWithADoubleAndUnit*  FieldDriverMinStepCmd_;
+    G4UIcmdWithAString*         FieldInsideGrainsCmd_;
+    G4UIcmdWithADouble*         FieldBypassRatioCmd_;
+    G4UIcmdWithADouble*         FieldRelaxRatioCmd_;
     G4UIcmdWithAString*         FieldFileCmd_;
     G4UIcmdWithAString*         ChargesFileCmd_;
     G4UIcmdWithADouble*         FieldOctreeDepthCmd_;
@@ -81,6 +104,56 @@ class DetectorMessenger: public G4UImessenger
     G4UIcmdWithADoubleAndUnit*  EquivalentIterationTimeCmd_;
     G4UIcmdWithADoubleAndUnit*  MaterialDensityCmd_;
 
+    G4UIdirectory*              ChargingDir_;
+    G4UIcmdWithAnInteger*       IterateCmd_;
+    G4UIcmdWithAnInteger*       EventsPerIterationCmd_;
+    G4UIcmdWithADouble*         ChargingFluxCmd_;
+    G4UIcmdWithAString*         ReferenceParticleCmd_;
+    G4UIcmdWithABool*           TrapElectronsCmd_;
+    G4UIcmdWithADoubleAndUnit*  TrapMaxEnergyCmd_;
+    G4UIcmdWithADouble*         TargetErrorCmd_;
+    G4UIcmdWithAnInteger*       MaxEventsCmd_;
+    G4UIcmdWithAString*         ConvergenceCmd_;
+    G4UIcmdWithAnInteger*       ConvergenceCellsCmd_;
+    G4UIcmdWith3VectorAndUnit*  ProbeCmd_;
+    G4UIcmdWithoutParameter*    ClearProbesCmd_;
+
+    G4UIdirectory*              SourceDir_;
+    G4UIcmdWithAString*         SourceGeneratorCmd_;
+    G4UIcmdWithAnInteger*       SourcePerEventCmd_;
+    G4UIcmdWithADouble*         SourceAddCmd_;
+    G4UIcmdWithADouble*         SourceIntensityCmd_;
+    G4UIcmdWithAString*         SourceParticleCmd_;
+    G4UIcmdWithAString*         SourceSpectrumCmd_;
+    G4UIcmdWithAString*         SourceInterpolationCmd_;
+    G4UIcmdWith3VectorAndUnit*  SourceCentreCmd_;
+    G4UIcmdWithADoubleAndUnit*  SourceHalfXCmd_;
+    G4UIcmdWithADoubleAndUnit*  SourceHalfYCmd_;
+    G4UIcmdWith3Vector*         SourceDirectionCmd_;
+    G4UIcmdWithADoubleAndUnit*  SourceIsotropicCmd_;
+    G4UIcmdWithADoubleAndUnit*  SourceMinEnergyCmd_;
+    G4UIcmdWithADoubleAndUnit*  SourceTailEnergyCmd_;
+    G4UIcmdWithADouble*         SourceTailFactorCmd_;
+    G4UIcmdWithABool*           SourceCullCmd_;
+    G4UIcmdWithAnInteger*       SourceCullCellsCmd_;
+    G4UIcmdWithAString*         SourceCacheCmd_;
+    G4UIcmdWithAString*         SourceCacheFileCmd_;
+
+    G4UIdirectory*              BiasingDir_;
+    G4UIcmdWithADoubleAndUnit*  BiasingSkinCmd_;
+    G4UIcmdWithADouble*         BiasingSkinFactorCmd_;
+
+    G4UIdirectory*              LooperDir_;
+    G4UIcmdWithAnInteger*       LooperMaxStepsCmd_;
+    G4UIcmdWithADoubleAndUnit*  LooperPathCmd_;
+    G4UIcmdWithADoubleAndUnit*  LooperDisplacementCmd_;
+    G4UIcmdWithADoubleAndUnit*  LooperVacuumTimeCmd_;
+    G4UIcmdWithAString*         LooperPolicyCmd_;
+
+    G4UIdirectory*              SurrogateDir_;
+    G4UIcmdWithAString*         SurrogateModeCmd_;
+    G4UIcmdWithAString*         SurrogateTableCmd_;
+
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,98 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ExactLeafStepper.hh
+/// \brief Definition of the ExactLeafStepper class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ExactLeafStepper_h
+#define ExactLeafStepper_h 1
+
+#include "G4MagIntegratorStepper.hh"
+#include "G4ThreeVector.hh"
+
+class AdaptiveSumRadialFieldMap;
+class G4EqMagElectricField;
+
+/// Analytic stepper for the piecewise-constant field of the octree field map.
+/** AdaptiveSumRadialFieldMap returns one constant electric field per final
+ * leaf, so inside a leaf a charged track follows an exact relativistic
+ * uniform-field trajectory: the momentum grows linearly in time and the
+ * position has a closed form. Stepper() follows that solution from leaf to
+ * leaf: it finds where the track leaves the current leaf, continues with the
+ * field of the next one, and stops after the requested path length h.
+ * A step therefore costs one leaf lookup per leaf crossed instead of seven
+ * field evaluations per Runge-Kutta stage set, and has no truncation error
+ * (yerr is zero), so the driver only shortens steps for the chord distance
+ * and the geometry.
+ *
+ * Used with /field/Stepper ExactLeaf. The field object of the equation must
+ * be the field map; outside the map the track moves on a straight line.
+ * Only electric fields are handled (G4EqMagElectricField, 8 variables).
+ */
+
+class ExactLeafStepper : public G4MagIntegratorStepper
+{
+  public:
+
+    explicit ExactLeafStepper(G4EqMagElectricField* equation, G4int nvar = 8);
+   ~ExactLeafStepper() override = default;
+
+    void Stepper(const G4double y[], const G4double dydx[], G4double h,
+                 G4double yout[], G4double yerr[]) override;
+    G4double DistChord() const override;
+    G4int IntegratorOrder() const override { return 4; }
+
+  private:
+
+    /// State of the track during a step: position, momentum, lab time.
+    struct State
+    {
+        G4ThreeVector position;
+        G4ThreeVector momentum;
+        G4double time;
+    };
+
+    // follow the exact solution for a path length, hopping between leaves
+    void Advance(State& state, G4double length);
+
+    // charge factor (dp/dt per unit field) and mass squared of the track
+    G4double forceFactor_ = 0.;
+    G4double massSquared_ = 0.;
+    // map cached from the equation's field object, refreshed when it changes
+    G4EqMagElectricField* equation_;
+    const G4Field* field_ = nullptr;
+    const AdaptiveSumRadialFieldMap* fieldMap_ = nullptr;
+
+    // start, half-way and end point of the last step (for DistChord)
+    G4ThreeVector start_, middle_, end_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
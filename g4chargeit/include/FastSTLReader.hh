@@ -0,0 +1,123 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file FastSTLReader.hh
+/// \brief Definition of the TriangleMesh struct and the FastSTLReader class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef FastSTLReader_h
+#define FastSTLReader_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class G4TessellatedSolid;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Indexed triangle mesh, in the units of the STL file (not scaled).
+struct TriangleMesh
+{
+    G4String name;
+    std::vector<G4ThreeVector> vertices;          // unique vertices
+    std::vector<std::array<G4int, 3>> triangles;  // indices into vertices
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Fast STL reader, replacing the CADMesh lexer for the grain geometry.
+/** The file is memory mapped and parsed with OpenMP: binary STL is split by
+ * triangle records, ASCII STL by byte ranges, every thread collecting the
+ * "vertex" lines that start in its range. Identical vertices are merged, so
+ * each solid ends up as an indexed mesh; triangles that collapse to a line
+ * or a point are dropped, G4TessellatedSolid would refuse them anyway.
+ *
+ * The indexed meshes are cached in a sidecar file next to the STL
+ * (CacheFileFor), stamped with the size and modification time of the STL,
+ * so later runs on the same file skip parsing. The G4TessellatedSolid and
+ * its voxels cannot be serialised; BuildSolid recreates them from the
+ * cached mesh.
+ */
+
+class FastSTLReader
+{
+  public:
+
+    FastSTLReader();
+   ~FastSTLReader() = default;
+
+    /// Read an STL file, from its cache when that is up to date.
+    G4bool Read(const std::string& path);
+
+    const std::vector<TriangleMesh>& GetMeshes() const { return meshes_; }
+    /// Whether the last Read was served from the cache.
+    G4bool ReadFromCache() const { return fromCache_; }
+
+    /// Read and write the sidecar cache (default true).
+    void SetUseCache(G4bool value) { useCache_ = value; }
+
+    /// Cache file of an STL file ("x.stl" -> "x.stl.meshcache").
+    static std::string CacheFileFor(const std::string& path);
+
+    /// Connected components of a mesh (facets sharing vertices), largest first.
+    static std::vector<TriangleMesh> SplitConnected(const TriangleMesh& mesh);
+
+    /// Closed, voxelised tessellated solid of a mesh, vertices scaled by scale.
+    static G4TessellatedSolid* BuildSolid(const TriangleMesh& mesh, G4double scale,
+                                          const G4String& name);
+
+  private:
+
+    /// Size and modification time of the STL file the cache was made from.
+    struct Stamp
+    {
+        std::uint64_t size = 0;
+        std::int64_t  mtime = 0;
+    };
+
+    G4bool ParseBinary(const char* data, std::size_t size);
+    G4bool ParseASCII(const char* data, std::size_t size);
+    /// Merge identical corners of a triangle soup into a new indexed mesh.
+    void AddMesh(const G4String& name, const std::vector<G4ThreeVector>& corners);
+
+    G4bool LoadCache(const std::string& cacheFile, const Stamp& stamp);
+    void SaveCache(const std::string& cacheFile, const Stamp& stamp) const;
+
+    std::vector<TriangleMesh> meshes_;
+    G4bool useCache_;
+    G4bool fromCache_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,59 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file GeometryUtilities.hh
+/// \brief Definition of the geometry helper functions
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef GeometryUtilities_h
+#define GeometryUtilities_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class G4VSolid;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace GeometryUtilities
+{
+  /// Direction from a point inside or outside a solid towards its nearest
+  /// surface, and the distance to the surface along it.
+  /** The safety distance (DistanceToOut inside, DistanceToIn outside) falls
+   * fastest towards the nearest surface, so the ray along its descent,
+   * estimated with central differences of at least minStep, reaches that
+   * surface even where the safety is only a lower bound. False on the
+   * surface, where the descent vanishes or where the ray misses the solid.
+   */
+  G4bool NearestSurface(const G4VSolid& solid, const G4ThreeVector& point, G4double minStep,
+                        G4ThreeVector& direction, G4double& distance);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,190 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file HitOutputWriter.hh
+/// \brief Definition of the HitBatch and HitOutputWriter classes
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef HitOutputWriter_h
+#define HitOutputWriter_h 1
+
+#include "globals.hh"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class SensitiveDetectorHit;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Output columns written for every hit.
+/** This table is the single definition of the hit output: the ROOT ntuple
+ * (SensitiveDetector::CreateTrees) and the binary column files
+ * (BinaryHitWriter) are both created from it, in this order.
+ */
+
+enum class HitColumnType { Int, String, Double, DoubleVector };
+
+struct HitColumn
+{
+    const char* name;
+    HitColumnType type;
+};
+
+enum HitColumnIndex {
+    kEventNumber, kProcessPre, kProcessPost, kParticleType, kVolumePre, kVolumePost,
+    kKineticEnergyPre, kKineticEnergyPost, kParentID, kWeight, kPrePosition, kPostPosition,
+    kNumHitColumns
+};
+
+static const HitColumn kHitColumns[kNumHitColumns] = {
+    {"Event_Number",            HitColumnType::Int},
+    {"Process_Name_Pre",        HitColumnType::String},
+    {"Process_Name_Post",       HitColumnType::String},
+    {"Particle_Type",           HitColumnType::String},
+    {"Volume_Name_Pre",         HitColumnType::String},
+    {"Volume_Name_Post",        HitColumnType::String},
+    {"Kinetic_Energy_Pre_MeV",  HitColumnType::Double},
+    {"Kinetic_Energy_Post_MeV", HitColumnType::Double},
+    {"Parent_ID",               HitColumnType::Double},
+    {"Weight",                  HitColumnType::Double},
+    {"Pre_Step_Position_mm",    HitColumnType::DoubleVector},
+    {"Post_Step_Position_mm",   HitColumnType::DoubleVector}
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Column-wise buffer of sensitive detector hits.
+/** A batch holds the values of every output column for a block of hits, one
+ * std::vector per column. SensitiveDetector::RecordTrees appends the hits of
+ * each event to the current batch and writes it to the ntuple or hands full
+ * batches of binary output to the HitOutputWriter.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+struct HitBatch
+{
+    void Append(SensitiveDetectorHit* hit, G4int eventNumber);
+    void Clear();
+    void Reserve(std::size_t rows);
+    std::size_t Size() const { return eventNumber.size(); }
+    /// Int column by HitColumnIndex (kEventNumber).
+    const std::vector<G4int>& Ints(G4int column) const;
+    /// String column by HitColumnIndex (kProcessPre ... kVolumePost).
+    const std::vector<G4String>& Strings(G4int column) const;
+    /// Double column by HitColumnIndex; vector columns hold 3 values per hit.
+    const std::vector<G4double>& Doubles(G4int column) const;
+
+    std::vector<G4int>    eventNumber;
+    std::vector<G4String> processPre;
+    std::vector<G4String> processPost;
+    std::vector<G4String> particleType;
+    std::vector<G4String> volumePre;
+    std::vector<G4String> volumePost;
+    std::vector<G4double> kineticEnergyPre;   // MeV
+    std::vector<G4double> kineticEnergyPost;  // MeV
+    std::vector<G4double> parentID;
+    std::vector<G4double> weight;             // statistical weight of the track
+    std::vector<G4double> prePosition;        // mm, 3 values per hit
+    std::vector<G4double> postPosition;       // mm, 3 values per hit
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Background writer thread for hit batches.
+/* The tracking thread is the only producer and the writer thread the only
+ * consumer, so batches travel through two single-producer/single-consumer
+ * lock-free rings: a "full" ring towards the writer and a "free" ring that
+ * returns drained batches for reuse. The number of batches is fixed at
+ * construction (two gives classic double buffering), so when the writer
+ * falls behind AcquireBatch blocks the tracking thread until a buffer is
+ * returned (back-pressure) instead of growing memory without bound.
+ *
+ * The sink is called on the writer thread only; whatever it touches (the
+ * column files of a BinaryHitWriter) must not be used by the tracking thread
+ * while the writer is running. The sink must not use thread-local state such
+ * as the analysis manager, which belongs to the tracking thread.
+ */
+
+class HitOutputWriter
+{
+  public:
+
+    using Sink = std::function<void(const HitBatch&)>;
+
+    HitOutputWriter(Sink sink, G4int nBuffers = 2, std::size_t batchRows = 4096);
+   ~HitOutputWriter();
+
+    /// Get an empty batch to fill, waiting for the writer if none is free.
+    HitBatch* AcquireBatch();
+    /// Queue a filled batch for writing; ownership passes to the writer.
+    void Submit(HitBatch* batch);
+    /// Write all queued batches and stop the writer thread.
+    void Finish();
+
+    std::size_t GetBatchRows() const { return batchRows_; }
+    /// Number of times AcquireBatch had to wait for the writer.
+    G4long GetStallCount() const { return stalls_.load(); }
+
+  private:
+
+    /// Fixed-capacity SPSC ring of batch pointers.
+    class Ring
+    {
+      public:
+        explicit Ring(std::size_t capacity);
+        G4bool Push(HitBatch* batch);
+        HitBatch* Pop();
+        G4bool Empty() const;
+
+      private:
+        std::vector<HitBatch*> slots_;
+        std::size_t capacity_;
+        alignas(64) std::atomic<std::size_t> head_;
+        alignas(64) std::atomic<std::size_t> tail_;
+    };
+
+    void Run();
+
+    Sink sink_;
+    std::size_t batchRows_;
+    std::vector<std::unique_ptr<HitBatch>> buffers_;
+    Ring full_;
+    Ring free_;
+    std::atomic<G4bool> stop_;
+    std::atomic<G4long> stalls_;
+    std::thread thread_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
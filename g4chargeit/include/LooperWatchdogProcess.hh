@@ -0,0 +1,171 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file LooperWatchdogProcess.hh
+/// \brief Definition of the LooperWatchdogProcess and
+///        LooperWatchdogPhysics classes
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef LooperWatchdogProcess_h
+#define LooperWatchdogProcess_h 1
+
+#include "G4ThreeVector.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "G4VProcess.hh"
+
+#include <chrono>
+
+class G4VSolid;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Tracks stopped by the watchdog, summed per thread and merged per run.
+struct LooperStatistics
+{
+    G4long bySteps = 0;         // more steps than /looper/maxSteps
+    G4long byLoop = 0;          // long path, small net displacement
+    G4long byVacuumTime = 0;    // longer than /looper/maxVacuumTime in vacuum
+    G4long steps = 0;           // steps of the stopped tracks
+    G4double seconds = 0.;      // tracking time spent on them until stopped
+
+    G4long Tracks() const { return bySteps + byLoop + byVacuumTime; }
+    LooperStatistics& operator+=(const LooperStatistics& other);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Stops charged tracks that loop in the potential wells between grains.
+/** Once the grains charge up, slow photoelectrons can oscillate between
+ * them for a huge number of field-integration steps. In the vacuum this
+ * process stops a charged track that
+ *
+ *  - has taken more than maxSteps steps,
+ *  - has a path length above loopPath while its net displacement from the
+ *    start is still below loopDisplacement, or
+ *  - has spent more than maxVacuumTime (global time) in the vacuum.
+ *
+ * A limit of zero disables its test. What becomes of a stopped track is set
+ * by the policy:
+ *
+ *  - "surface": its charge is deposited just below the nearest grain
+ *    surface, found along the steepest descent of the safety of the grains;
+ *  - "trapped": its charge stays where the track is, as trapped space charge;
+ *  - "kill":    the track and its charge are dropped.
+ *
+ * Charges of the first two end the track with zero kinetic energy and the
+ * process name "Looper" as the post-step process, which the charge
+ * selection accepts outside the grains (ChargeCollector, the file readers).
+ */
+
+class LooperWatchdogProcess : public G4VProcess
+{
+  public:
+
+    /// Post-step process name of the charges it leaves outside the grains.
+    static constexpr const char* kProcessName = "Looper";
+
+    explicit LooperWatchdogProcess(const G4String& processName = kProcessName);
+   ~LooperWatchdogProcess() override = default;
+
+    /// Shared by all threads, set between runs.
+    static void SetMaxSteps(G4int value) { maxSteps_ = value; }
+    static void SetLoopPath(G4double value) { loopPath_ = value; }
+    static void SetLoopDisplacement(G4double value) { loopDisplacement_ = value; }
+    static void SetMaxVacuumTime(G4double value) { maxVacuumTime_ = value; }
+    static void SetPolicy(const G4String& value);
+    /// Union of the grains in world coordinates, for the "surface" policy.
+    static void SetGrains(const G4VSolid* grains) { grains_ = grains; }
+
+    static G4bool IsActive() { return maxSteps_ > 0 || loopPath_ > 0. || maxVacuumTime_ > 0.; }
+    static const G4String& GetPolicy();
+    /// Statistics of the calling thread since the last call.
+    static LooperStatistics TakeStatistics();
+
+    G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+    void StartTracking(G4Track* track) override;
+
+    G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                  G4double previousStepSize,
+                                                  G4ForceCondition* condition) override;
+    G4VParticleChange* PostStepDoIt(const G4Track& track, const G4Step& step) override;
+
+    // not an along-step or at-rest process
+    G4double AlongStepGetPhysicalInteractionLength(const G4Track&, G4double, G4double,
+                                                   G4double&, G4GPILSelection*) override
+    { return -1.0; }
+    G4double AtRestGetPhysicalInteractionLength(const G4Track&, G4ForceCondition*) override
+    { return -1.0; }
+    G4VParticleChange* AlongStepDoIt(const G4Track&, const G4Step&) override { return nullptr; }
+    G4VParticleChange* AtRestDoIt(const G4Track&, const G4Step&) override { return nullptr; }
+
+  private:
+
+    enum Policy { kSurface, kTrapped, kKill };
+    enum Reason { kNone, kSteps, kLoop, kVacuumTime };
+
+    // point just below the grain surface nearest to a point in the vacuum
+    static G4bool NearestSurface(const G4ThreeVector& point, G4ThreeVector& surface);
+
+    // state of the current track
+    G4ThreeVector startPosition_;
+    G4double lastTime_;
+    G4bool lastInVacuum_;
+    G4double vacuumTime_;
+    Reason reason_;
+    std::chrono::steady_clock::time_point startClock_;
+
+    static G4int maxSteps_;
+    static G4double loopPath_;
+    static G4double loopDisplacement_;
+    static G4double maxVacuumTime_;
+    static Policy policy_;
+    static const G4VSolid* grains_;
+    static G4ThreadLocal LooperStatistics statistics_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Registers a LooperWatchdogProcess for every charged particle; it stays
+/// inactive until one of the /looper/ limits is set.
+
+class LooperWatchdogPhysics : public G4VPhysicsConstructor
+{
+  public:
+
+    explicit LooperWatchdogPhysics(const G4String& name = "LooperWatchdog");
+   ~LooperWatchdogPhysics() override = default;
+
+  protected:
+
+    void ConstructParticle() override {}
+    void ConstructProcess() override;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,182 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PhotonStageCache.hh
+/// \brief Definition of the PhotonStageCache class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef PhotonStageCache_h
+#define PhotonStageCache_h 1
+
+#include "globals.hh"
+#include "G4VUserPrimaryParticleInformation.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+class G4Event;
+class G4Track;
+
+/// Record and replay of the photon stage of the events.
+/** Photons are neutral, so their transport and absorption do not depend on
+ * the charging field and are statistically the same in every iteration;
+ * only the charged particles they release need tracking in the new field.
+ *
+ * In "record" mode the StackingAction hands every new track to Record. The
+ * photon stage of an event are the primary photons and the photons created
+ * by it; the first particle of any other kind created by it (photo-,
+ * Compton and Auger electrons), as well as any primary that is not a
+ * photon, is written with its position, direction, energy, weight, time
+ * and parent ID to a compact binary file at the end of the event.
+ *
+ * In "replay" mode PrimaryGeneratorAction emits the recorded particles of
+ * cached event (event ID modulo the number of cached events) as the
+ * primaries of the event instead of running a generator. Every replayed
+ * primary carries its recorded parent ID (PrimaryInfo), which the hits
+ * report; the direct secondaries of a replayed primary report its recorded
+ * track ID and the deeper tracks IDs past the primaries of the recording,
+ * so the hole and reference selections are those of the recording.
+ *
+ * "auto" records when the file does not exist and replays it otherwise, so
+ * the first /charging/iterate iteration records and the others replay. When
+ * an iteration runs in chunks, its later chunks continue the recording or
+ * the replay of the earlier ones (SetEventOffset).
+ * The file has to be deleted when the sources or the grains change.
+ *
+ * The mode is applied on the master at the start of every run (BeginRun);
+ * the workers record concurrently and only read the replayed events.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class PhotonStageCache
+{
+  public:
+
+    /// One particle leaving the photon stage, as written to the file.
+    struct Particle
+    {
+      G4double position[3];   // mm
+      G4float direction[3];
+      G4float energy;         // MeV
+      G4float weight;
+      G4float time;           // ns
+      std::int32_t pdg;
+      std::int32_t parentID;
+      std::int32_t trackID;   // in the recording
+      std::int32_t padding;   // zero, keeps the record size fixed
+    };
+
+    /// Recorded parent ID of a replayed primary.
+    class PrimaryInfo : public G4VUserPrimaryParticleInformation
+    {
+      public:
+        explicit PrimaryInfo(G4int parentID) : parentID_(parentID) {}
+        G4int GetParentID() const { return parentID_; }
+        void Print() const override;
+
+      private:
+        G4int parentID_;
+    };
+
+    static PhotonStageCache* GetInstance();
+
+    void SetMode(const G4String& mode);
+    void SetFile(const G4String& file) { file_ = file; }
+    /// Events of the earlier runs of the same iteration (Iterate in chunks):
+    /// the replay continues after them and the recording is appended to.
+    void SetEventOffset(G4long offset) { eventOffset_ = offset; }
+
+    /// Open the file for recording or load it for replay (master).
+    void BeginRun();
+    /// Complete the recorded file (master).
+    void EndRun();
+
+    G4bool IsRecording() const { return recording_; }
+    G4bool IsReplaying() const { return replaying_; }
+
+    /// Start a new event of this thread (StackingAction::PrepareNewEvent).
+    void BeginEvent();
+    /// Note a new track of this thread's event (StackingAction).
+    void Record(const G4Track* track);
+    /// Write the particles recorded in this thread's event (Run::RecordEvent).
+    void EndEvent();
+
+    /// Emit the recorded particles of an event as its primaries.
+    void GeneratePrimaries(G4Event* event) const;
+
+    /// Parent ID of the track as in the recording, or its own parent ID.
+    static G4int GetParentID(const G4Track* track);
+
+  private:
+
+    PhotonStageCache();
+
+    G4bool Load();
+
+    // track IDs of the photon stage and particles of this thread's event;
+    // in replay, the recorded track IDs of the primaries (track ID - 1) and
+    // the shift of the other track IDs past those of the recording
+    struct EventRecord
+    {
+      std::vector<char> photonStage;
+      std::vector<Particle> particles;
+      std::vector<G4int> replayedTrackIDs;
+      G4int replayShift = 0;
+    };
+    static EventRecord& ThreadRecord();
+
+    G4String mode_;
+    G4String file_;
+    G4bool recording_;
+    G4bool replaying_;
+    G4long eventOffset_;
+    // the previous run recorded, so a further chunk can append to it
+    G4bool recordedLast_;
+
+    // recording: the file and its totals, written under the mutex
+    std::mutex mutex_;
+    std::ofstream output_;
+    std::uint64_t recordedEvents_;
+    std::uint64_t recordedParticles_;
+
+    // replay: all particles and the first of every event
+    std::vector<Particle> particles_;
+    std::vector<std::uint64_t> eventOffsets_;
+    G4String loadedFile_;
+    mutable std::atomic<G4bool> wrapWarned_;
+
+    static PhotonStageCache* singletonInstance_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -38,7 +38,10 @@
 #include "G4GeneralParticleSource.hh"
 #include "globals.hh"
 
+#include <vector>
+
 class G4Event;
+class G4ParticleDefinition;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -55,7 +58,12 @@ class PrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 
   private:
 
+    /// One primary per source of the PrimarySourceTable ("alias" generator)
+    void GenerateFromSourceTable(G4Event* anEvent);
+
     G4GeneralParticleSource* particleGun_;
+    std::vector<G4ParticleDefinition*> definitions_;  // per source of the table
+    G4int tableVersion_;
 
 };
 
@@ -0,0 +1,165 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PrimarySourceTable.hh
+/// \brief Definition of the PrimarySourceTable class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef PrimarySourceTable_h
+#define PrimarySourceTable_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+#include "SpectrumSampler.hh"
+#include "SourceShadowMask.hh"
+
+#include <cfloat>
+#include <memory>
+#include <vector>
+
+/// Primary sources of the alias generator, set by the /source/ commands.
+/** PrimaryGeneratorAction either hands every event to its
+ * G4GeneralParticleSource (generator "gps", the default) or, with the
+ * generator "alias", samples the sources of this table directly: a source
+ * is a particle with a tabulated spectrum (SpectrumSampler), emitted from a
+ * rectangle in the xy plane either along a fixed direction or isotropically
+ * into the -z hemisphere up to a maximum angle, as /gps/pos/type Plane,
+ * /gps/pos/shape Square and /gps/ang/type iso do. With several sources
+ * each primary picks one in proportion to its intensity.
+ *
+ * Both generators emit GetPrimariesPerEvent primaries per event.
+ *
+ * A source can bias its energies, dropping those below a minimum and
+ * oversampling a tail; its primaries then carry the statistical weight of
+ * their energy, which the secondaries inherit and the hits record.
+ *
+ * With culling on, a neutral source with a fixed direction only emits from
+ * the part of its rectangle whose rays reach the grains (SourceShadowMask).
+ * The sources are then picked in proportion to intensity times acceptance,
+ * and an event stands for 1/GetAcceptance primaries of the full rectangles.
+ *
+ * The table is filled on the master between runs and only read by the
+ * workers; every change increments GetVersion, so the generators know when
+ * to look up their particle definitions again.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class PrimarySourceTable
+{
+  public:
+
+    struct Source
+    {
+      G4String particle = "e-";
+      G4String spectrumFile;
+      SpectrumSampler::Interpolation interpolation = SpectrumSampler::kLinear;
+      std::shared_ptr<const SpectrumSampler> spectrum;
+      G4ThreeVector centre;
+      G4double halfX = 0.;
+      G4double halfY = 0.;
+      G4ThreeVector direction = G4ThreeVector(0., 0., -1.);
+      G4bool isotropic = false;
+      G4double cosMaxTheta = 0.;
+      G4double intensity = 1.;
+      G4double minEnergy = 0.;
+      G4double tailEnergy = DBL_MAX;
+      G4double tailFactor = 1.;
+      std::shared_ptr<const SourceShadowMask> shadow;  // only with culling
+    };
+
+    /// Get instance of the table
+    static PrimarySourceTable* GetInstance();
+
+    /// "gps" or "alias"
+    void SetGenerator(const G4String& value);
+    G4bool UseAliasGenerator() const { return generator_ == "alias"; };
+    void SetPrimariesPerEvent(G4int value);
+    G4int GetPrimariesPerEvent() const { return primariesPerEvent_; };
+    /// True for the track IDs Geant4 gives the primaries of an event.
+    G4bool IsPrimaryTrack(G4int trackID) const
+    { return trackID >= 1 && trackID <= primariesPerEvent_; };
+
+    /// Start a new source; the commands below apply to the last one.
+    /** As with /gps/source/add, a first source exists from the start. */
+    void AddSource(G4double intensity);
+    void SetIntensity(G4double value);
+    void SetParticle(const G4String& value);
+    void SetSpectrum(const G4String& fileName);
+    /// "Lin" or "Log", as /gps/hist/inter
+    void SetInterpolation(const G4String& value);
+    void SetCentre(const G4ThreeVector& value);
+    void SetHalfX(G4double value);
+    void SetHalfY(G4double value);
+    void SetDirection(const G4ThreeVector& value);
+    void SetIsotropic(G4double maxTheta);
+    /// Energy biasing of the current source (see SpectrumSampler::SetBias)
+    void SetMinEnergy(G4double value);
+    void SetTailEnergy(G4double value);
+    void SetTailFactor(G4double value);
+
+    void SetCulling(G4bool value);
+    void SetCullingCells(G4int value);
+    /// Rebuild the shadow masks if the sources or the geometry changed (master).
+    void UpdateShadows(const G4VSolid& grains, const G4ThreeVector& worldHalf, G4bool periodic,
+                       G4int geometryVersion);
+    /// Fraction of the emitted primaries that is sampled, 1 without culling.
+    G4double GetAcceptance() const;
+
+    const std::vector<Source>& GetSources() const { return sources_; };
+    /// Source for a uniform random number, in proportion to the intensities.
+    std::size_t SelectSource(G4double u) const;
+    G4int GetVersion() const { return version_; };
+
+  private:
+
+    PrimarySourceTable();
+   ~PrimarySourceTable() {};
+
+    Source& Current() { version_++; return sources_.back(); };
+    void LoadSpectrum(Source& source);
+    // the gps generator draws its own energies and ignores the biasing
+    void WarnBiasIgnored(const G4String& command) const;
+    void UpdateCumulative();
+
+    static PrimarySourceTable* singletonInstance_;
+
+    G4String generator_;
+    G4int primariesPerEvent_;
+    std::vector<Source> sources_;
+    std::vector<G4double> cumulative_;
+    G4int version_;
+    G4bool culling_;
+    G4int cullingCells_;
+    G4int shadowVersion_;          // table version of the current masks
+    G4int shadowGeometryVersion_;  // and geometry version
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
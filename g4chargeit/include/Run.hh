@@ -34,6 +34,8 @@
 #define Run_h 1
 
 #include "G4Run.hh"
+#include "LooperWatchdogProcess.hh"
+#include "WorldPeriodicBoundaryProcess.hh"
 
 class G4ParticleDefinition;
 
@@ -47,7 +49,22 @@ class Run : public G4Run
    ~Run();
 
     void RecordEvent(const G4Event*); 
+    void Merge(const G4Run*) override;
 
+    // field map lookups and charged steps in the field (see TrackFieldManager)
+    G4long GetFieldCalls() const { return fieldCalls_; }
+    G4long GetFieldSteps() const { return fieldSteps_; }
+    // tracks stopped by the looper watchdog
+    const LooperStatistics& GetLoopers() const { return loopers_; }
+    // steps seen and forced by the periodic boundary
+    const PeriodicStatistics& GetPeriodic() const { return periodic_; }
+
+  private:
+
+    G4long fieldCalls_;
+    G4long fieldSteps_;
+    LooperStatistics loopers_;
+    PeriodicStatistics periodic_;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
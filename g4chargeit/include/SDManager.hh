@@ -49,7 +49,20 @@ class SDManager
     /// Record Trees to save the relevant data
     static void RecordTrees() {sd_ -> RecordTrees();};
     /// Create Trees for a place to save the relevant data
-    static void CreateTrees() {sd_ -> CreateTrees();};
+    static void CreateTrees();
+    /// Write buffered hits before the output file is closed
+    static void FlushTrees();
+
+    /// Output buffering options, applied to the SD when the trees are created
+    static void SetAsyncOutput(G4bool value) {asyncOutput_ = value;};
+    static void SetOutputBuffers(G4int value) {outputBuffers_ = value;};
+    static void SetOutputBatchRows(G4int value) {outputBatchRows_ = value;};
+
+    /// Output file and backend ("root" or "binary")
+    static void SetOutputFile(const G4String& value) {outputFile_ = value;};
+    static const G4String& GetOutputFile() {return outputFile_;};
+    static void SetOutputFormat(const G4String& value) {outputFormat_ = value;};
+    static G4bool IsBinaryOutput() {return outputFormat_ == "binary";};
 
     /// Get sensitive detector from sensitive detector class
     SensitiveDetector* GetSD() {return sd_;};
@@ -62,8 +75,14 @@ class SDManager
     virtual ~SDManager() {};     
 
     static SDManager* singletonInstance_;
-    static SensitiveDetector* sd_; //AV: G4ThreadLocal 
+    static G4ThreadLocal SensitiveDetector* sd_;
     // make pointer to sensitive detector, static since there is only one for SD managers, thread local so only get one pre set of thread
+
+    static G4bool asyncOutput_;
+    static G4int outputBuffers_;
+    static G4int outputBatchRows_;
+    static G4String outputFile_;
+    static G4String outputFormat_;
     
 };
 
@@ -37,6 +37,8 @@
 #define SensitiveDetector_h 1
 
 #include "SensitiveDetectorHit.hh"
+#include "HitOutputWriter.hh"
+#include "BinaryHitWriter.hh"
 
 #include "G4THitsCollection.hh" // Necessary for the collections of the hit class
 #include "G4HCofThisEvent.hh"
@@ -48,6 +50,7 @@
 
 #include <vector>
 #include <array>
+#include <memory>
 
 /// Forward declaration of the hit class we will declare below
 class SensitiveDetectorHit;
@@ -59,7 +62,15 @@ class SensitiveDetectorHit;
  * output data structure. ProcessHits is then called for every interaction
  * within the sensitive detector volume. Finally at the end of each event
  * RecordTrees is called to fill the output data structure with the data
- * accumulated by the SD hit collection during the event.
+ * accumulated by the SD hit collection during the event. The hits are first
+ * copied into a HitBatch and written either to the ROOT ntuple or, with
+ * binary output selected, to a BinaryHitWriter; both are built from the same
+ * kHitColumns table. With asynchronous output enabled, binary batches are
+ * written by a HitOutputWriter thread. ROOT batches are always written on the
+ * tracking thread, because the analysis manager is thread-local.
+ * FlushTrees must be called at the end of the run before the file is closed.
+ * In multithreaded mode every worker owns its SD (and its writer thread), so
+ * nothing here is shared between workers.
  */
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -86,8 +97,34 @@ class SensitiveDetector : public G4VSensitiveDetector
     /// Record sensitive detector event information in output structure.
     virtual void RecordTrees(); 
 
+    /// Write any buffered hits and stop the output writer thread.
+    virtual void FlushTrees();
+
+    /// Enable or disable the background output writer for the next run.
+    void SetAsyncOutput(G4bool value) { asyncOutput_ = value; };
+    /// Number of hit batches in flight for the background writer.
+    void SetOutputBuffers(G4int value) { outputBuffers_ = value; };
+    /// Number of hits collected in a batch before it is handed off.
+    void SetOutputBatchRows(G4int value) { outputBatchRows_ = value; };
+    /// Write binary column files instead of the ROOT ntuple.
+    void SetBinaryOutput(G4bool value) { binaryOutput_ = value; };
+    /// Output file name; binary columns go to the matching .cols directory.
+    void SetOutputFile(const G4String& value) { outputFile_ = value; };
+
+    /// Book the "Hit Data" ntuple from kHitColumns and return its ID.
+    /** Also used on the master thread, which has no SD but must book the
+     * same ntuple for the worker ntuples to be merged into it.
+     */
+    static G4int BookNtuple(G4RootAnalysisManager* rootManager,
+                            std::array<int, kNumHitColumns>& columnID,
+                            std::vector<double>& preValues,
+                            std::vector<double>& postValues);
+
   private:
 
+    /// Fill the ntuple from a batch of hits (runs on the writer thread).
+    void WriteBatch(const HitBatch& batch);
+
     /// The collection of hit information accumulated during an event.
     G4THitsCollection< SensitiveDetectorHit >* hits_;
 
@@ -101,27 +138,26 @@ class SensitiveDetector : public G4VSensitiveDetector
     // tree ID
     int treeID_;
 
-    // branch IDs for particle tree
-    int evtBranchID_; 
-    int processPreID_;
-    int processPostID_;
-    int particleTypeID_;
-    int volumePreID_;
-    int volumePostID_;
-
-    // branch IDs for energy tree
-    //int edepBranchID_;
-    //int nonIedepBranchID_;
-    int kineticEnergyPreID_;
-    int kineticEnergyPostID_;
-    int parentID_;
-    //int chargePreID_;
-    //int chargePostID_;
+    // branch IDs, indexed by HitColumnIndex
+    std::array<int, kNumHitColumns> columnID_;
 
     // vectors for position information
     std::vector<double> vectorPreValues_;    
     std::vector<double> vectorPostValues_;
 
+    // output buffering
+    G4bool asyncOutput_;
+    G4int outputBuffers_;
+    G4int outputBatchRows_;
+    std::unique_ptr<HitOutputWriter> writer_;
+    HitBatch* batch_;
+    HitBatch syncBatch_;
+
+    // binary column backend
+    G4bool binaryOutput_;
+    G4String outputFile_;
+    std::unique_ptr<BinaryHitWriter> binaryWriter_;
+
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -85,6 +85,7 @@ public:
     G4double GetPreKineticEnergy() {return kineticEnergyPre_;};
     G4double GetPostKineticEnergy() {return kineticEnergyPost_;};
     G4double GetParentID() {return parentID_;};
+    G4double GetWeight() {return weight_;};
     //G4double GetPreCharge() {return chargePre_;};
     //G4double GetPostCharge() {return chargePost_;};
 
@@ -111,6 +112,7 @@ private:
     G4double kineticEnergyPre_;
     G4double kineticEnergyPost_;
     G4double parentID_;
+    G4double weight_;
     //G4double chargePre_;
     //G4double chargePost_;
 
@@ -0,0 +1,141 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SkinBiasingOperator.hh
+/// \brief Definition of the SkinBiasingOperator class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef SkinBiasingOperator_h
+#define SkinBiasingOperator_h 1
+
+#include "G4VBiasingOperation.hh"
+#include "G4VBiasingOperator.hh"
+#include "G4ThreeVector.hh"
+
+#include <map>
+#include <memory>
+
+class G4BOptnChangeCrossSection;
+class G4ParticleChangeForNothing;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Near-surface biasing of the photoabsorption in the grains.
+/** Only photoelectrons released within a few tens of nanometres of a grain
+ * surface escape and charge the grains, while photons are absorbed
+ * throughout the bulk. Inside a skin of the given depth below the surface
+ * this operator multiplies the cross section of the photoelectric effect
+ * ("phot") of gammas by the skin factor; the occurrence biasing of the
+ * generic biasing framework gives the photon and its secondaries the
+ * corresponding weights, which the hits carry into the charges.
+ *
+ * The depth of a photon is the distance to the surface of the grain solid it
+ * is in (DistanceToOut(p), which is voxelised for tessellated and multi-union
+ * solids and uses the BVH of the CAD solid). A non-physics operation limits
+ * the steps so the boost ends at the skin boundary when a photon goes deeper
+ * and starts again when it approaches the far surface.
+ *
+ * One operator exists per thread, attached to the grain volumes in
+ * DetectorConstruction::ConstructSDandField. The skin is shared by all
+ * threads and read at the start of every run; /biasing/skin registers the
+ * generic biasing physics, so it has to be given before /run/initialize.
+ */
+
+class SkinBiasingOperator : public G4VBiasingOperator
+{
+  public:
+
+    SkinBiasingOperator();
+   ~SkinBiasingOperator() override;
+
+    /// Skin depth, 0 disables the biasing; the first call with a depth
+    /// registers the biasing physics, which is only possible in PreInit.
+    static void SetSkinDepth(G4double depth);
+    static void SetSkinFactor(G4double factor);
+    /// True once the biasing physics is registered.
+    static G4bool IsAvailable() { return physicsRegistered_; }
+
+    void StartRun() override;
+
+  private:
+
+    /// Step limit at the next skin boundary; leaves the track unchanged.
+    class StepLimitOperation : public G4VBiasingOperation
+    {
+      public:
+        StepLimitOperation();
+       ~StepLimitOperation() override;
+
+        void SetDistance(G4double distance) { distance_ = distance; }
+
+        const G4VBiasingInteractionLaw*
+        ProvideOccurenceBiasingInteractionLaw(const G4BiasingProcessInterface*,
+                                              G4ForceCondition&) override { return nullptr; }
+        G4VParticleChange* ApplyFinalStateBiasing(const G4BiasingProcessInterface*,
+                                                  const G4Track*, const G4Step*,
+                                                  G4bool&) override { return nullptr; }
+        G4double DistanceToApplyOperation(const G4Track*, G4double,
+                                          G4ForceCondition* condition) override;
+        G4VParticleChange* GenerateBiasingFinalState(const G4Track* track,
+                                                     const G4Step*) override;
+
+      private:
+        G4double distance_;
+        G4ParticleChangeForNothing* particleChange_;
+    };
+
+    G4VBiasingOperation*
+    ProposeOccurenceBiasingOperation(const G4Track* track,
+                                     const G4BiasingProcessInterface* callingProcess) override;
+    G4VBiasingOperation*
+    ProposeNonPhysicsBiasingOperation(const G4Track* track,
+                                      const G4BiasingProcessInterface* callingProcess) override;
+    G4VBiasingOperation*
+    ProposeFinalStateBiasingOperation(const G4Track*,
+                                      const G4BiasingProcessInterface*) override { return nullptr; }
+
+    // distance of the track to the surface of its grain, once per step
+    G4double Depth(const G4Track* track);
+
+    G4double skinDepth_;
+    G4double skinFactor_;
+    std::map<const G4BiasingProcessInterface*, G4BOptnChangeCrossSection*> operations_;
+    std::unique_ptr<StepLimitOperation> stepLimit_;
+    const G4Track* depthTrack_;
+    G4ThreeVector depthPosition_;
+    G4double depth_;
+
+    // configuration shared by the threads (set on the master between runs)
+    static G4double sharedSkinDepth_;
+    static G4double sharedSkinFactor_;
+    static G4bool physicsRegistered_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
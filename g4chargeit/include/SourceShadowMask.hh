@@ -0,0 +1,91 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SourceShadowMask.hh
+/// \brief Definition of the SourceShadowMask class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef SourceShadowMask_h
+#define SourceShadowMask_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+#include <vector>
+
+class G4VSolid;
+
+/// Part of a source rectangle whose straight rays reach the grains.
+/** The rectangle of a fixed-direction source (see PrimarySourceTable) is
+ * rasterized into cells, and rays along the source direction are traced
+ * from the corners and edge midpoints of every cell against the grain
+ * solid. A ray follows the world as the simulation does: it is clipped to
+ * the world box, a start outside the box is lost, and with periodic
+ * boundaries it re-enters at the opposite x/y face until it leaves through
+ * the top or the bottom. Cells with a hit, grown by one cell on every side,
+ * form the mask, so only grain features smaller than a cell can be missed.
+ *
+ * Sampling uniformly inside the mask and counting every primary as
+ * 1/GetAcceptance primaries of the whole rectangle is exact for particles
+ * that move in straight lines until their first interaction, i.e. neutral
+ * ones: the culled rays cross the world without touching anything.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class SourceShadowMask
+{
+  public:
+
+    /// Rasterize the shadow of the grains; the longer side gets maxCells cells.
+    void Build(const G4VSolid& grains, const G4ThreeVector& centre, G4double halfX, G4double halfY,
+               const G4ThreeVector& direction, const G4ThreeVector& worldHalf, G4bool periodic,
+               G4int maxCells);
+
+    /// Fraction of the rectangle inside the mask.
+    G4double GetAcceptance() const { return acceptance_; }
+    /// Offset from the source centre, uniform inside the mask (u in [0,1)).
+    G4ThreeVector Sample(G4double u1, G4double u2, G4double u3) const;
+
+  private:
+
+    static G4bool RayHits(const G4VSolid& grains, G4ThreeVector position, const G4ThreeVector& direction,
+                          const G4ThreeVector& worldHalf, G4bool periodic);
+
+    G4double halfX_ = 0.;
+    G4double halfY_ = 0.;
+    G4int cellsX_ = 0;
+    G4double cellX_ = 0.;
+    G4double cellY_ = 0.;
+    std::vector<G4int> cells_;  // index iy*cellsX_ + ix of the cells in the mask
+    G4double acceptance_ = 0.;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
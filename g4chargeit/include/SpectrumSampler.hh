@@ -0,0 +1,111 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SpectrumSampler.hh
+/// \brief Definition of the SpectrumSampler class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef SpectrumSampler_h
+#define SpectrumSampler_h 1
+
+#include "globals.hh"
+
+#include <cfloat>
+#include <vector>
+
+/// Energy sampler for a tabulated differential spectrum.
+/** Reads the point-wise spectra used with /gps/hist/file (one "energy
+ * weight" pair per line, energies in MeV, weights a differential spectrum
+ * as with /gps/ene/diffspec true). Between two points the spectrum is
+ * linear (Lin) or a power law (Log), as GPS interpolates it.
+ *
+ * Sampling is exact for that interpolation and constant time: the segment
+ * is drawn from a Walker alias table of the segment integrals, the energy
+ * inside it by inverting the segment's cumulative distribution, which is a
+ * quadratic for a linear and a power for a power-law segment. A segment
+ * with a zero end point is linear in either mode.
+ *
+ * The sampling can be biased: energies below a minimum are not drawn at
+ * all and energies from a tail energy upwards are drawn a given factor
+ * more often. Sample then also returns the statistical weight of the
+ * energy, the ratio of the true to the biased density, which is the same
+ * for a whole segment as the bias edges are inserted as extra points.
+ *
+ * Load and SetBias build the tables once; Sample is const and can be called
+ * from all worker threads.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class SpectrumSampler
+{
+  public:
+
+    enum Interpolation { kLinear, kPowerLaw };
+
+    /// Read the spectrum; false (with a warning) if it has no two usable points.
+    G4bool Load(const G4String& fileName, Interpolation interpolation);
+
+    /// Truncate below minEnergy and oversample from tailEnergy by tailFactor.
+    /** False if nothing of the spectrum is left above minEnergy. */
+    G4bool SetBias(G4double minEnergy, G4double tailEnergy, G4double tailFactor);
+
+    /// Energy for two uniform random numbers in [0,1), and its statistical weight.
+    G4double Sample(G4double u1, G4double u2, G4double* weight = nullptr) const;
+
+    G4bool IsEmpty() const { return probability_.empty(); }
+    G4double GetMinEnergy() const { return energy_.empty() ? 0. : energy_.front(); }
+    G4double GetMaxEnergy() const { return energy_.empty() ? 0. : energy_.back(); }
+
+  private:
+
+    G4bool Tabulate();
+    G4double BiasFactor(G4double energy) const;
+    G4bool IsPowerLaw(std::size_t segment) const;
+    G4double SegmentIntegral(std::size_t segment) const;
+    G4double SampleSegment(std::size_t segment, G4double u) const;
+    void BuildAliasTable(const std::vector<G4double>& weights);
+
+    Interpolation interpolation_ = kLinear;
+    std::vector<G4double> pointEnergy_;  // as read from the file
+    std::vector<G4double> pointWeight_;
+    G4double minEnergy_ = 0.;
+    G4double tailEnergy_ = DBL_MAX;
+    G4double tailFactor_ = 1.;
+    // segments of the sampling, the file points plus the bias edges
+    std::vector<G4double> energy_;
+    std::vector<G4double> weight_;
+    std::vector<G4double> exponent_;     // power-law segments, d ln(weight)/d ln(energy)
+    std::vector<G4double> segmentWeight_;  // statistical weight of the segment's energies
+    std::vector<G4double> probability_;  // alias table, one column per segment
+    std::vector<std::size_t> alias_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
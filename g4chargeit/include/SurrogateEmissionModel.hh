@@ -0,0 +1,132 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SurrogateEmissionModel.hh
+/// \brief Definition of the SurrogateEmissionModel class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef SurrogateEmissionModel_h
+#define SurrogateEmissionModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "SurrogateEmissionTable.hh"
+
+#include <mutex>
+#include <vector>
+
+class G4LogicalVolume;
+class G4Region;
+class G4VSolid;
+class SensitiveDetectorHit;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Tabulated photoemission of the grains in place of the photon cascade.
+/** Of the full electromagnetic cascade of a photon in a grain (option4 with
+ * fluorescence, Auger electrons and PIXE) the charging only keeps the
+ * electrons that leave the grain and the holes they leave behind. In
+ * "fast" mode this fast-simulation model of the grain region replaces the
+ * cascade by the SurrogateEmissionTable: a photon entering a grain travels
+ * an exponential path of the tabulated absorption coefficient; if it
+ * reaches the far surface it continues from there unchanged, otherwise it
+ * is absorbed, and the tabulated yield of its energy and depth gives the
+ * number of electrons emitted from the nearest surface point, with energies
+ * and angles to the normal drawn from the table. They start just inside
+ * the surface and are tracked out into the vacuum as usual; as daughters of
+ * the absorbed photon their first hit gives the hole, in the grain as in
+ * the full physics but at the surface rather than at the depth of the
+ * absorption.
+ *
+ * Photon scattering and fluorescence leaving the grain are not modelled,
+ * and photons of energies without calibration data (see Covers) are left
+ * to the full physics.
+ *
+ * In "calibrate" mode the hits of every event of a full-physics run fill
+ * the table: the path and absorptions of the photons in the grains and,
+ * for events whose primary photon is absorbed in a grain, the electrons
+ * that leave a grain after being created in it. The table accumulates over
+ * the runs and is written at the end of each run; calibration runs should
+ * not use /biasing/skin, which changes where the photons are absorbed.
+ *
+ * /surrogate/mode given before /run/initialize registers the fast
+ * simulation of photons, so both modes can then be switched between runs.
+ */
+
+class SurrogateEmissionModel : public G4VFastSimulationModel
+{
+  public:
+
+    explicit SurrogateEmissionModel(G4Region* region);
+   ~SurrogateEmissionModel() override = default;
+
+    /// "off", "calibrate" or "fast"; the first other than "off" registers
+    /// the fast simulation physics, which is only possible in PreInit.
+    static void SetMode(const G4String& mode);
+    static void SetTableFile(const G4String& file) { tableFile_ = file; }
+    /// True once the fast simulation physics is registered.
+    static G4bool IsAvailable() { return physicsRegistered_; }
+
+    /// Region of the grains, created with the first grain volume.
+    static G4Region* GetRegion();
+    /// Grain volumes of a new geometry; the old ones are released before
+    /// the volume store is cleaned.
+    static void ReleaseEnvelopes();
+    static void AddEnvelope(G4LogicalVolume* volume);
+    /// Union of the grains in world coordinates, for the calibration.
+    static void SetGrains(const G4VSolid* grains) { grains_ = grains; }
+
+    /// Load the table for "fast" mode (master, before a run).
+    static void BeginRun();
+    /// Write the table in "calibrate" mode (master, after a run).
+    static void EndRun();
+    /// Tally the hits of an event in "calibrate" mode.
+    static void Calibrate(const std::vector<SensitiveDetectorHit*>& hits);
+
+    G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+    G4bool ModelTrigger(const G4FastTrack& fastTrack) override;
+    void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) override;
+
+  private:
+
+    enum Mode { kOff, kCalibrate, kFast };
+
+    static Mode mode_;
+    static G4String tableFile_;
+    static G4bool physicsRegistered_;
+    static const G4VSolid* grains_;
+    // table sampled in "fast" mode, read-only during a run
+    static SurrogateEmissionTable table_;
+    static G4String loadedFile_;
+    // tallies of "calibrate" mode, filled by all threads
+    static SurrogateEmissionTable calibration_;
+    static std::mutex mutex_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
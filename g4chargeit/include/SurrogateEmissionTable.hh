@@ -0,0 +1,118 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SurrogateEmissionTable.hh
+/// \brief Definition of the SurrogateEmissionTable class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef SurrogateEmissionTable_h
+#define SurrogateEmissionTable_h 1
+
+#include "globals.hh"
+
+#include <utility>
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Photoemission of the grains tabulated from full-physics runs.
+/** Per photon energy bin (logarithmic, 1 eV to 100 keV) the table holds
+ *  - the path of the photons in the grains and the number absorbed there,
+ *    whose ratio is the absorption coefficient;
+ *  - per depth of the absorption below the surface (logarithmic, 0.1 nm to
+ *    100 um) the absorptions and the electrons that left the grain, whose
+ *    ratio is the electron yield;
+ *  - the spectrum of these electrons (logarithmic, 0.1 eV to 100 keV) and
+ *    the cosine of their angle to the outward surface normal.
+ *
+ * The calibration fills the tallies (Add...); the surrogate model samples
+ * from the table read back from the file (Read), which only keeps the
+ * photon energies with data in every tally (Covers).
+ */
+
+class SurrogateEmissionTable
+{
+  public:
+
+    static constexpr G4int kPhotonBins = 50;
+    static constexpr G4int kDepthBins = 31;    // bin 0 holds depths below 0.1 nm
+    static constexpr G4int kElectronBins = 60;
+    static constexpr G4int kCosineBins = 20;
+
+    SurrogateEmissionTable();
+
+    void Clear();
+
+    /// Path of a photon in a grain.
+    void AddPath(G4double energy, G4double length);
+    /// Photon absorbed in a grain.
+    void AddAbsorption(G4double energy);
+    /// Electrons (energy, cosine to the surface normal) that left the grain
+    /// after the absorption of a photon at the given depth.
+    void AddEmission(G4double energy, G4double depth,
+                     const std::vector<std::pair<G4double, G4double>>& electrons);
+
+    G4bool Write(const G4String& file) const;
+    G4bool Read(const G4String& file);
+
+    /// True if the photon energy has data for the surrogate.
+    G4bool Covers(G4double energy) const;
+    /// Absorption coefficient (1/length) of photons of this energy.
+    G4double Absorption(G4double energy) const;
+    /// Mean number of electrons leaving the grain per absorbed photon.
+    G4double Yield(G4double energy, G4double depth) const;
+    G4double SampleElectronEnergy(G4double energy) const;
+    G4double SampleCosine(G4double energy) const;
+
+    G4double GetAbsorptions() const;
+    G4double GetElectrons() const;
+
+  private:
+
+    static G4int PhotonBin(G4double energy);
+    static G4int DepthBin(G4double depth);
+    static G4int ElectronBin(G4double energy);
+    // bin drawn from a histogram by its cumulative sums
+    static G4int Sample(const G4double* cumulative, G4int bins);
+    void Accumulate();
+
+    std::vector<G4double> path_;        // mm
+    std::vector<G4double> absorbed_;
+    std::vector<G4double> emitting_;    // absorptions by depth
+    std::vector<G4double> escaped_;     // electrons by depth
+    std::vector<G4double> electrons_;   // electrons by energy
+    std::vector<G4double> cosines_;     // electrons by cosine
+    // cumulative sums of the spectra and angles, per photon energy
+    std::vector<G4double> electronSums_;
+    std::vector<G4double> cosineSums_;
+    std::vector<char> covered_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
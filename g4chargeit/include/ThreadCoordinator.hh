@@ -0,0 +1,108 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ThreadCoordinator.hh
+/// \brief Definition of the ThreadCoordinator class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef ThreadCoordinator_h
+#define ThreadCoordinator_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+/// Hands the cores of the node to one parallel runtime at a time.
+/** The field map precomputation runs OpenMP regions on the master thread,
+ * while events are tracked by the Geant4 worker threads. The two phases
+ * never overlap, so instead of sharing one pool the coordinator gives all
+ * cores to OpenMP while the map is built (BeginPrecompute) and limits
+ * OpenMP to a single thread while the workers track (BeginTracking), which
+ * avoids running a full OpenMP team next to a full set of workers.
+ *
+ * Every phase also records wall clock and process CPU time (all threads),
+ * and PrintReport shows how well each phase kept the cores busy.
+ * Only the master thread calls these methods.
+ */
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class ThreadCoordinator
+{
+  public:
+
+    /// Get instance of the coordinator
+    static ThreadCoordinator* GetInstance();
+
+    /// Cores reserved for the job and Geant4 worker threads (1 = sequential).
+    void SetCores(G4int cores, G4int workerThreads);
+    G4int GetCores() const { return cores_; };
+
+    /// Field map precomputation: every core goes to OpenMP.
+    void BeginPrecompute();
+    void EndPrecompute() { EndPhase(); };
+
+    /// Event processing: the cores go to the Geant4 workers.
+    void BeginTracking();
+    void EndTracking() { EndPhase(); };
+
+    /// Print wall time, CPU time and core utilization per phase.
+    void PrintReport() const;
+
+  private:
+
+    ThreadCoordinator();
+   ~ThreadCoordinator() {};
+
+    struct Phase
+    {
+      G4String name;
+      G4int threads = 0;
+      G4int calls = 0;
+      G4double wall = 0.;  // s
+      G4double cpu = 0.;   // s, summed over all threads
+    };
+
+    void BeginPhase(const G4String& name, G4int threads);
+    void EndPhase();
+    static G4double ProcessCPUTime();
+    static G4double WallTime();
+
+    static ThreadCoordinator* singletonInstance_;
+
+    G4int cores_;
+    G4int workerThreads_;
+    std::vector<Phase> phases_;
+    G4int current_;
+    G4double startWall_;
+    G4double startCPU_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,96 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrackFieldManager.hh
+/// \brief Definition of the TrackFieldManager class
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef TrackFieldManager_h
+#define TrackFieldManager_h 1
+
+#include "G4FieldManager.hh"
+
+class AdaptiveSumRadialFieldMap;
+class G4Track;
+
+/// Field manager that sets the propagation accuracy per track.
+/** G4Transportation calls ConfigureForTrack before every step. The kinetic
+ * energy of the track is compared with the most energy its charge can gain
+ * or lose in the map, |q| times AdaptiveSumRadialFieldMap::GetPotentialRange:
+ *
+ *  - above bypassRatio times that: the field is detached and the track
+ *    moves on straight lines (deflection below about 1/bypassRatio rad);
+ *  - above relaxRatio times that: the chord and epsilon limits are
+ *    loosened by kRelaxFactor;
+ *  - otherwise (slow electrons): the tight limits given to SetAccuracy.
+ *
+ * A ratio of zero disables its test. The configuration only changes when
+ * the class of the track does, so consecutive steps of a track cost one
+ * comparison.
+ */
+
+class TrackFieldManager : public G4FieldManager
+{
+  public:
+
+    TrackFieldManager() = default;
+   ~TrackFieldManager() override = default;
+
+    void ConfigureForTrack(const G4Track* track) override;
+
+    /// Attach a (rebuilt) field map and take its potential range.
+    void SetFieldMap(AdaptiveSumRadialFieldMap* fieldMap);
+    /// Limits applied to tracks that are neither bypassed nor relaxed.
+    void SetAccuracy(G4double deltaOneStep, G4double minEpsilon, G4double maxEpsilon);
+    void SetEnergyRatios(G4double bypassRatio, G4double relaxRatio);
+    /// Steps of charged tracks with the field attached on the calling
+    /// thread since the last call.
+    static G4long TakeFieldStepCount();
+
+    static constexpr G4double kRelaxFactor = 10.;
+
+  private:
+
+    enum Mode { kTight, kRelaxed, kBypass };
+    void Apply(Mode mode);
+
+    AdaptiveSumRadialFieldMap* fieldMap_ = nullptr;
+    G4double potentialRange_ = 0.;
+    G4double bypassRatio_ = 0.;
+    G4double relaxRatio_ = 0.;
+    G4double deltaOneStep_ = 0.;
+    G4double minEpsilon_ = 0.;
+    G4double maxEpsilon_ = 0.;
+    Mode mode_ = kTight;
+
+    static G4ThreadLocal G4long fieldSteps_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
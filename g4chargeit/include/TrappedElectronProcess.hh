@@ -0,0 +1,122 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrappedElectronProcess.hh
+/// \brief Definition of the TrappedElectronProcess and
+///        TrappedElectronPhysics classes
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef TrappedElectronProcess_h
+#define TrappedElectronProcess_h 1
+
+#include "G4ThreeVector.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "G4VProcess.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Stops electrons in the grains that cannot reach a grain surface.
+/** An electron inside a grain whose CSDA range (/process/eLoss/CSDARange 1)
+ * is shorter than its distance to the surface ends up as an electron
+ * charge at some point within that range, whatever its remaining cascade.
+ * The process stops such an electron where it is, depositing its kinetic
+ * energy locally; the zero post-step energy in the grain makes its hit a
+ * stopped electron, as at the end of a fully tracked cascade.
+ *
+ * The range gets a margin for the range straggling. Only electrons below a
+ * maximum energy are considered, so fluorescence of the silicon K shell
+ * (above 1.84 keV), which can leave the grain, is still produced.
+ *
+ * The distance to the surface is that of the grain solid (DistanceToOut(p));
+ * it is recomputed only when the bound from the previous step of the track
+ * (the distance changes by at most the displacement) cannot decide.
+ */
+
+class TrappedElectronProcess : public G4VProcess
+{
+  public:
+
+    explicit TrappedElectronProcess(const G4String& processName = "eTrap");
+   ~TrappedElectronProcess() override = default;
+
+    /// Shared by all threads, set between runs.
+    static void SetEnabled(G4bool value) { enabled_ = value; }
+    static void SetMaxEnergy(G4double value) { maxEnergy_ = value; }
+
+    G4bool IsApplicable(const G4ParticleDefinition& particle) override;
+    void StartTracking(G4Track* track) override;
+
+    G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                  G4double previousStepSize,
+                                                  G4ForceCondition* condition) override;
+    G4VParticleChange* PostStepDoIt(const G4Track& track, const G4Step& step) override;
+
+    // not an along-step or at-rest process
+    G4double AlongStepGetPhysicalInteractionLength(const G4Track&, G4double, G4double,
+                                                   G4double&, G4GPILSelection*) override
+    { return -1.0; }
+    G4double AtRestGetPhysicalInteractionLength(const G4Track&, G4ForceCondition*) override
+    { return -1.0; }
+    G4VParticleChange* AlongStepDoIt(const G4Track&, const G4Step&) override { return nullptr; }
+    G4VParticleChange* AtRestDoIt(const G4Track&, const G4Step&) override { return nullptr; }
+
+  private:
+
+    // true when the track cannot leave its grain
+    G4bool IsTrapped(const G4Track& track);
+
+    // distance to the surface at the last evaluation, for the bound
+    G4bool lastValid_;
+    G4ThreeVector lastPosition_;
+    G4double lastDistance_;
+
+    static G4bool enabled_;
+    static G4double maxEnergy_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Registers a TrappedElectronProcess for electrons; it stays inactive
+/// until /charging/trapElectrons is set.
+
+class TrappedElectronPhysics : public G4VPhysicsConstructor
+{
+  public:
+
+    explicit TrappedElectronPhysics(const G4String& name = "TrappedElectrons");
+   ~TrappedElectronPhysics() override = default;
+
+  protected:
+
+    void ConstructParticle() override {}
+    void ConstructProcess() override;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,123 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file WorldPeriodicBoundaryProcess.hh
+/// \brief Definition of the WorldPeriodicBoundaryProcess and
+///        WorldPeriodicBoundaryPhysics classes
+//
+//
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#ifndef WorldPeriodicBoundaryProcess_h
+#define WorldPeriodicBoundaryProcess_h 1
+
+#include "G4PeriodicBoundaryProcess.hh"
+#include "G4VPhysicsConstructor.hh"
+
+/// Steps seen and forced by the periodic boundary, summed per thread and
+/// merged per run.
+struct PeriodicStatistics
+{
+    G4long steps = 0;      // steps in the world volume
+    G4long forced = 0;     // of them, with the DoIt forced
+    G4long limited = 0;    // of them, ended short of a periodic face by the process
+
+    PeriodicStatistics& operator+=(const PeriodicStatistics& other);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Periodic boundary process that is only invoked where it can act.
+/** G4PeriodicBoundaryProcess returns a Forced condition from every
+ * GetMeanFreePath call, so its PostStepDoIt (and the particle change
+ * bookkeeping of the stepping manager) runs for every step of every track,
+ * although it only acts on steps that end on a periodic face of the world.
+ *
+ * The condition is chosen before the step from a cheap geometric test:
+ *  - a step that starts inside a daughter volume (a grain) ends on that
+ *    daughter's surface at the latest, the process stays inactive;
+ *  - a neutral track in the world moves on a straight line, it is forced
+ *    only when that line leaves the world box through a periodic face;
+ *  - a charged track in the field may curve, but no step shorter than its
+ *    distance to the nearest periodic face can end on one. The process
+ *    limits the step just short of that distance instead of forcing, and
+ *    forces the step after one it limited, so a track heading for a face
+ *    takes one extra step at most per approach.
+ * Within a nanometre of a periodic face every step is forced.
+ * The g4pbc PostStepDoIt is unchanged. The counts of forced and limited
+ * steps are printed at the end of the run (TakeStatistics).
+ */
+
+class WorldPeriodicBoundaryProcess : public G4PeriodicBoundaryProcess
+{
+  public:
+
+    WorldPeriodicBoundaryProcess(const G4String& processName = "CycBoundary",
+                                 G4bool periodicX = true, G4bool periodicY = true,
+                                 G4bool periodicZ = false, G4bool reflectingWalls = false);
+   ~WorldPeriodicBoundaryProcess() override = default;
+
+    G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                  G4double previousStepSize,
+                                                  G4ForceCondition* condition) override;
+
+    /// Counts of this thread since the last call (Run::RecordEvent).
+    static PeriodicStatistics TakeStatistics();
+
+  private:
+
+    G4bool periodicX_, periodicY_, periodicZ_;
+    static G4ThreadLocal PeriodicStatistics statistics_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Drop-in replacement of G4PeriodicBoundaryPhysics that registers a
+/// WorldPeriodicBoundaryProcess for every applicable particle.
+
+class WorldPeriodicBoundaryPhysics : public G4VPhysicsConstructor
+{
+  public:
+
+    WorldPeriodicBoundaryPhysics(const G4String& name = "Periodic",
+                                 G4bool periodicX = true, G4bool periodicY = true,
+                                 G4bool periodicZ = false, G4bool reflectingWalls = false);
+   ~WorldPeriodicBoundaryPhysics() override = default;
+
+  protected:
+
+    void ConstructParticle() override {}
+    void ConstructProcess() override;
+
+  private:
+
+    G4bool periodicX_, periodicY_, periodicZ_;
+    G4bool reflectingWalls_;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
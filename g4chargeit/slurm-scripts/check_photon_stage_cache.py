@@ -0,0 +1,51 @@
+import sys
+import numpy as np
+
+from shared_utils import read_rootfile, weighted_count
+
+# Compares the charges of a run that recorded the photon stage with those of
+# its replay (test-macros/benchmark-cache.mac), using the selection of
+# ChargeCollector. The holes are the electrons released by the primaries,
+# which the replay reproduces exactly for photon sources; the stopped
+# electrons are tracked again and agree within their statistical spread.
+
+if len(sys.argv) < 3:
+    print("Usage: python check_photon_stage_cache.py <record.root> <replay.root> [primaries_per_event]")
+    print("Example: python check_photon_stage_cache.py bench-cache-record.root bench-cache-replay.root")
+    sys.exit(1)
+
+record_file = sys.argv[1]
+replay_file = sys.argv[2]
+primaries_per_event = int(sys.argv[3]) if len(sys.argv) >= 4 else 1
+
+
+def charge_counts(root_file):
+    df = read_rootfile(root_file)
+    electrons = df[df["Particle_Type"] == "e-"]
+    stopped = electrons[(electrons["Kinetic_Energy_Post_MeV"] == 0.0)
+                        & ((electrons["Volume_Name_Post"] == "SiO2")
+                           | (electrons["Process_Name_Post"] == "Looper"))]
+    holes = electrons[(electrons["Parent_ID"] >= 1)
+                      & (electrons["Parent_ID"] <= primaries_per_event)
+                      & (electrons["Process_Name_Pre"] == "initStep")]
+    return weighted_count(holes), weighted_count(stopped)
+
+
+record_holes, record_electrons = charge_counts(record_file)
+replay_holes, replay_electrons = charge_counts(replay_file)
+print(f"Holes:     record {record_holes}, replay {replay_holes}")
+print(f"Electrons: record {record_electrons}, replay {replay_electrons}")
+
+failed = False
+if not np.isclose(record_holes, replay_holes):
+    print("FAIL: the replay does not reproduce the holes of the recording")
+    failed = True
+# independent Poisson counts: 4 standard deviations of their difference
+tolerance = 4.0*np.sqrt(record_electrons + replay_electrons + 1.0)
+if abs(record_electrons - replay_electrons) > tolerance:
+    print(f"FAIL: the stopped electrons differ by more than {tolerance:.1f}")
+    failed = True
+
+if failed:
+    sys.exit(1)
+print("OK")
@@ -0,0 +1,45 @@
+import sys
+import numpy as np
+
+from shared_utils import read_rootfile, weighted_count
+
+# Compares the holes of a surrogate calibration run with those of the fast
+# run sampling its table (test-macros/benchmark-surrogate.mac), using the
+# selection of ChargeCollector. With the full physics every hole is left in
+# the grain the electron was created in; the fast model starts its electrons
+# just inside the surface, so its holes must lie in the grains as well. The
+# counts differ by design: the fast model only emits the electrons that
+# escape, the full physics also creates those that stop in the grain again.
+
+if len(sys.argv) < 3:
+    print("Usage: python check_surrogate_holes.py <calibrate.root> <fast.root> [primaries_per_event]")
+    print("Example: python check_surrogate_holes.py bench-surrogate-calibrate.root bench-surrogate-fast.root")
+    sys.exit(1)
+
+calibrate_file = sys.argv[1]
+fast_file = sys.argv[2]
+primaries_per_event = int(sys.argv[3]) if len(sys.argv) >= 4 else 1
+
+
+def hole_counts(root_file):
+    df = read_rootfile(root_file)
+    electrons = df[df["Particle_Type"] == "e-"]
+    holes = electrons[(electrons["Parent_ID"] >= 1)
+                      & (electrons["Parent_ID"] <= primaries_per_event)
+                      & (electrons["Process_Name_Pre"] == "initStep")]
+    in_grains = holes[holes["Volume_Name_Pre"] == "SiO2"]
+    return weighted_count(holes), weighted_count(in_grains)
+
+
+calibrate_holes, calibrate_in_grains = hole_counts(calibrate_file)
+fast_holes, fast_in_grains = hole_counts(fast_file)
+print(f"Holes:     calibrate {calibrate_holes}, fast {fast_holes}")
+print(f"In grains: calibrate {calibrate_in_grains}, fast {fast_in_grains}")
+
+if fast_holes == 0:
+    print("FAIL: the fast run released no electrons")
+    sys.exit(1)
+if not np.isclose(fast_in_grains, fast_holes):
+    print(f"FAIL: {fast_holes - fast_in_grains} holes of the fast run lie outside the grains")
+    sys.exit(1)
+print("OK")
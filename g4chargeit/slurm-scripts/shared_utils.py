@@ -3,6 +3,7 @@ Shared utility functions for Geant4 charging simulation scripts.
 """
 
 import os
+import json
 import shutil
 import numpy as np
 import pandas as pd
@@ -23,6 +24,56 @@ def reset_folder(folder_path):
     os.makedirs(folder_path, exist_ok=True)
 
 
+def column_directory(file_path):
+    """Return the binary column directory written for a ROOT output name, or None."""
+    base = file_path[:-len(".root")] if file_path.endswith(".root") else file_path
+    directory = base if base.endswith(".cols") else base + ".cols"
+    return directory if os.path.isdir(directory) else None
+
+
+def read_columnfile(directory, columns=None):
+    """
+    Memory-map the binary hit columns written with /geometry/rootoutput/format binary.
+
+    Parameters:
+        directory : str
+            Column directory (<output>.cols) containing header.json.
+        columns : list of str, optional
+            Columns to map. If None, maps all columns.
+
+    Returns:
+        dict of numpy.memmap
+            Strings are fixed-width bytes (dtype S32); positions have shape (rows, 3).
+    """
+    with open(os.path.join(directory, "header.json")) as f:
+        header = json.load(f)
+
+    rows = header["rows"]
+    arrays = {}
+    for column in header["columns"]:
+        if columns is not None and column["name"] not in columns:
+            continue
+        shape = (rows, *column["shape"])
+        if rows == 0:
+            arrays[column["name"]] = np.empty(shape, dtype=column["dtype"])
+        else:
+            arrays[column["name"]] = np.memmap(os.path.join(directory, column["file"]),
+                                               dtype=column["dtype"], mode="r", shape=shape)
+    return arrays
+
+
+def columns_to_dataframe(arrays):
+    """Convert mapped hit columns to the DataFrame layout produced from ROOT files."""
+    data = {}
+    for name, values in arrays.items():
+        if values.dtype.kind == "S":
+            data[name] = np.char.decode(values, "ascii")
+        elif values.ndim == 2:
+            data[name] = list(values)
+        else:
+            data[name] = values
+    return pd.DataFrame(data)
+
 def read_rootfile(file, directory_path=None):
     """
     Read a ROOT file and return a pandas DataFrame.
@@ -42,6 +93,11 @@ def read_rootfile(file, directory_path=None):
     file_path = f"{directory_path}/{file}" if directory_path else file
     tree_name = "Hit Data"
 
+    # Binary column output is read directly when present
+    binary_dir = column_directory(file_path)
+    if binary_dir is not None:
+        return columns_to_dataframe(read_columnfile(binary_dir))
+
     with uproot.open(file_path) as root_file:
         tree = root_file[tree_name]
         branch_names = tree.keys()
@@ -50,6 +106,13 @@ def read_rootfile(file, directory_path=None):
     return pd.DataFrame(branch_vars)
 
 
+def weighted_count(rows):
+    """Number of rows, or the sum of their statistical weights when the output has them."""
+    if "Weight" in rows.columns:
+        return float(rows["Weight"].sum())
+    return rows.shape[0]
+
+
 def get_particle_counts_by_type(root_file, directory_path=None):
     """
     Extract particle counts by type from a ROOT file.
@@ -64,7 +127,7 @@ def get_particle_counts_by_type(root_file, directory_path=None):
     Returns:
     --------
     dict
-        Particle type -> count mapping
+        Particle type -> count mapping (summed weights for biased sources)
     """
     try:
         df = read_rootfile(root_file, directory_path)
@@ -106,14 +169,14 @@ def get_particle_counts_by_type(root_file, directory_path=None):
                 electron_dataframe = df[df["Particle_Type"]=="e-"]
                 last_electron = electron_dataframe.drop_duplicates(subset="Event_Number", keep="last")
                 escaping_electrons = last_electron[(last_electron["Volume_Name_Post"]=="physical_cyclic") | (last_electron["Volume_Name_Pre"]=="physical_cyclic")]
-                counts[particleIN] = escaping_electrons.shape[0]
+                counts[particleIN] = weighted_count(escaping_electrons)
 
 
             else:
                 # if particleIN == "proton":
-                counts[particleIN] = df[
+                counts[particleIN] = weighted_count(df[
                     (df["Particle_Type"] == particleIN) & (df["Parent_ID"] == 0.0) & (df["Volume_Name_Post"]=="SiO2")
-                ].drop_duplicates(subset="Event_Number", keep="first").shape[0]
+                ].drop_duplicates(subset="Event_Number", keep="first"))
                 # else:
                 #     counts[particleIN] = df[
                 #         (df["Particle_Type"] == particleIN) #&
@@ -250,6 +313,49 @@ def write_cad_settings(f, cad_filename, epsilon, pbc=True):
     f.write('#\n')
 
 
+def write_sphere_settings(f, spheres_filename, epsilon, pbc=True):
+    """
+    Write analytic sphere-pack settings, used instead of write_cad_settings.
+    
+    Parameters:
+    -----------
+    f : file object
+        Open file to write to
+    spheres_filename : str
+        Name of the sphere file in geometry/ (see write_sphere_file)
+    epsilon : float
+        Dielectric constant
+    pbc : bool
+        Whether to use periodic boundary conditions
+    """
+    f.write(f'/geometry/spheres/file {spheres_filename}\n')
+    f.write(f'/geometry/epsilon {epsilon}\n')
+    f.write(f'/geometry/PBC {str(pbc).lower()}\n')
+    f.write('/run/initialize\n')
+    f.write('#\n')
+
+
+def write_sphere_file(path, centers, radii):
+    """
+    Write sphere centers and radii for /geometry/spheres/file.
+    
+    Parameters:
+    -----------
+    path : str
+        Output file, normally geometry/<name>.txt
+    centers : array-like, shape (n, 3)
+        Sphere centers in mm (the units of the STL files)
+    radii : float or array-like, shape (n,)
+        Sphere radii in mm
+    """
+    centers = np.asarray(centers, dtype=float).reshape(-1, 3)
+    radii = np.broadcast_to(np.asarray(radii, dtype=float), (len(centers),))
+    with open(path, 'w') as f:
+        f.write('# x y z radius (mm)\n')
+        for (x, y, z), r in zip(centers, radii):
+            f.write(f'{x:.9g} {y:.9g} {z:.9g} {r:.9g}\n')
+
+
 def write_particle_source_electrons(f, electron_energy, cad_dims, z_position):
     """
     Write GPS commands for electron source.
@@ -418,6 +524,46 @@ def write_run_commands(f, event_num, print_progress=5000):
     f.write(f'/run/beamOn {event_num}\n')
 
 
+def write_iterate_commands(f, iterations, event_num, flux=0, reference_particle="proton",
+                           print_progress=5000, target_error=0, max_events=0):
+    """
+    Write commands that run several charging iterations in one process.
+    
+    Replaces write_run_commands; iteration k > 0 writes <output>_it<k>.root.
+    
+    Parameters:
+    -----------
+    f : file object
+        Open file to write to
+    iterations : int
+        Number of iterations
+    event_num : int
+        Number of events per iteration
+    flux : float
+        Flux of the reference particle (e/m²/s) used to derive the iteration
+        time from the simulated counts; 0 keeps /geometry/IterationTime
+    reference_particle : str
+        Particle counted for the iteration time ("proton" or "gamma")
+    print_progress : int
+        How often to print progress
+    target_error : float
+        Relative uncertainty of the deposited charge at which an iteration
+        stops; event_num is then the chunk size and the events run are
+        written to <output>_events.txt. 0 runs event_num events
+    max_events : int
+        Most events of an iteration with target_error (0: 100 chunks)
+    """
+    f.write('#\n')
+    f.write(f'/run/printProgress {print_progress}\n')
+    f.write(f'/charging/events {event_num}\n')
+    if target_error > 0:
+        f.write(f'/charging/targetError {target_error}\n')
+        f.write(f'/charging/maxEvents {max_events}\n')
+    f.write(f'/charging/referenceParticle {reference_particle}\n')
+    f.write(f'/charging/flux {flux}\n')
+    f.write(f'/charging/iterate {iterations}\n')
+
+
 # SLURM batch template
 BATCH_TEMPLATE = """#!/bin/bash
 #SBATCH --job-name=Iteration{iter}_Configuration{config}
@@ -430,13 +576,17 @@ BATCH_TEMPLATE = """#!/bin/bash
 #SBATCH --time=05:00:00
 #SBATCH --output=outputlogs/%A_iteration{iter}_{config}
 
+# idle OpenMP threads sleep instead of spinning next to the Geant4 workers
+export OMP_WAIT_POLICY=passive
+
 echo "Starting iteration{iter} for {config} configuration"
 {run_line}
 date
 """
 
 
-def create_batch_script(batch_path, iteration, config_name, macro_path, account, username):
+def create_batch_script(batch_path, iteration, config_name, macro_path, account, username,
+                        threads=24):
     """
     Create a SLURM batch script.
     
@@ -454,8 +604,10 @@ def create_batch_script(batch_path, iteration, config_name, macro_path, account,
         SLURM account name
     username : str
         Username for email notifications
+    threads : int
+        Number of Geant4 worker threads (1 runs the sequential run manager)
     """
-    cmd = f"./g4chargeit {macro_path}"
+    cmd = f"./g4chargeit {macro_path} {threads}"
     
     with open(batch_path, "w") as f:
         batch_script = BATCH_TEMPLATE.format(
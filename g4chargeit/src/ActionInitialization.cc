@@ -32,6 +32,7 @@
 #include "DetectorConstruction.hh"
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
+#include "StackingAction.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -62,6 +63,9 @@ void ActionInitialization::Build() const
     
   RunAction* runAction = new RunAction(primary);
   SetUserAction(runAction); 
+
+  // records the photon stage for later replay (/source/cache)
+  SetUserAction(new StackingAction());
    
 }  
 
@@ -5,6 +5,7 @@
 #include "G4PhysicalConstants.hh" 
 
 
+#include <cfloat>
 #include <cmath>
 #include <algorithm>
 #include <fstream>
@@ -24,6 +25,8 @@
 static const double epsilon0_SI = 8.8541878128e-12 * farad / meter; // F/m
 static const G4double k_electric = 1.0 / (4.0 * CLHEP::pi * CLHEP::epsilon0);
 
+G4ThreadLocal G4long AdaptiveSumRadialFieldMap::fieldCalls_ = 0;
+
 namespace {
     struct FieldStats {
         double min;
@@ -103,6 +106,87 @@ namespace {
     };
 }
 
+namespace {
+    // Periodic (x/y) summation, see buildLatticeCorrection.
+    const G4double kEwaldWidth = 3.5;         // Ewald splitting parameter times the shorter period
+    const G4double kEwaldCutoff = 11.0;       // reciprocal vectors up to kEwaldCutoff times the splitting parameter
+    const int kLatticeCellsPerPeriod = 16;    // unit-charge kernel table nodes per period in x and y
+    const G4double kLatticeStepT = 0.25;      // table step in asinh(dz/zScale)
+    const G4double kLatticeSourceSize = 0.25; // largest charge node (in periods) taken as one point charge
+    const int kColumnDepth = 2;               // charge octree depth of the columns
+    const int kLatticeColumns = 1 << kColumnDepth; // columns per period in x and y
+    const int kLatticeCellsPerColumn = 8;     // correction table nodes per column in x and y
+
+    struct ReciprocalVector { G4double gx, gy, g; };
+
+    // e^b erfc(x), finite where e^b alone would overflow
+    G4double ExpErfc(G4double b, G4double x) {
+        if (x < 5.0) return std::exp(b) * std::erfc(x);
+        const G4double ix2 = 1.0 / (x * x);
+        return std::exp(b - x * x) / (x * std::sqrt(CLHEP::pi)) * (1.0 - 0.5 * ix2 + 0.75 * ix2 * ix2 - 1.875 * ix2 * ix2 * ix2);
+    }
+
+    // Field and potential at d of a unit charge at the origin repeated with
+    // periods lx, ly (2D Ewald sum, Parry's form), less the direct 1/r of the
+    // nine copies with |i|,|j| <= 1. What is left is smooth for |dx| <= lx,
+    // |dy| <= ly. out = (Ex, Ey, Ez, V) in 1/length^2 and 1/length; the G = 0
+    // term is the field of the charged sheet, 2 pi/(lx ly) on either side.
+    void LatticeRemainder(const G4ThreeVector& d, G4double lx, G4double ly, G4double alpha,
+                          const std::vector<ReciprocalVector>& reciprocal, G4double out[4]) {
+        const G4double sqrtPi = std::sqrt(CLHEP::pi);
+        G4double ex = 0.0, ey = 0.0, ez = 0.0, v = 0.0;
+
+        // real space: screened copies out to the third shell; the nine nearest
+        // enter as erfc - 1 = -erf, which is finite at the origin
+        for (int i = -3; i <= 3; ++i) {
+            for (int j = -3; j <= 3; ++j) {
+                const G4ThreeVector r = d - G4ThreeVector(i * lx, j * ly, 0.0);
+                const G4double s = r.mag();
+                const G4double as = alpha * s;
+                G4double f;
+                if (std::abs(i) <= 1 && std::abs(j) <= 1) {
+                    if (as < 1e-4) {
+                        v -= 2.0 * alpha / sqrtPi * (1.0 - as * as / 3.0);
+                        f = -4.0 * alpha * alpha * alpha / (3.0 * sqrtPi);
+                    } else {
+                        const G4double erf = std::erf(as);
+                        v -= erf / s;
+                        f = -(erf - 2.0 * as / sqrtPi * std::exp(-as * as)) / (s * s * s);
+                    }
+                } else {
+                    const G4double erfc = std::erfc(as);
+                    v += erfc / s;
+                    f = (erfc + 2.0 * as / sqrtPi * std::exp(-as * as)) / (s * s * s);
+                }
+                ex += f * r.x();
+                ey += f * r.y();
+                ez += f * r.z();
+            }
+        }
+
+        // reciprocal space
+        const G4double area = lx * ly;
+        const G4double z = d.z();
+        for (const auto& k : reciprocal) {
+            const G4double a = k.g / (2.0 * alpha);
+            const G4double up = ExpErfc(k.g * z, a + alpha * z);
+            const G4double down = ExpErfc(-k.g * z, a - alpha * z);
+            const G4double phase = k.gx * d.x() + k.gy * d.y();
+            const G4double c = std::cos(phase);
+            const G4double f = CLHEP::pi / area * (up + down) / k.g;
+            v += c * f;
+            ex += k.gx * std::sin(phase) * f;
+            ey += k.gy * std::sin(phase) * f;
+            ez -= CLHEP::pi / area * c * (up - down);
+        }
+        const G4double az = alpha * z;
+        v -= 2.0 * CLHEP::pi / area * (z * std::erf(az) + std::exp(-az * az) / (alpha * sqrtPi));
+        ez += 2.0 * CLHEP::pi / area * std::erf(az);
+
+        out[0] = ex; out[1] = ey; out[2] = ez; out[3] = v;
+    }
+}
+
 
 
 AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
@@ -121,10 +205,11 @@ AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
     int max_depth_param,   
     int initial_depth,
     bool dissipateCharge,       
-    StorageType storage)
+    StorageType storage,
+    bool periodicXY)
     : max_depth_(max_depth_param), minStepSize_(minStep),
       worldMin_(min_bounds), worldMax_(max_bounds), fieldGradThreshold_(gradThreshold), fStorage(storage),dissipateCharge_(dissipateCharge),
-      fPositions(positions), fCharges(charges), fStateFilename(state_filename), initialDepth_(initial_depth), geometry_(geometry), dielectricConstant_(dielectricConstant) // Use references directly
+      fPositions(positions), fCharges(charges), fStateFilename(state_filename), initialDepth_(initial_depth), geometry_(geometry), dielectricConstant_(dielectricConstant), periodicXY_(periodicXY) // Use references directly
 {
 
     LoadPersistentState(fStateFilename, fPositions, fCharges);
@@ -139,6 +224,7 @@ AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
 
     G4cout << "Building initial charge octree..." << G4endl;
     buildChargeOctree(); 
+    buildLatticeCorrection();
 
     auto end_build1 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> duration = end_build1 - start_build1;
@@ -202,11 +288,18 @@ AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
 
     G4cout << "Applying dielectric scaling to final mesh..." << G4endl;
     num_leaves = all_leaves_.size();
+    // zero at infinity; the periodic potential has no such reference
+    G4double potential_min = periodicXY_ ? DBL_MAX : 0.0, potential_max = periodicXY_ ? -DBL_MAX : 0.0;
 
-    #pragma omp parallel for schedule(dynamic)
+    #pragma omp parallel for schedule(dynamic) reduction(min:potential_min) reduction(max:potential_max)
     for (size_t i = 0; i < num_leaves; ++i) { 
         Node* leaf = all_leaves_[i];
         if(leaf) {
+            // vacuum potential, for the energy scale of the tracks (GetPotentialRange)
+            G4double potential = computePotentialFromCharges(leaf->center);
+            potential_min = std::min(potential_min, potential);
+            potential_max = std::max(potential_max, potential);
+
             // Check boundary overlap for this specific leaf
             double half_width = (leaf->max.x() - leaf->min.x()) * 0.5;
             double f = GetDielectricFraction(leaf->center, half_width);
@@ -219,6 +312,9 @@ AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
         }
     }
 
+    potentialRange_ = potential_max - potential_min;
+    G4cout << "   --> Potential range over the mesh: " << G4BestUnit(potentialRange_,"Electric potential") << G4endl;
+
     G4cout << "   --> Saving refined field to " <<filename << G4endl;
     if (!filename.empty()) {
         ExportFieldMapToFile(filename);
@@ -231,6 +327,30 @@ AdaptiveSumRadialFieldMap::AdaptiveSumRadialFieldMap(
 AdaptiveSumRadialFieldMap::~AdaptiveSumRadialFieldMap() {
 }
 
+void AdaptiveSumRadialFieldMap::SetDielectricConstant(G4double dielectricConstant)
+{
+    if (dielectricConstant == dielectricConstant_) return;
+
+    G4cout << "Rescaling final mesh for dielectric constant " << dielectricConstant << "..." << G4endl;
+    const size_t num_leaves = all_leaves_.size();
+
+    // undo the old scaling and apply the new one: E * eps_eff_old / eps_eff_new
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < num_leaves; ++i) {
+        Node* leaf = all_leaves_[i];
+        if (!leaf) continue;
+        double half_width = (leaf->max.x() - leaf->min.x()) * 0.5;
+        double f = GetDielectricFraction(leaf->center, half_width);
+        if (f > 0.0) {
+            double epsilon_eff_old = 1.0 / ( (1.0 - f) + (f / dielectricConstant_) );
+            double epsilon_eff_new = 1.0 / ( (1.0 - f) + (f / dielectricConstant) );
+            leaf->precomputed_field = leaf->precomputed_field * (epsilon_eff_old / epsilon_eff_new);
+        }
+    }
+
+    dielectricConstant_ = dielectricConstant;
+}
+
 void AdaptiveSumRadialFieldMap::LoadPersistentState(const std::string& filename,
                                                     std::vector<G4ThreeVector>& positions,
                                                     std::vector<G4double>& charges)
@@ -574,7 +694,273 @@ G4ThreeVector AdaptiveSumRadialFieldMap::computeFieldWithApproximation(
 }
 
 
-G4ThreeVector AdaptiveSumRadialFieldMap::computeFieldFromCharges(const G4ThreeVector& point) const { if (!charge_root_) return G4ThreeVector(0,0,0); G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box); return computeFieldWithApproximation(point, charge_root_.get(), min_box, max_box); }
+G4double AdaptiveSumRadialFieldMap::computePotentialWithApproximation(
+    const G4ThreeVector& point, 
+    const ChargeNode* node, 
+    const G4ThreeVector& node_min, 
+    const G4ThreeVector& node_max) const 
+{
+    // same tree walk and softening as computeFieldWithApproximation
+    if (!node || std::abs(node->total_charge) < 1e-25 * CLHEP::coulomb) return 0.0;
+
+    if (node->particle_index == -2) { // aggregated node
+        G4double r2 = (point - node->center_of_mass).mag2() + (1.0*nm)*(1.0*nm);
+        return node->total_charge * k_electric / std::sqrt(r2);
+    }
+
+    G4double d2 = (point - node->center_of_mass).mag2();
+    const G4double softening_factor_sq = minStepSize_*minStepSize_;
+    if (d2 < softening_factor_sq) d2 = softening_factor_sq;
+    G4double distance = std::sqrt(d2);
+
+    if (node->is_leaf) {
+        return (node->particle_index != -1) ? node->total_charge * k_electric / distance : 0.0;
+    }
+
+    double width = (node_max.x() - node_min.x());
+    if (width / distance < barnes_hut_theta_) {
+        return node->total_charge * k_electric / distance;
+    }
+
+    G4double V_total = 0.0;
+    G4ThreeVector center = (node_min + node_max) * 0.5;
+    for(int i = 0; i < 8; ++i) {
+        if(node->children[i]) {
+            G4ThreeVector c_min, c_max;
+            calculateChildBounds(node_min, node_max, center, i, c_min, c_max);
+            V_total += computePotentialWithApproximation(point, node->children[i].get(), c_min, c_max);
+        }
+    }
+    return V_total;
+}
+
+G4double AdaptiveSumRadialFieldMap::computePotentialFromCharges(const G4ThreeVector& point) const {
+    if (!charge_root_) return 0.0;
+    G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box);
+    if (!periodicXY_) return computePotentialWithApproximation(point, charge_root_.get(), min_box, max_box);
+
+    // the columns around the point through the tree, everything else from the table
+    const int column = columnOf(point);
+    G4double V = 0.0;
+    sumColumnImages(point, column, true, nullptr, &V);
+    G4double correction[4]; columnCorrection_[column].Interpolate(point, correction);
+    return V + correction[3];
+}
+
+G4ThreeVector AdaptiveSumRadialFieldMap::computeFieldFromCharges(const G4ThreeVector& point) const {
+    if (!charge_root_) return G4ThreeVector(0,0,0);
+    G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box);
+    if (!periodicXY_) return computeFieldWithApproximation(point, charge_root_.get(), min_box, max_box);
+
+    const int column = columnOf(point);
+    G4ThreeVector E(0,0,0);
+    sumColumnImages(point, column, true, &E, nullptr);
+    G4double correction[4]; columnCorrection_[column].Interpolate(point, correction);
+    return E + G4ThreeVector(correction[0], correction[1], correction[2]);
+}
+
+int AdaptiveSumRadialFieldMap::columnOf(const G4ThreeVector& point) const {
+    G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box);
+    const int cx = static_cast<int>(std::floor((point.x() - min_box.x()) / (max_box.x() - min_box.x()) * kLatticeColumns));
+    const int cy = static_cast<int>(std::floor((point.y() - min_box.y()) / (max_box.y() - min_box.y()) * kLatticeColumns));
+    return std::clamp(cy, 0, kLatticeColumns - 1) * kLatticeColumns + std::clamp(cx, 0, kLatticeColumns - 1);
+}
+
+void AdaptiveSumRadialFieldMap::sumColumnImages(const G4ThreeVector& point, int column, bool near,
+                                                G4ThreeVector* field, G4double* potential) const {
+    G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box);
+    const G4double lx = max_box.x() - min_box.x(), ly = max_box.y() - min_box.y();
+    // column c of the image moved by (i lx, j ly), evaluated as column c at the point moved back
+    auto walk = [&](int c, int i, int j) {
+        const G4ThreeVector shifted = point - G4ThreeVector(i*lx, j*ly, 0);
+        for (const auto& entry : columnNodes_[c]) {
+            if (field) *field += computeFieldWithApproximation(shifted, entry.node, entry.min, entry.max);
+            if (potential) *potential += computePotentialWithApproximation(shifted, entry.node, entry.min, entry.max);
+        }
+    };
+    const int cx = column % kLatticeColumns, cy = column / kLatticeColumns;
+    for (int i = -1; i <= 1; ++i) {
+        for (int j = -1; j <= 1; ++j) {
+            if (near) {
+                // the neighbour column, wrapped into the cell at its edges
+                const int x = cx + i, y = cy + j;
+                const int wx = (x < 0) ? -1 : (x >= kLatticeColumns ? 1 : 0), wy = (y < 0) ? -1 : (y >= kLatticeColumns ? 1 : 0);
+                walk((y - wy*kLatticeColumns) * kLatticeColumns + x - wx*kLatticeColumns, wx, wy);
+                continue;
+            }
+            for (int c = 0; c < kLatticeColumns * kLatticeColumns; ++c) {
+                const bool adjacent = std::abs(c % kLatticeColumns + i*kLatticeColumns - cx) <= 1 &&
+                                      std::abs(c / kLatticeColumns + j*kLatticeColumns - cy) <= 1;
+                if (!adjacent) walk(c, i, j);
+            }
+        }
+    }
+}
+
+void AdaptiveSumRadialFieldMap::collectColumnNodes(const ChargeNode* node, const G4ThreeVector& node_min,
+                                                   const G4ThreeVector& node_max, int depth) {
+    if (!node) return;
+    // a shallow leaf holds a single charge and belongs to the column of that charge
+    if (node->is_leaf || depth == kColumnDepth) {
+        columnNodes_[columnOf(node->is_leaf ? node->center_of_mass : (node_min + node_max) * 0.5)].push_back({node, node_min, node_max});
+        return;
+    }
+    const G4ThreeVector center = (node_min + node_max) * 0.5;
+    for (int i = 0; i < 8; ++i) {
+        if (node->children[i]) {
+            G4ThreeVector c_min, c_max;
+            calculateChildBounds(node_min, node_max, center, i, c_min, c_max);
+            collectColumnNodes(node->children[i].get(), c_min, c_max, depth + 1);
+        }
+    }
+}
+
+// The cell is cut into kLatticeColumns x kLatticeColumns columns, which are
+// the charge octree nodes at depth kColumnDepth. For a point in one column,
+// the charges of the 3x3 columns around it (taken from the neighbour images
+// at the cell edges) are walked directly; the rest is smooth over the column
+// and is tabulated per column:
+// - the other columns of the cell and of its eight neighbour images, walked
+//   at the table nodes;
+// - all farther images: for a unit charge their sum (LatticeRemainder) only
+//   depends on the displacement and is smooth, so it is tabulated once over
+//   displacements within one period and applied to the charge octree cut
+//   into nodes of at most kLatticeSourceSize periods.
+// An evaluation then walks 9 of the 16 columns of one cell, no more than the
+// open-boundary walk of the whole cell, plus one table lookup.
+void AdaptiveSumRadialFieldMap::buildLatticeCorrection() {
+    columnNodes_.assign(kLatticeColumns * kLatticeColumns, {});
+    columnCorrection_.clear();
+    if (!periodicXY_ || !charge_root_) return;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    G4ThreeVector min_box, max_box; calculateBoundingBox(min_box, max_box);
+    const G4ThreeVector size = max_box - min_box;
+    const G4double period = std::min(size.x(), size.y());
+    const G4double alpha = kEwaldWidth / period;
+
+    std::vector<ReciprocalVector> reciprocal;
+    const G4double g_max = kEwaldCutoff * alpha;
+    const int mx = static_cast<int>(g_max * size.x() / CLHEP::twopi), my = static_cast<int>(g_max * size.y() / CLHEP::twopi);
+    for (int i = -mx; i <= mx; ++i) {
+        for (int j = -my; j <= my; ++j) {
+            const G4double gx = CLHEP::twopi * i / size.x(), gy = CLHEP::twopi * j / size.y();
+            const G4double g = std::sqrt(gx*gx + gy*gy);
+            if ((i != 0 || j != 0) && g <= g_max) reciprocal.push_back({gx, gy, g});
+        }
+    }
+
+    std::vector<std::pair<G4ThreeVector, G4double>> sources;
+    collectLatticeSources(charge_root_.get(), min_box, max_box, kLatticeSourceSize * period, sources);
+    collectColumnNodes(charge_root_.get(), min_box, max_box, 0);
+
+    // the z grid is finest around the charges
+    G4double z_center = 0.0, abs_charge = 0.0;
+    for (const auto& source : sources) { z_center += std::abs(source.second) * source.first.z(); abs_charge += std::abs(source.second); }
+    z_center = (abs_charge > 0.0) ? z_center / abs_charge : 0.5 * (min_box.z() + max_box.z());
+
+    // unit-charge remainder over displacements
+    LatticeTable kernel;
+    kernel.Define(-1.0 * size, size, 2 * kLatticeCellsPerPeriod, 0.0, period / (kLatticeCellsPerPeriod * kLatticeStepT), kLatticeStepT);
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int k = 0; k < kernel.nz; ++k) {
+        for (int j = 0; j < kernel.ny; ++j) {
+            for (int i = 0; i < kernel.nx; ++i) {
+                LatticeRemainder(kernel.NodePosition(i, j, k), size.x(), size.y(), alpha, reciprocal, kernel.Node(i, j, k));
+            }
+        }
+    }
+
+    // correction of all charges outside the walked columns, per column
+    const int columns = kLatticeColumns * kLatticeColumns;
+    const G4double z_scale = period / (kLatticeColumns * kLatticeCellsPerColumn * kLatticeStepT);
+    columnCorrection_.resize(columns);
+    for (int c = 0; c < columns; ++c) {
+        const G4ThreeVector column_min(min_box.x() + (c % kLatticeColumns) * size.x() / kLatticeColumns,
+                                       min_box.y() + (c / kLatticeColumns) * size.y() / kLatticeColumns, min_box.z());
+        const G4ThreeVector column_max(column_min.x() + size.x() / kLatticeColumns, column_min.y() + size.y() / kLatticeColumns, max_box.z());
+        columnCorrection_[c].Define(column_min, column_max, kLatticeCellsPerColumn, z_center, z_scale, kLatticeStepT);
+    }
+    const int nz = columnCorrection_[0].nz;
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int c = 0; c < columns; ++c) {
+        for (int k = 0; k < nz; ++k) {
+            LatticeTable& table = columnCorrection_[c];
+            for (int j = 0; j < table.ny; ++j) {
+                G4double* node = table.Node(0, j, k);
+                for (int i = 0; i < table.nx; ++i, node += 4) {
+                    const G4ThreeVector r = table.NodePosition(i, j, k);
+                    for (const auto& source : sources) {
+                        G4double unit[4]; kernel.Interpolate(r - source.first, unit);
+                        for (int n = 0; n < 4; ++n) node[n] += source.second * k_electric * unit[n];
+                    }
+                    G4ThreeVector E(0,0,0); G4double V = 0.0;
+                    sumColumnImages(r, c, false, &E, &V);
+                    node[0] += E.x(); node[1] += E.y(); node[2] += E.z(); node[3] += V;
+                }
+            }
+        }
+    }
+
+    std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+    const LatticeTable& table = columnCorrection_[0];
+    G4cout << "   Periodic x/y images: " << sources.size() << " source nodes, " << reciprocal.size()
+           << " reciprocal vectors, " << columns << " columns with " << table.nx << "x" << table.ny << "x" << table.nz
+           << " correction grids (time: " << duration.count() << " s)" << G4endl;
+}
+
+void AdaptiveSumRadialFieldMap::collectLatticeSources(const ChargeNode* node, const G4ThreeVector& node_min, const G4ThreeVector& node_max,
+                                                      G4double max_extent, std::vector<std::pair<G4ThreeVector, G4double>>& sources) const {
+    if (!node) return;
+    const G4ThreeVector extent = node_max - node_min;
+    // only small nodes are tested for charge: a neutral large node (the root
+    // of a neutral sample) still holds charges worth descending to
+    if (node->is_leaf || std::max({extent.x(), extent.y(), extent.z()}) <= max_extent) {
+        if (std::abs(node->total_charge) > 1e-25 * CLHEP::coulomb) sources.emplace_back(node->center_of_mass, node->total_charge);
+        return;
+    }
+    const G4ThreeVector center = (node_min + node_max) * 0.5;
+    for (int i = 0; i < 8; ++i) {
+        if (node->children[i]) {
+            G4ThreeVector c_min, c_max;
+            calculateChildBounds(node_min, node_max, center, i, c_min, c_max);
+            collectLatticeSources(node->children[i].get(), c_min, c_max, max_extent, sources);
+        }
+    }
+}
+
+void AdaptiveSumRadialFieldMap::LatticeTable::Define(const G4ThreeVector& min, const G4ThreeVector& max, int cellsXY,
+                                                     G4double zCenter_in, G4double zScale_in, G4double tStep) {
+    nx = ny = cellsXY + 1;
+    x0 = min.x(); dx = (max.x() - min.x()) / cellsXY;
+    y0 = min.y(); dy = (max.y() - min.y()) / cellsXY;
+    zCenter = zCenter_in; zScale = zScale_in;
+    t0 = std::asinh((min.z() - zCenter) / zScale);
+    const G4double t1 = std::asinh((max.z() - zCenter) / zScale);
+    nz = std::max(2, static_cast<int>(std::ceil((t1 - t0) / tStep)) + 1);
+    dt = (t1 - t0) / (nz - 1);
+    values.assign(4 * std::size_t(nx) * ny * nz, 0.0);
+}
+
+G4ThreeVector AdaptiveSumRadialFieldMap::LatticeTable::NodePosition(int i, int j, int k) const {
+    return G4ThreeVector(x0 + i*dx, y0 + j*dy, zCenter + zScale * std::sinh(t0 + k*dt));
+}
+
+void AdaptiveSumRadialFieldMap::LatticeTable::Interpolate(const G4ThreeVector& p, G4double out[4]) const {
+    if (values.empty()) { out[0] = out[1] = out[2] = out[3] = 0.0; return; }
+    const G4double u = std::clamp((p.x() - x0) / dx, 0.0, G4double(nx - 1));
+    const G4double v = std::clamp((p.y() - y0) / dy, 0.0, G4double(ny - 1));
+    const G4double w = std::clamp((std::asinh((p.z() - zCenter) / zScale) - t0) / dt, 0.0, G4double(nz - 1));
+    const int i = std::min(static_cast<int>(u), nx - 2), j = std::min(static_cast<int>(v), ny - 2), k = std::min(static_cast<int>(w), nz - 2);
+    const G4double fu = u - i, fv = v - j, fw = w - k;
+    const G4double weight[8] = { (1-fu)*(1-fv)*(1-fw), fu*(1-fv)*(1-fw), (1-fu)*fv*(1-fw), fu*fv*(1-fw),
+                                 (1-fu)*(1-fv)*fw,     fu*(1-fv)*fw,     (1-fu)*fv*fw,     fu*fv*fw };
+    out[0] = out[1] = out[2] = out[3] = 0.0;
+    for (int corner = 0; corner < 8; ++corner) {
+        const G4double* node = &values[4*((std::size_t(k + (corner >> 2))*ny + j + ((corner >> 1) & 1))*nx + i + (corner & 1))];
+        for (int c = 0; c < 4; ++c) out[c] += weight[corner] * node[c];
+    }
+}
 
 std::unique_ptr<AdaptiveSumRadialFieldMap::Node> AdaptiveSumRadialFieldMap::buildFromScratch() {
     
@@ -756,7 +1142,8 @@ bool AdaptiveSumRadialFieldMap::hasHighFieldGradient(
 
 void AdaptiveSumRadialFieldMap::collectFinalLeaves(Node* node) { if (!node) return; if (node->is_leaf) { all_leaves_.push_back(node); } else { for (int i = 0; i < 8; ++i) { if(node->children[i]) collectFinalLeaves(node->children[i].get()); } } }
 
-void AdaptiveSumRadialFieldMap::GetFieldValue(const G4double point[4], G4double field[6]) const { const G4ThreeVector r(point[0], point[1], point[2]); G4ThreeVector E = evaluateField(r); field[0]=0; field[1]=0; field[2]=0; field[3]=E.x(); field[4]=E.y(); field[5]=E.z(); }
+G4long AdaptiveSumRadialFieldMap::TakeFieldCallCount() { G4long calls = fieldCalls_; fieldCalls_ = 0; return calls; }
+void AdaptiveSumRadialFieldMap::GetFieldValue(const G4double point[4], G4double field[6]) const { ++fieldCalls_; const G4ThreeVector r(point[0], point[1], point[2]); G4ThreeVector E = evaluateField(r); field[0]=0; field[1]=0; field[2]=0; field[3]=E.x(); field[4]=E.y(); field[5]=E.z(); }
 G4ThreeVector AdaptiveSumRadialFieldMap::evaluateField(const G4ThreeVector& point) const { if (!pointInside(worldMin_, worldMax_, point)) return G4ThreeVector(0,0,0); if (!root_) return G4ThreeVector(0,0,0); return evaluateFieldRecursive(point, root_.get()); }
 G4ThreeVector AdaptiveSumRadialFieldMap::evaluateFieldRecursive(const G4ThreeVector& point, const Node* node) const {
     if (!node) return G4ThreeVector(0,0,0);
@@ -776,6 +1163,25 @@ G4ThreeVector AdaptiveSumRadialFieldMap::evaluateFieldRecursive(const G4ThreeVec
     }
 }
 
+bool AdaptiveSumRadialFieldMap::GetLeaf(const G4ThreeVector& point, G4ThreeVector& field, G4ThreeVector& leafMin, G4ThreeVector& leafMax) const {
+    ++fieldCalls_;
+    if (!root_ || !pointInside(worldMin_, worldMax_, point)) return false;
+    // same descent as evaluateFieldRecursive; a missing child ends it with a zero field
+    const Node* node = root_.get();
+    while (!node->is_leaf) {
+        int child_idx = 0;
+        if (point.x() >= node->center.x()) child_idx |= 1;
+        if (point.y() >= node->center.y()) child_idx |= 2;
+        if (point.z() >= node->center.z()) child_idx |= 4;
+        if (!node->children[child_idx]) break;
+        node = node->children[child_idx].get();
+    }
+    field = node->is_leaf ? node->precomputed_field : G4ThreeVector(0,0,0);
+    leafMin = node->min;
+    leafMax = node->max;
+    return true;
+}
+
 bool AdaptiveSumRadialFieldMap::pointInside(const G4ThreeVector& min_bounds, const G4ThreeVector& max_bounds, const G4ThreeVector& point) const { return (point.x() >= min_bounds.x() && point.x() <= max_bounds.x() && point.y() >= min_bounds.y() && point.y() <= max_bounds.y() && point.z() >= min_bounds.z() && point.z() <= max_bounds.z()); }
 void AdaptiveSumRadialFieldMap::calculateBoundingBox(G4ThreeVector& min_box, G4ThreeVector& max_box) const { min_box = worldMin_; max_box = worldMax_; }
 void AdaptiveSumRadialFieldMap::PrintMeshStatistics() const { G4cout << "\n=== Adaptive Mesh Statistics ===" << G4endl; G4cout << "Total nodes created:      " << total_nodes_.load() << G4endl; G4cout << "Final leaf nodes:         " << leaf_nodes_.load() << G4endl; G4cout << "Max octree depth reached: " << max_depth_reached_.load() << G4endl; G4cout << "Gradient refinements:     " << gradient_refinements_.load() << G4endl; G4cout << "=================================\n" << G4endl; }
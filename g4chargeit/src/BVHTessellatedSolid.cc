@@ -0,0 +1,714 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file BVHTessellatedSolid.cc
+/// \brief Implementation of the BVHTessellatedSolid class
+//
+
+#include "BVHTessellatedSolid.hh"
+
+#include "G4AffineTransform.hh"
+#include "G4BoundingEnvelope.hh"
+#include "G4PolyhedronArbitrary.hh"
+#include "G4VGraphicsScene.hh"
+#include "G4VoxelLimits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+  const G4int kBins = 16;
+  const G4int kMaxDepth = 60;      // traversal stacks hold kMaxDepth + 2 nodes
+  const G4int kStackSize = kMaxDepth + 2;
+  // leaves searched for a safety before settling for a lower bound
+  const G4int kSafetyLeaves = 16;
+
+  // slack on the barycentric coordinates, so rays through a shared edge hit
+  // at least one of its facets
+  const G4double kEdge = 1e-9;
+  // |det| below kParallel * (twice the area) means the ray lies in the plane
+  const G4double kParallel = 1e-12;
+
+  // ray directions for the parity test, away from the axes and from each other
+  const G4ThreeVector kParityDirections[3] = {
+    G4ThreeVector(1., 0.7548776662, 0.5698402910).unit(),
+    G4ThreeVector(-0.3141592654, 1., 0.2718281828).unit(),
+    G4ThreeVector(0.4142135624, -0.7320508076, 1.).unit()
+  };
+
+  G4double HalfArea(const G4double lo[3], const G4double hi[3])
+  {
+    const G4double dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+    return dx * dy + dy * dz + dz * dx;
+  }
+
+  void Grow(G4double lo[3], G4double hi[3], const G4double blo[3], const G4double bhi[3])
+  {
+    for (G4int a = 0; a < 3; ++a) {
+      lo[a] = std::min(lo[a], blo[a]);
+      hi[a] = std::max(hi[a], bhi[a]);
+    }
+  }
+
+  void Reset(G4double lo[3], G4double hi[3])
+  {
+    for (G4int a = 0; a < 3; ++a) {
+      lo[a] = kInfinity;
+      hi[a] = -kInfinity;
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+BVHTessellatedSolid::BVHTessellatedSolid(const G4String& name, const TriangleMesh& mesh,
+                                         G4double scale)
+ : G4VSolid(name), depth_(0), cubicVolume_(0.), surfaceArea_(0.)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+
+  vertices_.reserve(mesh.vertices.size());
+  for (const auto& v : mesh.vertices) {
+    vertices_.push_back(v * scale);
+  }
+
+  std::vector<std::array<G4ThreeVector, 3>> corners;
+  corners.reserve(mesh.triangles.size());
+  triangles_.reserve(mesh.triangles.size());
+
+  G4long flat = 0;
+  for (const auto& t : mesh.triangles) {
+    const G4ThreeVector& a = vertices_[t[0]];
+    const G4ThreeVector& b = vertices_[t[1]];
+    const G4ThreeVector& c = vertices_[t[2]];
+    if ((b - a).cross(c - a).mag2() == 0.) {
+      flat++;
+      continue;
+    }
+    corners.push_back({a, b, c});
+    triangles_.push_back(t);
+    // signed volume of the tetrahedron with the origin
+    cubicVolume_ += a.dot(b.cross(c)) / 6.;
+  }
+  if (flat > 0) {
+    G4cout << "BVHTessellatedSolid " << name << ": ignored " << flat
+           << " facets of zero area" << G4endl;
+  }
+  if (corners.empty()) {
+    G4Exception("BVHTessellatedSolid::BVHTessellatedSolid", "EmptyMesh", FatalException,
+                "The loaded mesh has 0 faces.");
+    return;
+  }
+
+  Build(corners);
+
+  std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+  G4cout << "BVHTessellatedSolid " << name << ": " << GetNumberOfFacets() << " facets, "
+         << nodes_.size() << " nodes, depth " << depth_ << ", built in "
+         << duration.count() << " s" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BVHTessellatedSolid::Build(std::vector<std::array<G4ThreeVector, 3>>& corners)
+{
+  const G4int n = static_cast<G4int>(corners.size());
+
+  std::vector<Node> boxes(n);
+  std::vector<G4ThreeVector> centroids(n);
+  for (G4int i = 0; i < n; ++i) {
+    Reset(boxes[i].lo, boxes[i].hi);
+    for (const auto& c : corners[i]) {
+      const G4double xyz[3] = {c.x(), c.y(), c.z()};
+      Grow(boxes[i].lo, boxes[i].hi, xyz, xyz);
+    }
+    centroids[i] = (corners[i][0] + corners[i][1] + corners[i][2]) / 3.;
+  }
+
+  std::vector<G4int> order(n);
+  for (G4int i = 0; i < n; ++i) order[i] = i;
+
+  nodes_.clear();
+  nodes_.reserve(2 * (n / kLeafSize + 1));
+  nodes_.emplace_back();
+  Subdivide(0, 0, n, 0, order, boxes, centroids);
+
+  // pad every box, so points and rays on the surface are never culled
+  for (auto& node : nodes_) {
+    for (G4int a = 0; a < 3; ++a) {
+      node.lo[a] -= kCarTolerance;
+      node.hi[a] += kCarTolerance;
+    }
+  }
+
+  // facet data in leaf order, so a leaf reads one contiguous block
+  for (G4int a = 0; a < 3; ++a) {
+    p0_[a].resize(n);
+    e1_[a].resize(n);
+    e2_[a].resize(n);
+    n_[a].resize(n);
+  }
+  area2_.resize(n);
+  cumulativeArea_.resize(n);
+
+  G4double area = 0.;
+  for (G4int i = 0; i < n; ++i) {
+    const auto& c = corners[order[i]];
+    const G4ThreeVector e1 = c[1] - c[0];
+    const G4ThreeVector e2 = c[2] - c[0];
+    const G4ThreeVector normal = e1.cross(e2);
+    for (G4int a = 0; a < 3; ++a) {
+      p0_[a][i] = c[0][a];
+      e1_[a][i] = e1[a];
+      e2_[a][i] = e2[a];
+      n_[a][i] = normal[a] / normal.mag();
+    }
+    area2_[i] = normal.mag();
+    area += 0.5 * area2_[i];
+    cumulativeArea_[i] = area;
+  }
+  surfaceArea_ = area;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BVHTessellatedSolid::Subdivide(G4int index, G4int first, G4int count, G4int depth,
+                                    std::vector<G4int>& order, const std::vector<Node>& boxes,
+                                    const std::vector<G4ThreeVector>& centroids)
+{
+  depth_ = std::max(depth_, depth);
+
+  G4double lo[3], hi[3], clo[3], chi[3];
+  Reset(lo, hi);
+  Reset(clo, chi);
+  for (G4int i = first; i < first + count; ++i) {
+    const G4int t = order[i];
+    Grow(lo, hi, boxes[t].lo, boxes[t].hi);
+    const G4double c[3] = {centroids[t].x(), centroids[t].y(), centroids[t].z()};
+    Grow(clo, chi, c, c);
+  }
+
+  Node& node = nodes_[index];
+  std::copy(lo, lo + 3, node.lo);
+  std::copy(hi, hi + 3, node.hi);
+  node.first = first;
+  node.count = count;
+
+  if (count <= kLeafSize || depth >= kMaxDepth) return;
+
+  // binned SAH: cost of a split relative to intersecting every facet here
+  G4int bestAxis = -1, bestSplit = 0;
+  G4double bestCost = count;
+  const G4double area = HalfArea(lo, hi);
+
+  for (G4int axis = 0; axis < 3; ++axis) {
+    const G4double extent = chi[axis] - clo[axis];
+    if (extent <= 0.) continue;
+
+    G4int binCount[kBins] = {0};
+    G4double binLo[kBins][3], binHi[kBins][3];
+    for (G4int b = 0; b < kBins; ++b) Reset(binLo[b], binHi[b]);
+
+    for (G4int i = first; i < first + count; ++i) {
+      const G4int t = order[i];
+      const G4int b = std::min(kBins - 1, static_cast<G4int>((centroids[t][axis] - clo[axis]) / extent * kBins));
+      binCount[b]++;
+      Grow(binLo[b], binHi[b], boxes[t].lo, boxes[t].hi);
+    }
+
+    // areas and counts left of every plane, swept from both sides
+    G4double leftArea[kBins - 1], rightArea[kBins - 1];
+    G4int leftCount[kBins - 1], rightCount[kBins - 1];
+    G4double slo[3], shi[3];
+    Reset(slo, shi);
+    G4int sum = 0;
+    for (G4int b = 0; b < kBins - 1; ++b) {
+      sum += binCount[b];
+      if (binCount[b] > 0) Grow(slo, shi, binLo[b], binHi[b]);
+      leftCount[b] = sum;
+      leftArea[b] = sum > 0 ? HalfArea(slo, shi) : 0.;
+    }
+    Reset(slo, shi);
+    sum = 0;
+    for (G4int b = kBins - 1; b > 0; --b) {
+      sum += binCount[b];
+      if (binCount[b] > 0) Grow(slo, shi, binLo[b], binHi[b]);
+      rightCount[b - 1] = sum;
+      rightArea[b - 1] = sum > 0 ? HalfArea(slo, shi) : 0.;
+    }
+
+    for (G4int b = 0; b < kBins - 1; ++b) {
+      if (leftCount[b] == 0 || rightCount[b] == 0) continue;
+      const G4double cost = 0.125 + (leftCount[b] * leftArea[b] + rightCount[b] * rightArea[b]) / area;
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = b;
+      }
+    }
+  }
+
+  // no useful split: a big leaf is still better than a degenerate tree
+  if (bestAxis < 0) return;
+
+  const G4double extent = chi[bestAxis] - clo[bestAxis];
+  auto middle = std::partition(order.begin() + first, order.begin() + first + count,
+    [&](G4int t) {
+      const G4int b = std::min(kBins - 1, static_cast<G4int>((centroids[t][bestAxis] - clo[bestAxis]) / extent * kBins));
+      return b <= bestSplit;
+    });
+  const G4int leftCount = static_cast<G4int>(middle - (order.begin() + first));
+  if (leftCount == 0 || leftCount == count) return;
+
+  // node is invalidated by the emplace_back below
+  const G4int left = static_cast<G4int>(nodes_.size());
+  nodes_[index].first = left;
+  nodes_[index].count = 0;
+  nodes_.emplace_back();
+  nodes_.emplace_back();
+
+  Subdivide(left, first, leftCount, depth + 1, order, boxes, centroids);
+  Subdivide(left + 1, first + leftCount, count - leftCount, depth + 1, order, boxes, centroids);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BVHTessellatedSolid::IntersectLeaf(G4int first, G4int n, const G4double o[3],
+                                        const G4double d[3], Lanes& lanes) const
+{
+  // Moller-Trumbore for a block of facets, branch free so it vectorises;
+  // the callers decide which lanes count as hits
+  #pragma omp simd
+  for (G4int k = 0; k < n; ++k) {
+    const G4int i = first + k;
+    const G4double e1x = e1_[0][i], e1y = e1_[1][i], e1z = e1_[2][i];
+    const G4double e2x = e2_[0][i], e2y = e2_[1][i], e2z = e2_[2][i];
+
+    const G4double px = d[1] * e2z - d[2] * e2y;
+    const G4double py = d[2] * e2x - d[0] * e2z;
+    const G4double pz = d[0] * e2y - d[1] * e2x;
+    const G4double det = e1x * px + e1y * py + e1z * pz;
+    const G4double inv = 1. / det;
+
+    const G4double tx = o[0] - p0_[0][i], ty = o[1] - p0_[1][i], tz = o[2] - p0_[2][i];
+    const G4double qx = ty * e1z - tz * e1y;
+    const G4double qy = tz * e1x - tx * e1z;
+    const G4double qz = tx * e1y - ty * e1x;
+
+    lanes.det[k] = det;
+    lanes.u[k] = (tx * px + ty * py + tz * pz) * inv;
+    lanes.w[k] = (d[0] * qx + d[1] * qy + d[2] * qz) * inv;
+    lanes.t[k] = (e2x * qx + e2y * qy + e2z * qz) * inv;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  // entry distance of the ray into a node box, false if it misses [tMin, tMax]
+  template <typename Node>
+  inline G4bool HitsBox(const Node& node, const G4double o[3], const G4double inv[3],
+                        G4double tMin, G4double tMax, G4double& entry)
+  {
+    for (G4int a = 0; a < 3; ++a) {
+      const G4double t1 = (node.lo[a] - o[a]) * inv[a];
+      const G4double t2 = (node.hi[a] - o[a]) * inv[a];
+      tMin = std::max(tMin, std::min(t1, t2));
+      tMax = std::min(tMax, std::max(t1, t2));
+    }
+    entry = tMin;
+    return tMin <= tMax;
+  }
+
+  template <typename Node>
+  inline G4double BoxDistance2(const Node& node, const G4ThreeVector& p)
+  {
+    G4double d2 = 0.;
+    for (G4int a = 0; a < 3; ++a) {
+      const G4double d = std::max({node.lo[a] - p[a], 0., p[a] - node.hi[a]});
+      d2 += d * d;
+    }
+    return d2;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::Intersect(const G4ThreeVector& p, const G4ThreeVector& v,
+                                        G4int sense, G4double tMin, G4int& facet) const
+{
+  const G4double o[3] = {p.x(), p.y(), p.z()};
+  const G4double d[3] = {v.x(), v.y(), v.z()};
+  // a huge finite slope instead of 1/0 keeps 0 * inf (NaN) out of the box test
+  G4double inv[3];
+  for (G4int a = 0; a < 3; ++a) inv[a] = 1. / (d[a] != 0. ? d[a] : 1e-300);
+
+  G4double best = kInfinity;
+  facet = -1;
+
+  G4int stack[kStackSize];
+  G4int top = 0;
+  stack[top++] = 0;
+  Lanes lanes;
+
+  while (top > 0) {
+    const Node& node = nodes_[stack[--top]];
+    G4double entry;
+    if (!HitsBox(node, o, inv, tMin, best, entry)) continue;
+
+    if (node.count > 0) {
+      for (G4int first = node.first; first < node.first + node.count; first += kLeafSize) {
+        const G4int n = std::min(kLeafSize, node.first + node.count - first);
+        IntersectLeaf(first, n, o, d, lanes);
+        for (G4int k = 0; k < n; ++k) {
+          // det = -v.normal * (twice the area): > 0 entering, < 0 leaving
+          const G4double det = lanes.det[k];
+          if (std::abs(det) <= kParallel * area2_[first + k] || det * sense >= 0.) continue;
+          if (lanes.u[k] < -kEdge || lanes.w[k] < -kEdge || lanes.u[k] + lanes.w[k] > 1. + kEdge) continue;
+          if (lanes.t[k] > tMin && lanes.t[k] < best) {
+            best = lanes.t[k];
+            facet = first + k;
+          }
+        }
+      }
+      continue;
+    }
+
+    // nearer child on top of the stack
+    const G4int a = node.first, b = node.first + 1;
+    G4double entryA, entryB;
+    const G4bool hitA = HitsBox(nodes_[a], o, inv, tMin, best, entryA);
+    const G4bool hitB = HitsBox(nodes_[b], o, inv, tMin, best, entryB);
+    if (hitA && hitB) {
+      stack[top++] = entryA <= entryB ? b : a;
+      stack[top++] = entryA <= entryB ? a : b;
+    } else if (hitA) {
+      stack[top++] = a;
+    } else if (hitB) {
+      stack[top++] = b;
+    }
+  }
+  return best;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int BVHTessellatedSolid::CountCrossings(const G4ThreeVector& p, const G4ThreeVector& v,
+                                          G4bool& ambiguous) const
+{
+  const G4double o[3] = {p.x(), p.y(), p.z()};
+  const G4double d[3] = {v.x(), v.y(), v.z()};
+  G4double inv[3];
+  for (G4int a = 0; a < 3; ++a) inv[a] = 1. / (d[a] != 0. ? d[a] : 1e-300);
+
+  G4int crossings = 0;
+  ambiguous = false;
+
+  G4int stack[kStackSize];
+  G4int top = 0;
+  stack[top++] = 0;
+  Lanes lanes;
+
+  while (top > 0) {
+    const Node& node = nodes_[stack[--top]];
+    G4double entry;
+    if (!HitsBox(node, o, inv, 0., kInfinity, entry)) continue;
+
+    if (node.count == 0) {
+      stack[top++] = node.first;
+      stack[top++] = node.first + 1;
+      continue;
+    }
+
+    for (G4int first = node.first; first < node.first + node.count; first += kLeafSize) {
+      const G4int n = std::min(kLeafSize, node.first + node.count - first);
+      IntersectLeaf(first, n, o, d, lanes);
+      for (G4int k = 0; k < n; ++k) {
+        const G4double u = lanes.u[k], w = lanes.w[k];
+        if (lanes.t[k] <= 0. || u < -kEdge || w < -kEdge || u + w > 1. + kEdge) continue;
+        // through an edge, a vertex or along the plane the parity is unreliable
+        if (std::abs(lanes.det[k]) <= kParallel * area2_[first + k] ||
+            u < kEdge || w < kEdge || u + w > 1. - kEdge) {
+          ambiguous = true;
+          return crossings;
+        }
+        crossings++;
+      }
+    }
+  }
+  return crossings;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::ClosestFacet(const G4ThreeVector& p, G4double maxDistance,
+                                           G4int& facet, G4int maxLeaves) const
+{
+  G4double best2 = maxDistance * maxDistance;
+  facet = -1;
+
+  G4int stack[kStackSize];
+  G4int top = 0;
+  stack[top++] = 0;
+  G4int leaves = 0;
+
+  while (top > 0) {
+    const Node& node = nodes_[stack[--top]];
+    if (BoxDistance2(node, p) >= best2) continue;
+
+    if (node.count > 0 && maxLeaves > 0 && leaves++ == maxLeaves) {
+      // out of budget: no unvisited facet is closer than its node box
+      G4double bound2 = std::min(best2, BoxDistance2(node, p));
+      while (top > 0) bound2 = std::min(bound2, BoxDistance2(nodes_[stack[--top]], p));
+      return std::sqrt(bound2);
+    }
+
+    if (node.count > 0) {
+      for (G4int i = node.first; i < node.first + node.count; ++i) {
+        const G4double d2 = DistanceToFacet2(p, i);
+        if (d2 < best2) {
+          best2 = d2;
+          facet = i;
+        }
+      }
+      continue;
+    }
+
+    const G4int a = node.first, b = node.first + 1;
+    const G4double da = BoxDistance2(nodes_[a], p);
+    const G4double db = BoxDistance2(nodes_[b], p);
+    if (da <= db) {
+      if (db < best2) stack[top++] = b;
+      if (da < best2) stack[top++] = a;
+    } else {
+      if (da < best2) stack[top++] = a;
+      if (db < best2) stack[top++] = b;
+    }
+  }
+  return facet < 0 ? maxDistance : std::sqrt(best2);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::DistanceToFacet2(const G4ThreeVector& p, G4int i) const
+{
+  // closest point on a triangle by Voronoi region (Ericson, Real-Time
+  // Collision Detection, 5.1.5), corners a, b = a + ab, c = a + ac
+  const G4ThreeVector ab(e1_[0][i], e1_[1][i], e1_[2][i]);
+  const G4ThreeVector ac(e2_[0][i], e2_[1][i], e2_[2][i]);
+  const G4ThreeVector ap = p - G4ThreeVector(p0_[0][i], p0_[1][i], p0_[2][i]);
+
+  const G4double d1 = ab.dot(ap), d2 = ac.dot(ap);
+  if (d1 <= 0. && d2 <= 0.) return ap.mag2();
+
+  const G4ThreeVector bp = ap - ab;
+  const G4double d3 = ab.dot(bp), d4 = ac.dot(bp);
+  if (d3 >= 0. && d4 <= d3) return bp.mag2();
+
+  const G4double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0. && d1 >= 0. && d3 <= 0.) return (ap - d1 / (d1 - d3) * ab).mag2();
+
+  const G4ThreeVector cp = ap - ac;
+  const G4double d5 = ab.dot(cp), d6 = ac.dot(cp);
+  if (d6 >= 0. && d5 <= d6) return cp.mag2();
+
+  const G4double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0. && d2 >= 0. && d6 <= 0.) return (ap - d2 / (d2 - d6) * ac).mag2();
+
+  const G4double va = d3 * d6 - d5 * d4;
+  if (va <= 0. && d4 - d3 >= 0. && d5 - d6 >= 0.) {
+    return (bp - (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (ac - ab)).mag2();
+  }
+
+  // inside the face: distance to the plane
+  const G4double h = ap.dot(Normal(i));
+  return h * h;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+EInside BVHTessellatedSolid::Inside(const G4ThreeVector& p) const
+{
+  const G4double halfTolerance = 0.5 * kCarTolerance;
+  const Node& root = nodes_[0];
+  for (G4int a = 0; a < 3; ++a) {
+    if (p[a] < root.lo[a] || p[a] > root.hi[a]) return kOutside;
+  }
+
+  G4int facet;
+  ClosestFacet(p, halfTolerance, facet);
+  if (facet >= 0) return kSurface;
+
+  G4int crossings = 0;
+  for (const auto& direction : kParityDirections) {
+    G4bool ambiguous;
+    crossings = CountCrossings(p, direction, ambiguous);
+    if (!ambiguous) break;
+  }
+  return crossings % 2 ? kInside : kOutside;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreeVector BVHTessellatedSolid::SurfaceNormal(const G4ThreeVector& p) const
+{
+  G4int facet;
+  ClosestFacet(p, kInfinity, facet);
+  return facet < 0 ? G4ThreeVector(0., 0., 1.) : Normal(facet);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::DistanceToIn(const G4ThreeVector& p, const G4ThreeVector& v) const
+{
+  G4int facet;
+  const G4double t = Intersect(p, v, -1, -0.5 * kCarTolerance, facet);
+  if (facet < 0) return kInfinity;
+  return t < 0.5 * kCarTolerance ? 0. : t;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::DistanceToIn(const G4ThreeVector& p) const
+{
+  G4int facet;
+  return ClosestFacet(p, kInfinity, facet, kSafetyLeaves);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::DistanceToOut(const G4ThreeVector& p, const G4ThreeVector& v,
+                                            const G4bool calcNorm, G4bool* validNorm,
+                                            G4ThreeVector* n) const
+{
+  G4int facet;
+  G4double t = Intersect(p, v, 1, -0.5 * kCarTolerance, facet);
+  if (facet < 0) {
+    // numerically outside already, as G4TessellatedSolid does
+    t = 0.;
+  }
+
+  if (calcNorm) {
+    // a mesh is in general not convex
+    *validNorm = false;
+    *n = facet < 0 ? SurfaceNormal(p) : Normal(facet);
+  }
+  return t < 0.5 * kCarTolerance ? 0. : t;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double BVHTessellatedSolid::DistanceToOut(const G4ThreeVector& p) const
+{
+  G4int facet;
+  return ClosestFacet(p, kInfinity, facet, kSafetyLeaves);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BVHTessellatedSolid::BoundingLimits(G4ThreeVector& pMin, G4ThreeVector& pMax) const
+{
+  const Node& root = nodes_[0];
+  pMin.set(root.lo[0], root.lo[1], root.lo[2]);
+  pMax.set(root.hi[0], root.hi[1], root.hi[2]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool BVHTessellatedSolid::CalculateExtent(const EAxis pAxis, const G4VoxelLimits& pVoxelLimit,
+                                            const G4AffineTransform& pTransform,
+                                            G4double& pMin, G4double& pMax) const
+{
+  G4ThreeVector bmin, bmax;
+  BoundingLimits(bmin, bmax);
+  G4BoundingEnvelope bbox(bmin, bmax);
+  return bbox.CalculateExtent(pAxis, pVoxelLimit, pTransform, pMin, pMax);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreeVector BVHTessellatedSolid::GetPointOnSurface() const
+{
+  // facet chosen by area, then a uniform point on it
+  const G4double r = G4UniformRand() * surfaceArea_;
+  const G4int i = static_cast<G4int>(
+    std::lower_bound(cumulativeArea_.begin(), cumulativeArea_.end(), r) - cumulativeArea_.begin());
+  const G4int facet = std::min(i, static_cast<G4int>(cumulativeArea_.size()) - 1);
+
+  G4double u = G4UniformRand(), w = G4UniformRand();
+  if (u + w > 1.) {
+    u = 1. - u;
+    w = 1. - w;
+  }
+  return G4ThreeVector(p0_[0][facet], p0_[1][facet], p0_[2][facet])
+       + u * G4ThreeVector(e1_[0][facet], e1_[1][facet], e1_[2][facet])
+       + w * G4ThreeVector(e2_[0][facet], e2_[1][facet], e2_[2][facet]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::ostream& BVHTessellatedSolid::StreamInfo(std::ostream& os) const
+{
+  os << "-----------------------------------------------------------\n"
+     << "    *** Dump for solid - " << GetName() << " ***\n"
+     << "    ===================================================\n"
+     << " Solid type: " << GetEntityType() << "\n"
+     << " Parameters: \n"
+     << "   facets:         " << GetNumberOfFacets() << "\n"
+     << "   BVH nodes:      " << nodes_.size() << " (depth " << depth_ << ")\n"
+     << "   surface area:   " << surfaceArea_ << "\n"
+     << "   cubic volume:   " << cubicVolume_ << "\n"
+     << "-----------------------------------------------------------\n";
+  return os;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BVHTessellatedSolid::DescribeYourselfTo(G4VGraphicsScene& scene) const
+{
+  scene.AddSolid(*this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4Polyhedron* BVHTessellatedSolid::CreatePolyhedron() const
+{
+  auto polyhedron = new G4PolyhedronArbitrary(static_cast<G4int>(vertices_.size()),
+                                              static_cast<G4int>(triangles_.size()));
+  for (const auto& v : vertices_) {
+    polyhedron->AddVertex(v);
+  }
+  for (const auto& t : triangles_) {
+    polyhedron->AddFacet(t[0] + 1, t[1] + 1, t[2] + 1);
+  }
+  polyhedron->SetReferences();
+  return polyhedron;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
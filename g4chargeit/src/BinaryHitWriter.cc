@@ -0,0 +1,251 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file BinaryHitWriter.cc
+/// \brief Implementation of the BinaryHitWriter class
+//
+
+#include "BinaryHitWriter.hh"
+
+#include "G4Exception.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+    // the column files are little-endian regardless of the host
+    bool HostIsLittleEndian() {
+        const uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    template <typename T>
+    void AppendLittleEndian(std::vector<char>& out, const T* values, std::size_t n) {
+        const std::size_t offset = out.size();
+        out.resize(offset + n*sizeof(T));
+        std::memcpy(out.data() + offset, values, n*sizeof(T));
+        if (!HostIsLittleEndian()) {
+            for (std::size_t i = 0; i < n; ++i) {
+                std::reverse(out.begin() + offset + i*sizeof(T),
+                             out.begin() + offset + (i + 1)*sizeof(T));
+            }
+        }
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+BinaryHitWriter::BinaryHitWriter()
+ : directory_(""), rows_(0)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+BinaryHitWriter::~BinaryHitWriter()
+{
+  Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string BinaryHitWriter::DirectoryFor(const std::string& rootFileName)
+{
+  std::filesystem::path path(rootFileName);
+  if (path.extension() == ".root") path.replace_extension();
+  return path.string() + ".cols";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string BinaryHitWriter::ThreadDirectoryFor(const std::string& rootFileName, G4int threadId)
+{
+  std::filesystem::path path(rootFileName);
+  if (path.extension() == ".root") path.replace_extension();
+  return path.string() + "_t" + std::to_string(threadId) + ".cols";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BinaryHitWriter::Merge(const std::vector<std::string>& parts, const std::string& directory)
+{
+  BinaryHitWriter merged;
+  merged.Open(directory);
+
+  for (const auto& part : parts) {
+    if (!std::filesystem::is_directory(part)) continue;
+
+    // the event number column holds one int32 per hit
+    const std::string rowFile = part + "/" + kHitColumns[kEventNumber].name + ".bin";
+    std::error_code ec;
+    const uint64_t bytes = std::filesystem::file_size(rowFile, ec);
+    const uint64_t rows = ec ? 0 : bytes / sizeof(int32_t);
+
+    // an empty stream buffer would set failbit on the output file
+    for (G4int i = 0; i < kNumHitColumns && rows > 0; ++i) {
+      std::ifstream in(part + "/" + kHitColumns[i].name + ".bin", std::ios::binary);
+      if (!in.is_open()) {
+        G4Exception("BinaryHitWriter::Merge", "FileOpenError", FatalException,
+                    ("Missing column file in " + part).c_str());
+        return;
+      }
+      merged.files_[i] << in.rdbuf();
+    }
+
+    merged.rows_ += rows;
+
+    std::filesystem::remove_all(part);
+  }
+
+  merged.Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string BinaryHitWriter::DType(HitColumnType type)
+{
+  switch (type) {
+    case HitColumnType::Int:    return "<i4";
+    case HitColumnType::String: return "|S" + std::to_string(kStringWidth);
+    default:                    return "<f8";
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BinaryHitWriter::Open(const std::string& directory)
+{
+  Close();
+
+  directory_ = directory;
+  rows_ = 0;
+
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) {
+    G4Exception("BinaryHitWriter::Open", "DirectoryError", FatalException,
+                ("Failed to create output directory: " + directory_).c_str());
+    return;
+  }
+
+  files_.resize(kNumHitColumns);
+  for (G4int i = 0; i < kNumHitColumns; ++i) {
+    const std::string path = directory_ + "/" + kHitColumns[i].name + ".bin";
+    files_[i].open(path, std::ios::binary | std::ios::trunc);
+    if (!files_[i].is_open()) {
+      G4Exception("BinaryHitWriter::Open", "FileOpenError", FatalException,
+                  ("Failed to open file for writing: " + path).c_str());
+    }
+  }
+
+  G4cout << "Writing binary hit columns to " << directory_ << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BinaryHitWriter::Write(const HitBatch& batch)
+{
+  if (!IsOpen() || batch.Size() == 0) return;
+
+  for (G4int i = 0; i < kNumHitColumns; ++i) {
+    scratch_.clear();
+
+    switch (kHitColumns[i].type) {
+      case HitColumnType::Int: {
+        const auto& ints = batch.Ints(i);
+        std::vector<int32_t> values(ints.begin(), ints.end());
+        AppendLittleEndian(scratch_, values.data(), values.size());
+        break;
+      }
+      case HitColumnType::String: {
+        // fixed width, NUL padded, truncated if longer
+        const auto& strings = batch.Strings(i);
+        scratch_.assign(strings.size()*kStringWidth, '\0');
+        for (std::size_t row = 0; row < strings.size(); ++row) {
+          std::memcpy(scratch_.data() + row*kStringWidth, strings[row].data(),
+                      std::min<std::size_t>(strings[row].size(), kStringWidth));
+        }
+        break;
+      }
+      case HitColumnType::Double:
+      case HitColumnType::DoubleVector: {
+        const auto& values = batch.Doubles(i);
+        AppendLittleEndian(scratch_, values.data(), values.size());
+        break;
+      }
+    }
+
+    files_[i].write(scratch_.data(), scratch_.size());
+  }
+
+  rows_ += batch.Size();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BinaryHitWriter::Close()
+{
+  if (!IsOpen()) return;
+
+  for (auto& file : files_) file.close();
+  files_.clear();
+
+  WriteHeader();
+  G4cout << "   Binary hit columns closed (" << rows_ << " hits)." << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void BinaryHitWriter::WriteHeader() const
+{
+  std::ofstream header(directory_ + "/header.json", std::ios::trunc);
+  if (!header.is_open()) {
+    G4cerr << "Error: Could not write " << directory_ << "/header.json" << G4endl;
+    return;
+  }
+
+  header << "{\n"
+         << "  \"format\": \"g4chargeit-hit-columns\",\n"
+         << "  \"version\": 1,\n"
+         << "  \"tree\": \"Hit Data\",\n"
+         << "  \"byteorder\": \"little\",\n"
+         << "  \"rows\": " << rows_ << ",\n"
+         << "  \"columns\": [\n";
+
+  for (G4int i = 0; i < kNumHitColumns; ++i) {
+    const HitColumnType type = kHitColumns[i].type;
+    header << "    {\"name\": \"" << kHitColumns[i].name << "\", "
+           << "\"file\": \"" << kHitColumns[i].name << ".bin\", "
+           << "\"dtype\": \"" << DType(type) << "\", "
+           << "\"shape\": [" << (type == HitColumnType::DoubleVector ? "3" : "") << "]}"
+           << (i + 1 < kNumHitColumns ? ",\n" : "\n");
+  }
+
+  header << "  ]\n}\n";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
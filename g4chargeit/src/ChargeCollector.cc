@@ -0,0 +1,155 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ChargeCollector.cc
+/// \brief Implementation of the ChargeCollector class
+//
+
+#include "ChargeCollector.hh"
+#include "SensitiveDetectorHit.hh"
+#include "PrimarySourceTable.hh"
+#include "LooperWatchdogProcess.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ChargeCollector* ChargeCollector::singletonInstance_ = nullptr;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ChargeCollector::ChargeCollector()
+ : enabled_(false), referenceParticle_("proton"), referenceCount_(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ChargeCollector* ChargeCollector::GetInstance()
+{
+  // created on the master before the workers start
+  if (not singletonInstance_) { singletonInstance_ = new ChargeCollector; }
+
+  return singletonInstance_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ChargeCollector::AddEvent(const std::vector<SensitiveDetectorHit*>& hits)
+{
+  const G4String target_volume = "SiO2";
+
+  // every charge carries the statistical weight of its track (1 unless the
+  // primary energies were biased)
+  std::vector<G4ThreeVector> electrons, protons, holes;
+  std::vector<G4double> electronWeights, protonWeights, holeWeights;
+  G4double referenceWeight = 0.;
+  SensitiveDetectorHit* lastElectron = nullptr;
+  const PrimarySourceTable* sources = PrimarySourceTable::GetInstance();
+
+  for (auto hit : hits) {
+    const G4String ptype = hit->GetParticleType();
+    // charges of loopers stopped in the vacuum count as well
+    const G4bool stopped_in_target = hit->GetPostKineticEnergy() == 0.0
+                                     && (hit->GetPostVolumeName() == target_volume
+                                         || hit->GetPostProcessName() == LooperWatchdogProcess::kProcessName);
+    const G4ThreeVector post(hit->GetPostPositionX(), hit->GetPostPositionY(), hit->GetPostPositionZ());
+
+    // Stopped electrons and protons
+    if (ptype == "e-" && stopped_in_target) {
+      electrons.push_back(post);
+      electronWeights.push_back(hit->GetWeight());
+    }
+    if (ptype == "proton" && stopped_in_target) {
+      protons.push_back(post);
+      protonWeights.push_back(hit->GetWeight());
+    }
+
+    // Holes left by electrons of the primaries
+    if (ptype == "e-" && sources->IsPrimaryTrack(static_cast<G4int>(hit->GetParentID())) && hit->GetPreProcessName() == "initStep") {
+      holes.push_back(G4ThreeVector(hit->GetPrePositionX(), hit->GetPrePositionY(), hit->GetPrePositionZ()));
+      holeWeights.push_back(hit->GetWeight());
+    }
+
+    if (ptype == "e-") lastElectron = hit;
+    if (ptype == referenceParticle_ && hit->GetParentID() == 0.0
+        && hit->GetPostVolumeName() == target_volume) referenceWeight = hit->GetWeight();
+  }
+
+  if (referenceParticle_ == "gamma") {
+    // photons count through the photoelectrons that escape
+    referenceWeight = (lastElectron
+        && (lastElectron->GetPostVolumeName() == "physical_cyclic"
+            || lastElectron->GetPreVolumeName() == "physical_cyclic")) ? lastElectron->GetWeight() : 0.;
+  }
+
+  if (electrons.empty() && protons.empty() && holes.empty() && referenceWeight == 0.) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  referenceCount_ += referenceWeight;
+  electrons_.insert(electrons_.end(), electrons.begin(), electrons.end());
+  protons_.insert(protons_.end(), protons.begin(), protons.end());
+  holes_.insert(holes_.end(), holes.begin(), holes.end());
+  electronWeights_.insert(electronWeights_.end(), electronWeights.begin(), electronWeights.end());
+  protonWeights_.insert(protonWeights_.end(), protonWeights.begin(), protonWeights.end());
+  holeWeights_.insert(holeWeights_.end(), holeWeights.begin(), holeWeights.end());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ChargeCollector::Take(std::vector<G4ThreeVector>& electrons,
+                           std::vector<G4ThreeVector>& protons,
+                           std::vector<G4ThreeVector>& holes,
+                           std::vector<G4double>& electronWeights,
+                           std::vector<G4double>& protonWeights,
+                           std::vector<G4double>& holeWeights)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  electrons = std::move(electrons_);
+  protons = std::move(protons_);
+  holes = std::move(holes_);
+  electronWeights = std::move(electronWeights_);
+  protonWeights = std::move(protonWeights_);
+  holeWeights = std::move(holeWeights_);
+  electrons_.clear();
+  protons_.clear();
+  holes_.clear();
+  electronWeights_.clear();
+  protonWeights_.clear();
+  holeWeights_.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ChargeCollector::Reset()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  electrons_.clear();
+  protons_.clear();
+  holes_.clear();
+  electronWeights_.clear();
+  protonWeights_.clear();
+  holeWeights_.clear();
+  referenceCount_ = 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
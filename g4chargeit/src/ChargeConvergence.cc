@@ -0,0 +1,127 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ChargeConvergence.cc
+/// \brief Implementation of the ChargeConvergence class
+//
+
+#include "ChargeConvergence.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+  // chunks needed before their spread is trusted
+  const G4int kMinChunks = 4;
+  // charges closer to a probe do not add to its field
+  const G4double kMinDistance = 1.*nm;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ChargeConvergence::ChargeConvergence(const G4ThreeVector& min, const G4ThreeVector& max,
+                                     G4int cells, const std::vector<G4ThreeVector>& probes)
+ : min_(min), cellSize_((max - min)/std::max(cells, 1)), cells_(std::max(cells, 1)),
+   probes_(probes), chunks_(0),
+   charge_(cells_*cells_*cells_, 0.), chargeSquares_(cells_*cells_*cells_, 0.),
+   field_(3*probes.size(), 0.), fieldSquares_(3*probes.size(), 0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ChargeConvergence::AddChunk(const std::vector<G4ThreeVector>& positions,
+                                 const std::vector<G4double>& charges)
+{
+  std::vector<G4double> charge(charge_.size(), 0.);
+  std::vector<G4double> field(field_.size(), 0.);
+
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    // charges outside the world (none expected) go to the border cells
+    G4int index[3];
+    for (G4int axis = 0; axis < 3; ++axis) {
+      const G4int cell = static_cast<G4int>((positions[i][axis] - min_[axis])/cellSize_[axis]);
+      index[axis] = std::clamp(cell, 0, cells_ - 1);
+    }
+    charge[(index[0]*cells_ + index[1])*cells_ + index[2]] += charges[i];
+
+    for (std::size_t p = 0; p < probes_.size(); ++p) {
+      const G4ThreeVector d = probes_[p] - positions[i];
+      const G4double r = d.mag();
+      if (r < kMinDistance) continue;
+      const G4ThreeVector e = charges[i]/(r*r*r)*d;
+      field[3*p] += e.x();
+      field[3*p + 1] += e.y();
+      field[3*p + 2] += e.z();
+    }
+  }
+
+  for (std::size_t k = 0; k < charge.size(); ++k) {
+    charge_[k] += charge[k];
+    chargeSquares_[k] += charge[k]*charge[k];
+  }
+  for (std::size_t k = 0; k < field.size(); ++k) {
+    field_[k] += field[k];
+    fieldSquares_[k] += field[k]*field[k];
+  }
+  chunks_++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ChargeConvergence::RelativeError(const std::vector<G4double>& sum,
+                                          const std::vector<G4double>& sumSquares) const
+{
+  if (chunks_ < kMinChunks) return DBL_MAX;
+
+  // variance of a chunk from the spread of the chunks; the sum of n chunks
+  // has n times that variance
+  const G4double n = chunks_;
+  G4double variance = 0., norm = 0.;
+  for (std::size_t k = 0; k < sum.size(); ++k) {
+    const G4double chunkVariance = std::max(sumSquares[k] - sum[k]*sum[k]/n, 0.)/(n - 1.);
+    variance += n*chunkVariance;
+    norm += sum[k]*sum[k];
+  }
+  if (norm == 0.) return DBL_MAX;
+  return std::sqrt(variance/norm);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ChargeConvergence::ChargeError() const
+{
+  return RelativeError(charge_, chargeSquares_);
+}
+
+G4double ChargeConvergence::FieldError() const
+{
+  return RelativeError(field_, fieldSquares_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -52,9 +52,24 @@
 #include "G4ChordFinder.hh"
 #include "G4DormandPrince745.hh"
 #include "G4IntegrationDriver.hh"  
+#include "G4MagIntegratorDriver.hh"
+#include "G4InterpolationDriver.hh"
+#include "G4FSALIntegrationDriver.hh"
+#include "G4ClassicalRK4.hh"
+#include "G4CashKarpRKF45.hh"
+#include "G4BogackiShampine23.hh"
+#include "G4BogackiShampine45.hh"
+#include "G4TsitourasRK45.hh"
+#include "G4SimpleHeum.hh"
+#include "G4SimpleRunge.hh"
+#include "G4ExplicitEuler.hh"
+#include "G4RK547FEq1.hh"
 #include "G4UniformElectricField.hh"
 #include "G4SystemOfUnits.hh"
 #include "SDManager.hh"
+#include "SkinBiasingOperator.hh"
+#include "SurrogateEmissionModel.hh"
+#include "LooperWatchdogProcess.hh"
 #include "G4SDManager.hh"
 #include "G4RunManager.hh"
 
@@ -63,6 +78,9 @@
 
 #include "G4Box.hh"
 #include "G4Sphere.hh"
+#include "G4MultiUnion.hh"
+#include "G4Orb.hh"
+#include "G4GeometryTolerance.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
 
@@ -88,13 +106,46 @@
 #include "G4UserLimits.hh"
 
 #include "CADMesh.hh"
+#include "FastSTLReader.hh"
+#include "BVHTessellatedSolid.hh"
+#include "ExactLeafStepper.hh"
+#include "TrackFieldManager.hh"
+#include "BinaryHitWriter.hh"
+#include "ThreadCoordinator.hh"
+#include "ChargeCollector.hh"
+#include "PrimarySourceTable.hh"
+#include "PhotonStageCache.hh"
+#include "ChargeConvergence.hh"
+#include "G4Threading.hh"
+
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreadLocal TrackFieldManager* DetectorConstruction::threadFieldManager_ = nullptr;
+G4ThreadLocal G4EqMagElectricField* DetectorConstruction::threadEquation_ = nullptr;
+G4ThreadLocal const AdaptiveSumRadialFieldMap* DetectorConstruction::threadFieldMap_ = nullptr;
+G4ThreadLocal G4int DetectorConstruction::threadFieldConfig_ = -1;
+G4ThreadLocal G4FieldManager* DetectorConstruction::threadFreeFieldManager_ = nullptr;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 DetectorConstruction::DetectorConstruction():G4VUserDetectorConstruction()
 , boolPBC_(false), worldX_(0), worldY_(0), worldZ_(0), Epsilon_(0), fieldMinimumStep_(0),sphereSolid_(0), equivalentIterationTime_(0.02),density_(2.1),
-fieldGradThreshold_(0), CADFile_(""), RootInput_(""), Scale_(1), filename_(""), octreeDepth_(8), materialTemperature_(450), charges_filename_(""), 
-initial_depth_(6), boolDissipationModel_(true)
+fieldGradThreshold_(0), fieldStepper_("DormandPrince745"), fieldDriver_("Integration"), fieldDeltaOneStep_(0.1*um), fieldMinEpsilon_(1.0e-7), fieldMaxEpsilon_(1.0e-4), fieldDeltaChord_(0.25*mm), fieldDriverMinStep_(0.1*um), fieldConfig_(0), grainFieldPolicy_("none"), fieldBypassRatio_(1000.), fieldRelaxRatio_(10.), CADFile_(""), RootInput_(""), Scale_(1), useMeshCache_(true), cadSolidType_("tessellated"), splitGrains_(false), spheresFile_(""), filename_(""), octreeDepth_(8), materialTemperature_(450), charges_filename_(""), 
+initial_depth_(6), boolDissipationModel_(true), fieldMap_(nullptr), eventsPerIteration_(0), chargingFlux_(0),
+targetError_(0), maxEventsPerIteration_(0), convergenceMeasure_("charge"), convergenceCells_(8),
+dirty_(kGeometry | kCharges | kFieldMap), chargesSnapshotValid_(false), chargesFileExisted_(false),
+geometryVersion_(0)
 
 {
   // create commands for interactive definition of the detector 
@@ -119,6 +170,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
 
 G4VPhysicalVolume* DetectorConstruction::ConstructVolumes() {
 G4GeometryManager::GetInstance()->OpenGeometry();
+// the grain region outlives the volumes deleted here
+if (SurrogateEmissionModel::IsAvailable()) SurrogateEmissionModel::ReleaseEnvelopes();
 G4PhysicalVolumeStore::GetInstance()->Clean();
 G4LogicalVolumeStore::GetInstance()->Clean();
 G4SolidStore::GetInstance()->Clean();
@@ -175,7 +228,15 @@ if (boolPBC_)
 }
 
 
-if (!CADFile_.empty()) {
+// one solid per grain when the mesh is split, otherwise a single solid
+std::vector<G4VSolid*> grainSolids;
+std::vector<G4ThreeVector> grainPositions;
+
+if (!spheresFile_.empty()) {
+  // analytic spheres take precedence over the CAD mesh
+  LoadSpheres("geometry/" + spheresFile_, grainSolids, grainPositions);
+}
+else if (!CADFile_.empty()) {
 
   std::string folder_name = "geometry";
 
@@ -183,170 +244,362 @@ if (!CADFile_.empty()) {
   oss << folder_name << "/" << CADFile_;
   std::string full_path = oss.str();
 
-  auto sphere_mesh = CADMesh::TessellatedMesh::FromSTL(full_path);
-  sphere_mesh->SetScale(Scale_);
-  sphereSolid_ = sphere_mesh->GetSolid();
+  if (G4StrUtil::ends_with(G4StrUtil::to_lower_copy(full_path), ".stl")) {
+    // memory-mapped parallel reader with a sidecar mesh cache
+    FastSTLReader reader;
+    reader.SetUseCache(useMeshCache_);
+    reader.Read(full_path);
+    const auto& mesh = reader.GetMeshes().front();
+
+    auto buildSolid = [this](const TriangleMesh& part) -> G4VSolid* {
+      if (cadSolidType_ == "bvh") return new BVHTessellatedSolid(part.name, part, Scale_);
+      return FastSTLReader::BuildSolid(part, Scale_, part.name);
+    };
+
+    if (splitGrains_) {
+      const auto parts = FastSTLReader::SplitConnected(mesh);
+      for (const auto& part : parts) {
+        grainSolids.push_back(buildSolid(part));
+      }
+      G4cout << "Split " << mesh.name << " into " << parts.size() << " grains" << G4endl;
+    } else {
+      grainSolids.push_back(buildSolid(mesh));
+    }
+  } else {
+    if (cadSolidType_ == "bvh" || splitGrains_) {
+      G4Exception("DetectorConstruction::ConstructVolumes", "CADSolid", JustWarning,
+                  "BVH solids and grain splitting need STL input, using one G4TessellatedSolid.");
+    }
+    // other formats (PLY, OBJ) through CADMesh, which picks its parser by name
+    auto sphere_mesh = CADMesh::TessellatedMesh::FromSTL(full_path);
+    sphere_mesh->SetScale(Scale_);
+    grainSolids.push_back(sphere_mesh->GetSolid());
+  }
 
 }
  else {
-  sphereSolid_ = new G4Sphere("Test", 0., 50*um, 0., 360.*deg, 0., 180.*deg);
+  grainSolids.push_back(new G4Sphere("Test", 0., 50*um, 0., 360.*deg, 0., 180.*deg));
   std::cout << "Auto Defaulted To 50 um Sphere." << std::endl;
 }
 
-// Create Electrons
-if (!RootInput_.empty()) {
-    std::istringstream iss(RootInput_);
-    std::vector<std::string> file_list;
-    std::string file_name;
-    TFile* file;
-    TTree* tree;
+// meshes are placed where they were drawn
+grainPositions.resize(grainSolids.size());
 
-    while (iss >> file_name) {
-        file_list.push_back(file_name);
-    }
+// the field map tests points against all grains at once
+if (grainSolids.size() == 1 && grainPositions.front() == G4ThreeVector()) {
+  sphereSolid_ = grainSolids.front();
+} else {
+  auto grains = new G4MultiUnion(SiO2->GetName());
+  for (std::size_t i = 0; i < grainSolids.size(); ++i) {
+    grains->AddNode(*grainSolids[i], G4Transform3D(G4RotationMatrix(), grainPositions[i]));
+  }
+  grains->Voxelize();
+  sphereSolid_ = grains;
+
+  // overlapping daughters break navigation: place the union as one volume
+  if (!spheresFile_.empty() && SpheresOverlap()) {
+    G4cout << "Spheres overlap, placing them as one G4MultiUnion volume" << G4endl;
+    grainSolids.assign(1, grains);
+    grainPositions.assign(1, G4ThreeVector());
+  }
+}
 
-    for (const auto& fil : file_list) {
-        std::string folder_name = "root";
-        std::ostringstream oss;
-        oss << folder_name << "/" << fil;
-        std::string full_path = oss.str();
-
-        file = TFile::Open(full_path.c_str(), "READ");
-        tree = nullptr;
-
-        if (file && file->IsOpen()) {
-            file->GetObject("Hit Data", tree);
-            if (tree) {
-                std::cout << full_path << " successfully loaded!" << std::endl;
-            } else {
-                std::cout << "Tree not found in file: " << full_path << std::endl;
-                continue;  
-            }
-        } else {
-            std::cout << "Failed to open file: " << full_path << std::endl;
-            continue;
-        }
-
-        // Branch variables
-        int event_number;
-        std::vector<double>* post_step_position = nullptr;
-        std::vector<double>* pre_step_position = nullptr;
-        Char_t volume_name_post[100];
-        double kinetic_energy_post_mev;
-        double parent_id;
-        Char_t particle_type[50];
-        Char_t process_name_pre[100];
-
-        // Set branch addresses
-        tree->SetBranchAddress("Event_Number", &event_number);
-        tree->SetBranchAddress("Post_Step_Position_mm", &post_step_position);
-        tree->SetBranchAddress("Pre_Step_Position_mm", &pre_step_position);
-        tree->SetBranchAddress("Volume_Name_Post", &volume_name_post);
-        tree->SetBranchAddress("Parent_ID", &parent_id);
-        tree->SetBranchAddress("Kinetic_Energy_Post_MeV", &kinetic_energy_post_mev);
-        tree->SetBranchAddress("Particle_Type", &particle_type);
-        tree->SetBranchAddress("Process_Name_Pre", &process_name_pre);
-
-        const std::string target_volume = "SiO2";
-
-        // Sets to track photon stops and unique holes
-        std::set<int> photonStops;
-        std::set<int> holeRecordedEvents;
-
-        Long64_t nEntries = tree->GetEntries();
-        for (Long64_t i = 0; i < nEntries; i++) {
-            tree->GetEntry(i);
-            if (!post_step_position || post_step_position->size() < 3) continue;
-            if (!pre_step_position || pre_step_position->size() < 3) continue;
-
-
-            std::string ptype = particle_type;
-
-            // // Track photon stops (photon reaches zero kinetic energy)
-            // if (ptype == "gamma" && kinetic_energy_post_mev == 0.0 && std::string(volume_name_post) == target_volume) {
-            //     photonStops.insert(event_number);
-            // }
-
-            // Stopped electrons
-            if (ptype == "e-" && kinetic_energy_post_mev == 0.0 && std::string(volume_name_post) == target_volume) {
-                G4ThreeVector pos((*post_step_position)[0] * mm,
-                                  (*post_step_position)[1] * mm,
-                                  (*post_step_position)[2] * mm);
-                fElectronPositions.push_back(pos);
-            }
-
-            // Stopped protons
-            if (ptype == "proton" && kinetic_energy_post_mev == 0.0 && std::string(volume_name_post) == target_volume) {
-                G4ThreeVector pos((*post_step_position)[0] * mm,
-                                  (*post_step_position)[1] * mm,
-                                  (*post_step_position)[2] * mm);
-                fProtonPositions.push_back(pos);
-            }
-
-            if (ptype == "e-" && parent_id == 1 && std::string(process_name_pre) == "initStep") {
-                G4ThreeVector pos((*pre_step_position)[0] * mm,
-                                  (*pre_step_position)[1] * mm,
-                                  (*pre_step_position)[2] * mm);
-                fHolePositions.push_back(pos);
- 
-            }
-        }
+// stopped charges of previous runs, reloaded only when the input changed
+if (dirty_ & kCharges) LoadCharges();
+
+// grains are separate daughters named like the single volume, so hit
+// selection by volume name is unchanged; the copy number is the grain index.
+// Spheres of equal radius share their solid and so their logical volume.
+std::map<G4VSolid*, G4LogicalVolume*> grainLogicals;
+for (std::size_t i = 0; i < grainSolids.size(); ++i) {
+  G4LogicalVolume*& logicSphere = grainLogicals[grainSolids[i]];
+  if (!logicSphere) {
+    logicSphere = new G4LogicalVolume(grainSolids[i], SiO2 , SiO2->GetName());  
+    // envelope of the surrogate photoemission (/surrogate/mode)
+    if (SurrogateEmissionModel::IsAvailable()) SurrogateEmissionModel::AddEnvelope(logicSphere);
+  }
 
-        // Print results per file
-        G4cout << "File: " << full_path << G4endl;
-        G4cout << "  Electrons: " << fElectronPositions.size() << G4endl;
-        G4cout << "  Protons:   " << fProtonPositions.size() << G4endl;
-        G4cout << "  Holes:     " << fHolePositions.size() << G4endl;
 
-        file->Close();
+  new G4PVPlacement(0,                   
+                grainPositions[i],   
+                logicSphere,                   
+                SiO2->GetName(),            
+                logicWorld_,            
+                false,                             
+                static_cast<G4int>(i));                                 
+}
+
+// loopers stopped in the vacuum go to the nearest grain surface
+LooperWatchdogProcess::SetGrains(sphereSolid_);
+SurrogateEmissionModel::SetGrains(sphereSolid_);
+
+// the map depends on the solid and the world bounds, so it follows the geometry
+BuildFieldMap();
+dirty_ = 0;
+geometryVersion_++;
+              
+return physWorld;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::LoadSpheres(const G4String& path, std::vector<G4VSolid*>& solids,
+                                       std::vector<G4ThreeVector>& positions)
+{
+  std::ifstream in(path);
+  if (!in) {
+    G4Exception("DetectorConstruction::LoadSpheres", "FileNotFound", FatalException,
+                ("Sphere file not found: " + path).c_str());
+    return;
+  }
+
+  // one "x y z radius" line (mm) per sphere, # starts a comment
+  spheres_.clear();
+  std::map<G4double, G4Orb*> orbs;
+  std::string line;
+  G4int lineNumber = 0;
+  while (std::getline(in, line)) {
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+    std::istringstream fields(line);
+    G4double x, y, z, r;
+    if (!(fields >> x >> y >> z >> r) || r <= 0.) {
+      G4Exception("DetectorConstruction::LoadSpheres", "ParseError", FatalException,
+                  (path + ":" + std::to_string(lineNumber) + ": expected x y z radius").c_str());
+      return;
     }
+
+    const G4ThreeVector center(x*mm, y*mm, z*mm);
+    G4Orb*& orb = orbs[r*mm];
+    if (!orb) orb = new G4Orb("Sphere_r" + std::to_string(r) + "mm", r*mm);
+
+    solids.push_back(orb);
+    positions.push_back(center);
+    spheres_.emplace_back(center, r*mm);
+  }
+
+  if (solids.empty()) {
+    G4Exception("DetectorConstruction::LoadSpheres", "ParseError", FatalException,
+                ("No spheres in " + path).c_str());
+    return;
+  }
+  G4cout << "Read " << solids.size() << " spheres (" << orbs.size()
+         << " radii) from " << path << G4endl;
 }
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-G4LogicalVolume*logicSphere= new G4LogicalVolume(sphereSolid_, SiO2 , SiO2->GetName());  
+G4bool DetectorConstruction::SpheresOverlap() const
+{
+  // sweep along x; touching spheres are fine, daughters may share a surface
+  const G4double tolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+  G4double maxRadius = 0.;
+  std::vector<std::size_t> order(spheres_.size());
+  for (std::size_t i = 0; i < spheres_.size(); ++i) {
+    order[i] = i;
+    maxRadius = std::max(maxRadius, spheres_[i].second);
+  }
+  std::sort(order.begin(), order.end(), [this](std::size_t a, std::size_t b) {
+    return spheres_[a].first.x() < spheres_[b].first.x();
+  });
+
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const auto& a = spheres_[order[i]];
+    for (std::size_t j = i + 1; j < order.size(); ++j) {
+      const auto& b = spheres_[order[j]];
+      if (b.first.x() - a.first.x() >= a.second + maxRadius) break;
+      if ((b.first - a.first).mag() < a.second + b.second - tolerance) return true;
+    }
+  }
+  return false;
+}
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-new G4PVPlacement(0,                   
-              G4ThreeVector(0,0,0),   
-              logicSphere,                   
-              SiO2->GetName(),            
-              logicWorld_,            
-              false,                             
-              0);                                 
-              
-return physWorld;
+void DetectorConstruction::LoadCharges()
+{
+  // replace, do not append to, the charges of a previous load
+  fElectronPositions.clear();
+  fProtonPositions.clear();
+  fHolePositions.clear();
+  fElectronWeights.clear();
+  fProtonWeights.clear();
+  fHoleWeights.clear();
+
+  if (!RootInput_.empty()) {
+      std::istringstream iss(RootInput_);
+      std::vector<std::string> file_list;
+      std::string file_name;
+      TFile* file;
+      TTree* tree;
+
+      while (iss >> file_name) {
+          file_list.push_back(file_name);
+      }
+
+      for (const auto& fil : file_list) {
+          std::string folder_name = "root";
+          std::ostringstream oss;
+          oss << folder_name << "/" << fil;
+          std::string full_path = oss.str();
+
+          // binary column output of a previous run
+          const std::string binary_dir = BinaryHitWriter::DirectoryFor(full_path);
+          if (std::filesystem::is_directory(binary_dir)) {
+              LoadBinaryCharges(binary_dir);
+              continue;
+          }
+
+          file = TFile::Open(full_path.c_str(), "READ");
+          tree = nullptr;
+
+          if (file && file->IsOpen()) {
+              file->GetObject("Hit Data", tree);
+              if (tree) {
+                  std::cout << full_path << " successfully loaded!" << std::endl;
+              } else {
+                  std::cout << "Tree not found in file: " << full_path << std::endl;
+                  continue;  
+              }
+          } else {
+              std::cout << "Failed to open file: " << full_path << std::endl;
+              continue;
+          }
+
+          // Branch variables
+          int event_number;
+          std::vector<double>* post_step_position = nullptr;
+          std::vector<double>* pre_step_position = nullptr;
+          Char_t volume_name_post[100];
+          double kinetic_energy_post_mev;
+          double parent_id;
+          Char_t particle_type[50];
+          Char_t process_name_pre[100];
+          Char_t process_name_post[100];
+
+          // Set branch addresses
+          tree->SetBranchAddress("Event_Number", &event_number);
+          tree->SetBranchAddress("Post_Step_Position_mm", &post_step_position);
+          tree->SetBranchAddress("Pre_Step_Position_mm", &pre_step_position);
+          tree->SetBranchAddress("Volume_Name_Post", &volume_name_post);
+          tree->SetBranchAddress("Parent_ID", &parent_id);
+          tree->SetBranchAddress("Kinetic_Energy_Post_MeV", &kinetic_energy_post_mev);
+          tree->SetBranchAddress("Particle_Type", &particle_type);
+          tree->SetBranchAddress("Process_Name_Pre", &process_name_pre);
+          tree->SetBranchAddress("Process_Name_Post", &process_name_post);
+          // files written before the weights were added hold unit weights
+          double weight = 1.;
+          if (tree->GetBranch("Weight")) tree->SetBranchAddress("Weight", &weight);
+
+          const std::string target_volume = "SiO2";
+          const PrimarySourceTable* primaries = PrimarySourceTable::GetInstance();
+
+          // Sets to track photon stops and unique holes
+          std::set<int> photonStops;
+          std::set<int> holeRecordedEvents;
+
+          Long64_t nEntries = tree->GetEntries();
+          for (Long64_t i = 0; i < nEntries; i++) {
+              tree->GetEntry(i);
+              if (!post_step_position || post_step_position->size() < 3) continue;
+              if (!pre_step_position || pre_step_position->size() < 3) continue;
+
+
+              std::string ptype = particle_type;
+
+              // // Track photon stops (photon reaches zero kinetic energy)
+              // if (ptype == "gamma" && kinetic_energy_post_mev == 0.0 && std::string(volume_name_post) == target_volume) {
+              //     photonStops.insert(event_number);
+              // }
+
+              // charges of loopers stopped in the vacuum count as well
+              const bool stopped_in_target = kinetic_energy_post_mev == 0.0
+                  && (std::string(volume_name_post) == target_volume
+                      || std::string(process_name_post) == LooperWatchdogProcess::kProcessName);
+
+              // Stopped electrons
+              if (ptype == "e-" && stopped_in_target) {
+                  G4ThreeVector pos((*post_step_position)[0] * mm,
+                                    (*post_step_position)[1] * mm,
+                                    (*post_step_position)[2] * mm);
+                  fElectronPositions.push_back(pos);
+                  fElectronWeights.push_back(weight);
+              }
+
+              // Stopped protons
+              if (ptype == "proton" && stopped_in_target) {
+                  G4ThreeVector pos((*post_step_position)[0] * mm,
+                                    (*post_step_position)[1] * mm,
+                                    (*post_step_position)[2] * mm);
+                  fProtonPositions.push_back(pos);
+                  fProtonWeights.push_back(weight);
+              }
+
+              if (ptype == "e-" && primaries->IsPrimaryTrack(static_cast<G4int>(parent_id)) && std::string(process_name_pre) == "initStep") {
+                  G4ThreeVector pos((*pre_step_position)[0] * mm,
+                                    (*pre_step_position)[1] * mm,
+                                    (*pre_step_position)[2] * mm);
+                  fHolePositions.push_back(pos);
+                  fHoleWeights.push_back(weight);
+              }
+          }
+
+          // Print results per file
+          G4cout << "File: " << full_path << G4endl;
+          G4cout << "  Electrons: " << fElectronPositions.size() << G4endl;
+          G4cout << "  Protons:   " << fProtonPositions.size() << G4endl;
+          G4cout << "  Holes:     " << fHolePositions.size() << G4endl;
+
+          file->Close();
+      }
+  }
 }
 
-void DetectorConstruction::ConstructSDandField() {
-  static auto sdManager = SDManager::GetInstance();
-  sdManager->CreateSD();
-  auto sd = sdManager->GetSD();
-  G4SDManager::GetSDMpointer()->AddNewDetector(sd);
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  std::vector<G4ThreeVector> allPositions;
-  std::vector<G4double> allCharges;
+void DetectorConstruction::BuildFieldMap()
+{
+  // runs on the master only (Construct, UpdateStages, Iterate); the workers
+  // only read the map
+  delete fieldMap_;
+  fieldMap_ = nullptr;
+
+  // the map loads and then overwrites the charges file; rebuilding the same
+  // iteration must start again from the file as it was before the first build
+  if (chargesSnapshotValid_) {
+    RestoreChargesFile();
+  } else {
+    SnapshotChargesFile();
+  }
 
+  // the map keeps references to these, so they are members
+  allPositions_.clear();
+  allCharges_.clear();
+
+  // a weighted charge stands for that many elementary charges
   G4double eCharge = -1.602e-19 * CLHEP::coulomb;
-  for (const auto& pos : fElectronPositions) {
-    allPositions.push_back(pos);
-    allCharges.push_back(eCharge);
+  for (std::size_t i = 0; i < fElectronPositions.size(); ++i) {
+    allPositions_.push_back(fElectronPositions[i]);
+    allCharges_.push_back(eCharge * fElectronWeights[i]);
   }
   G4double pCharge = +1.602e-19 * CLHEP::coulomb;
-  for (const auto& pos : fProtonPositions) {
-    allPositions.push_back(pos);
-    allCharges.push_back(pCharge);
+  for (std::size_t i = 0; i < fProtonPositions.size(); ++i) {
+    allPositions_.push_back(fProtonPositions[i]);
+    allCharges_.push_back(pCharge * fProtonWeights[i]);
   }
   G4double hCharge = +1.602e-19 * CLHEP::coulomb;
-  for (const auto& pos : fHolePositions) {
-    allPositions.push_back(pos);
-    allCharges.push_back(hCharge);
+  for (std::size_t i = 0; i < fHolePositions.size(); ++i) {
+    allPositions_.push_back(fHolePositions[i]);
+    allCharges_.push_back(hCharge * fHoleWeights[i]);
   } 
 
   G4ThreeVector min(-worldX_/2, -worldY_/2, -worldZ_/2); 
   G4ThreeVector max(worldX_/2, worldY_/2, worldZ_/2); 
   G4ThreeVector step(10*um, 10*um, 10*um);
 
-  if (!allPositions.empty() && !allCharges.empty()) {
+  if (!allPositions_.empty() && !allCharges_.empty()) {
 
     const G4double time_step_dt = equivalentIterationTime_ / second;
     G4cout << "Equivalent iteration time for charge leakage: "
@@ -358,10 +611,11 @@ void DetectorConstruction::ConstructSDandField() {
     G4cout << "   Minimum Step: " << G4BestUnit(fieldMinimumStep_,"Length") << G4endl;
 
     auto start = std::chrono::high_resolution_clock::now();
+    ThreadCoordinator::GetInstance()->BeginPrecompute();
 
     const G4double material_temperature = materialTemperature_ / kelvin;
-    auto adaptiveFieldMap = new AdaptiveSumRadialFieldMap(
-        allPositions, allCharges, 
+    fieldMap_ = new AdaptiveSumRadialFieldMap(
+        allPositions_, allCharges_, 
         fieldGradThreshold_,
         sphereSolid_,
         Epsilon_,  
@@ -374,32 +628,512 @@ void DetectorConstruction::ConstructSDandField() {
         octreeDepth_,
         initial_depth_,
         boolDissipationModel_,
-        AdaptiveSumRadialFieldMap::StorageType::Double
+        AdaptiveSumRadialFieldMap::StorageType::Double,
+        boolPBC_   // charges repeat with the world in x and y, as the tracks do
     );
 
     // End timer
+    ThreadCoordinator::GetInstance()->EndPrecompute();
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> duration = end - start;
     G4cout << "Ending Adaptive Field Map Precomputation" << G4endl;
 
     double duration_in_minutes = duration.count() / 60.0;
     G4cout << "Precomputation took " << duration_in_minutes << " minutes." << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::MarkDirty(G4int stages)
+{
+  dirty_ |= stages;
+
+  // only a new geometry needs Geant4 to rebuild the volumes; Construct then
+  // redoes every dirty stage, the others wait for UpdateStages
+  if (stages & kGeometry) G4RunManager::GetRunManager()->ReinitializeGeometry();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::UpdateStages()
+{
+  // the culled source planes follow the grains and the /source/ table
+  if (sphereSolid_) {
+    PrimarySourceTable::GetInstance()->UpdateShadows(*sphereSolid_, G4ThreeVector(worldX_/2, worldY_/2, worldZ_/2),
+                                                     boolPBC_, geometryVersion_);
+  }
+
+  if (dirty_ == 0) return;
+
+  if (dirty_ & kCharges) LoadCharges();
+
+  if (dirty_ & (kCharges | kFieldMap)) {
+    BuildFieldMap();
+  } else if ((dirty_ & kDielectric) && fieldMap_) {
+    // only the dielectric scaling of the leaves changes
+    fieldMap_->SetDielectricConstant(Epsilon_);
+    if (!filename_.empty()) fieldMap_->ExportFieldMapToFile(filename_);
+  }
+
+  dirty_ = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SnapshotChargesFile()
+{
+  std::ifstream in(charges_filename_, std::ios::binary);
+  chargesFileExisted_ = in.is_open();
+  chargesSnapshot_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  chargesSnapshotValid_ = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::RestoreChargesFile()
+{
+  if (!chargesFileExisted_) {
+    std::remove(charges_filename_.c_str());
+    return;
+  }
+
+  std::ofstream out(charges_filename_, std::ios::binary | std::ios::trunc);
+  out.write(chargesSnapshot_.data(), chargesSnapshot_.size());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::UpdateThreadField()
+{
+  // the master of an MT run does no tracking
+  if (G4Threading::IsMultithreadedApplication() && G4Threading::IsMasterThread()) return;
+  if (threadFieldManager_) threadFieldManager_->SetEnergyRatios(fieldBypassRatio_, fieldRelaxRatio_);
+  if (threadFieldMap_ == fieldMap_ && threadFieldConfig_ == fieldConfig_) return;
+
+  threadFieldMap_ = fieldMap_;
+  if (!fieldMap_) {
+    logicWorld_->SetFieldManager(nullptr, true);
+    return;
+  }
+
+  if (threadFieldManager_) {
+    // map rebuilt between iterations: swap it into the existing objects
+    threadEquation_->SetFieldObj(fieldMap_);
+  } else {
+    threadFieldManager_ = new TrackFieldManager();
+    threadFieldManager_->SetEnergyRatios(fieldBypassRatio_, fieldRelaxRatio_);
+
+    threadEquation_ = new G4EqMagElectricField(fieldMap_);
+  }
+
+  if (threadFieldConfig_ != fieldConfig_) {
+    // stepper, driver or tolerances changed since the last run on this thread
+    delete threadFieldManager_->GetChordFinder();
+    auto chordFinder = CreateChordFinder();
+    chordFinder->SetDeltaChord(fieldDeltaChord_);
+    threadFieldManager_->SetChordFinder(chordFinder);
+    // accuracy for slow tracks; faster ones are relaxed or bypassed per track
+    threadFieldManager_->SetAccuracy(fieldDeltaOneStep_, fieldMinEpsilon_, fieldMaxEpsilon_);
+    threadFieldConfig_ = fieldConfig_;
+  }
+  threadFieldManager_->SetFieldMap(fieldMap_);
+
+  logicWorld_->SetFieldManager(threadFieldManager_, true);
+
+  // inside the grains the map is only a dielectric-scaled approximation and
+  // tracks take short EM steps: by default they get a manager without a
+  // field, so the bulk is crossed with straight steps and no lookups
+  G4FieldManager* grainFieldManager = threadFieldManager_;
+  if (grainFieldPolicy_ == "none") {
+    if (!threadFreeFieldManager_) threadFreeFieldManager_ = new G4FieldManager();
+    grainFieldManager = threadFreeFieldManager_;
+  }
+  for (std::size_t i = 0; i < logicWorld_->GetNoDaughters(); ++i) {
+    auto lv = logicWorld_->GetDaughter(i)->GetLogicalVolume();
+    if (lv->GetMaterial() != logicWorld_->GetMaterial()) lv->SetFieldManager(grainFieldManager, true);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  // G4IntegrationDriver (default) or G4MagInt_Driver around any stepper
+  template <class T>
+  G4VIntegrationDriver* CreateDriver(const G4String& driver, T* stepper,
+                                     G4double minimumStep, G4int nvar)
+  {
+    if (driver == "MagInt") return new G4MagInt_Driver(minimumStep, stepper, nvar);
+    return new G4IntegrationDriver<T>(minimumStep, stepper, nvar);
+  }
+}
+
+G4ChordFinder* DetectorConstruction::CreateChordFinder() const
+{
+  const G4int nvar = 8;
+  const G4double hmin = fieldDriverMinStep_;
+
+  // the dense-output and FSAL drivers are templates for one stepper each
+  G4String driverName = fieldDriver_;
+  if ((driverName == "Interpolation" && fieldStepper_ != "DormandPrince745") ||
+      (driverName == "FSAL" && fieldStepper_ != "RK547FEq1")) {
+    G4ExceptionDescription msg;
+    msg << "Driver " << driverName << " does not work with stepper " << fieldStepper_
+        << " (Interpolation: DormandPrince745, FSAL: RK547FEq1); using Integration.";
+    G4Exception("DetectorConstruction::CreateChordFinder", "FieldDriver", JustWarning, msg);
+    driverName = "Integration";
+  }
+
+  G4VIntegrationDriver* driver = nullptr;
+  if (fieldStepper_ == "ExactLeaf") {
+    // analytic in each leaf of the map: no truncation error to control, the
+    // driver only splits steps for the chord distance
+    driver = CreateDriver(driverName, new ExactLeafStepper(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "ClassicalRK4") {
+    driver = CreateDriver(driverName, new G4ClassicalRK4(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "CashKarpRKF45") {
+    driver = CreateDriver(driverName, new G4CashKarpRKF45(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "BogackiShampine23") {
+    driver = CreateDriver(driverName, new G4BogackiShampine23(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "BogackiShampine45") {
+    driver = CreateDriver(driverName, new G4BogackiShampine45(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "TsitourasRK45") {
+    driver = CreateDriver(driverName, new G4TsitourasRK45(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "SimpleHeum") {
+    driver = CreateDriver(driverName, new G4SimpleHeum(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "SimpleRunge") {
+    driver = CreateDriver(driverName, new G4SimpleRunge(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "ExplicitEuler") {
+    driver = CreateDriver(driverName, new G4ExplicitEuler(threadEquation_, nvar), hmin, nvar);
+  } else if (fieldStepper_ == "RK547FEq1") {
+    auto stepper = new G4RK547FEq1(threadEquation_, nvar);
+    driver = (driverName == "FSAL")
+           ? new G4FSALIntegrationDriver<G4RK547FEq1>(hmin, stepper, nvar)
+           : CreateDriver(driverName, stepper, hmin, nvar);
+  } else {
+    auto stepper = new G4DormandPrince745(threadEquation_, nvar);
+    driver = (driverName == "Interpolation")
+           ? new G4InterpolationDriver<G4DormandPrince745>(hmin, stepper, nvar)
+           : CreateDriver(driverName, stepper, hmin, nvar);
+  }
+  return new G4ChordFinder(driver);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::Iterate(G4int iterations)
+{
+  if (eventsPerIteration_ <= 0) {
+    G4Exception("DetectorConstruction::Iterate", "NoEvents", JustWarning,
+                "Set the number of events with /charging/events first.");
+    return;
+  }
+
+  auto runManager = G4RunManager::GetRunManager();
+  auto collector = ChargeCollector::GetInstance();
+  const G4String outputBase = SDManager::GetOutputFile();
+  const G4String fieldBase = filename_;
+  const G4double planeArea = worldX_*worldY_;
+  const G4double baseTime = equivalentIterationTime_;
+  const G4bool chunked = targetError_ > 0.;
+
+  if (chargingFlux_ > 0. && PrimarySourceTable::GetInstance()->GetPrimariesPerEvent() > 1) {
+    G4Exception("DetectorConstruction::Iterate", "PrimariesPerEvent", JustWarning,
+                "The reference particle is counted per event; with /source/perEvent > 1 "
+                "the iteration time is underestimated by up to that factor.");
+  }
+
+  // achieved event counts of a convergence-driven run, next to the outputs
+  std::ofstream eventsFile;
+  if (chunked) {
+    std::filesystem::path path(outputBase.empty() ? G4String("charging") : outputBase);
+    path.replace_extension();
+    eventsFile.open(path.string() + "_events.txt");
+    eventsFile << "# iteration events chunks relative_error reference_count iteration_time_s outputs"
+               << std::endl;
+  }
+
+  collector->SetEnabled(true);
+
+  for (G4int i = 0; i < iterations; ++i) {
+    G4cout << "=== Charging iteration " << i + 1 << " of " << iterations << " ===" << G4endl;
+
+    const G4String output = i > 0 ? IterationFileName(outputBase, i) : outputBase;
+    SDManager::SetOutputFile(output);
+    collector->Reset();
+
+    G4int events = eventsPerIteration_;
+    G4double error = 0.;
+    std::vector<G4String> outputs;
+    if (chunked) {
+      events = BeamOnConverged(output, i + 1 < iterations, outputs, error);
+    } else {
+      runManager->BeamOn(eventsPerIteration_);
+    }
+
+    // time of the lunar flux equivalent to the simulated reference particles;
+    // without a flux, /geometry/IterationTime is the time of /charging/events
+    const G4double count = collector->GetReferenceCount();
+    G4double iterationTime = equivalentIterationTime_;
+    if (chargingFlux_ > 0.) {
+      iterationTime = count / (planeArea/m2) / chargingFlux_ * second;
+    } else if (chunked) {
+      iterationTime = baseTime * events / eventsPerIteration_;
+    }
+
+    if (chunked) {
+      G4cout << "Iteration " << i + 1 << " ran " << events << " events" << G4endl;
+      eventsFile << i << " " << events << " " << events / eventsPerIteration_ << " "
+                 << error << " " << count << " " << iterationTime / second;
+      for (const auto& name : outputs) eventsFile << " " << name;
+      eventsFile << std::endl;
+    }
+
+    // the charges of the last iteration are left to its output file, so a
+    // following job continues from it and the charges file as before
+    if (i + 1 == iterations) break;
+
+    // the new charges replace the input of the previous map; older charges
+    // come back through the charges file, as between separate jobs
+    if (!chunked) {
+      collector->Take(fElectronPositions, fProtonPositions, fHolePositions,
+                      fElectronWeights, fProtonWeights, fHoleWeights);
+    }
+    G4cout << "Collected charges" << G4endl;
+    G4cout << "  Electrons: " << fElectronPositions.size() << G4endl;
+    G4cout << "  Protons:   " << fProtonPositions.size() << G4endl;
+    G4cout << "  Holes:     " << fHolePositions.size() << G4endl;
+
+    if (chargingFlux_ > 0. || chunked) {
+      equivalentIterationTime_ = iterationTime;
+      G4cout << count << " " << collector->GetReferenceParticle() << " events -> iteration time "
+             << G4BestUnit(equivalentIterationTime_, "Time") << G4endl;
+    }
+
+    if (!fieldBase.empty()) filename_ = IterationFileName(fieldBase, i + 1);
+    // a new iteration continues from the charges file of the previous one
+    chargesSnapshotValid_ = false;
+    BuildFieldMap();
+  }
+
+  collector->SetEnabled(false);
+  SDManager::SetOutputFile(outputBase);
+  filename_ = fieldBase;
+  // the scaled time of a chunked run does not outlive it
+  if (chunked && chargingFlux_ <= 0.) equivalentIterationTime_ = baseTime;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int DetectorConstruction::BeamOnConverged(const G4String& output, G4bool keepCharges,
+                                            std::vector<G4String>& outputs, G4double& error)
+{
+  auto runManager = G4RunManager::GetRunManager();
+  auto collector = ChargeCollector::GetInstance();
+  auto cache = PhotonStageCache::GetInstance();
+
+  const G4int maxEvents = maxEventsPerIteration_ > 0
+                        ? maxEventsPerIteration_ : 100*eventsPerIteration_;
+  const G4int maxChunks = std::max(maxEvents / eventsPerIteration_, 1);
+  const G4bool useField = convergenceMeasure_ == "field" && !probes_.empty();
+  if (convergenceMeasure_ == "field" && probes_.empty()) {
+    G4Exception("DetectorConstruction::BeamOnConverged", "NoProbes", JustWarning,
+                "No probe points (/charging/probe); converging on the charge instead.");
+  }
+
+  const G4ThreeVector halfWorld(worldX_/2, worldY_/2, worldZ_/2);
+  ChargeConvergence convergence(-halfWorld, halfWorld, convergenceCells_, probes_);
+
+  std::vector<G4ThreeVector> electrons, protons, holes;
+  std::vector<G4double> electronWeights, protonWeights, holeWeights;
+  std::vector<G4ThreeVector> chunkElectrons, chunkProtons, chunkHoles;
+  std::vector<G4double> chunkElectronWeights, chunkProtonWeights, chunkHoleWeights;
+  std::vector<G4ThreeVector> positions;
+  std::vector<G4double> charges;
+
+  G4int events = 0;
+  error = DBL_MAX;
+  for (G4int chunk = 0; chunk < maxChunks; ++chunk) {
+    // every chunk writes its own file, a reopened output would be replaced
+    const G4String name = chunk > 0 ? ChunkFileName(output, chunk) : output;
+    SDManager::SetOutputFile(name);
+    outputs.push_back(name);
+
+    // a recorded photon stage continues instead of replaying the first chunk
+    cache->SetEventOffset(static_cast<G4long>(chunk)*eventsPerIteration_);
+    runManager->BeamOn(eventsPerIteration_);
+    events += eventsPerIteration_;
+
+    // the reference count is kept by Take and sums over the chunks
+    collector->Take(chunkElectrons, chunkProtons, chunkHoles,
+                    chunkElectronWeights, chunkProtonWeights, chunkHoleWeights);
+
+    positions.clear();
+    charges.clear();
+    for (std::size_t k = 0; k < chunkElectrons.size(); ++k) {
+      positions.push_back(chunkElectrons[k]);
+      charges.push_back(-chunkElectronWeights[k]);
+    }
+    for (std::size_t k = 0; k < chunkProtons.size(); ++k) {
+      positions.push_back(chunkProtons[k]);
+      charges.push_back(chunkProtonWeights[k]);
+    }
+    for (std::size_t k = 0; k < chunkHoles.size(); ++k) {
+      positions.push_back(chunkHoles[k]);
+      charges.push_back(chunkHoleWeights[k]);
+    }
+    convergence.AddChunk(positions, charges);
+
+    electrons.insert(electrons.end(), chunkElectrons.begin(), chunkElectrons.end());
+    protons.insert(protons.end(), chunkProtons.begin(), chunkProtons.end());
+    holes.insert(holes.end(), chunkHoles.begin(), chunkHoles.end());
+    electronWeights.insert(electronWeights.end(), chunkElectronWeights.begin(), chunkElectronWeights.end());
+    protonWeights.insert(protonWeights.end(), chunkProtonWeights.begin(), chunkProtonWeights.end());
+    holeWeights.insert(holeWeights.end(), chunkHoleWeights.begin(), chunkHoleWeights.end());
+
+    error = useField ? convergence.FieldError() : convergence.ChargeError();
+    G4cout << "Chunk " << chunk + 1 << ": " << events << " events, relative "
+           << (useField ? "field" : "charge") << " uncertainty ";
+    if (error == DBL_MAX) G4cout << "not yet known" << G4endl;
+    else G4cout << error << G4endl;
+
+    if (error <= targetError_) break;
+  }
+
+  cache->SetEventOffset(0);
 
-    auto worldFM = new G4FieldManager();
-    worldFM->SetDetectorField(adaptiveFieldMap); 
-    worldFM->SetMinimumEpsilonStep(1.0e-7);
-    worldFM->SetMaximumEpsilonStep(1.0e-4);
-    worldFM->SetDeltaOneStep(0.1*um);
+  if (error > targetError_) {
+    G4ExceptionDescription msg;
+    msg << "The relative uncertainty did not reach " << targetError_ << " within "
+        << events << " events (/charging/maxEvents); the iteration goes on with it.";
+    G4Exception("DetectorConstruction::BeamOnConverged", "NotConverged", JustWarning, msg);
+  }
+
+  if (keepCharges) {
+    fElectronPositions = std::move(electrons);
+    fProtonPositions = std::move(protons);
+    fHolePositions = std::move(holes);
+    fElectronWeights = std::move(electronWeights);
+    fProtonWeights = std::move(protonWeights);
+    fHoleWeights = std::move(holeWeights);
+  }
+  return events;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String DetectorConstruction::IterationFileName(const G4String& name, G4int iteration)
+{
+  std::ostringstream suffix;
+  suffix << "_it" << std::setw(3) << std::setfill('0') << iteration;
 
-    auto equation = new G4EqMagElectricField(adaptiveFieldMap);
-    const G4int nvar = 8;
-    auto stepper = new G4DormandPrince745(equation, nvar);
-    auto driver  = new G4IntegrationDriver<G4DormandPrince745>(0.1*um, stepper, nvar);
-    auto chord   = new G4ChordFinder(driver);
-    worldFM->SetChordFinder(chord);
+  std::filesystem::path path(name);
+  const std::string extension = path.extension().string();
+  path.replace_extension();
+  return path.string() + suffix.str() + extension;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String DetectorConstruction::ChunkFileName(const G4String& name, G4int chunk)
+{
+  std::ostringstream suffix;
+  suffix << "_c" << std::setw(3) << std::setfill('0') << chunk;
+
+  std::filesystem::path path(name);
+  const std::string extension = path.extension().string();
+  path.replace_extension();
+  return path.string() + suffix.str() + extension;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::LoadBinaryCharges(const std::string& directory)
+{
+  const G4int width = BinaryHitWriter::kStringWidth;
+
+  auto readColumn = [&directory](const char* name, std::vector<char>& bytes) {
+    std::ifstream in(directory + "/" + name + ".bin", std::ios::binary | std::ios::ate);
+    if (!in.is_open()) return false;
+    bytes.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(bytes.data(), bytes.size());
+    return in.good();
+  };
+
+  std::vector<char> particle, volume_post, process_pre, process_post, ke_post, parent, pre_pos, post_pos;
+  if (!readColumn("Particle_Type", particle) || !readColumn("Volume_Name_Post", volume_post) ||
+      !readColumn("Process_Name_Pre", process_pre) || !readColumn("Process_Name_Post", process_post) ||
+      !readColumn("Kinetic_Energy_Post_MeV", ke_post) ||
+      !readColumn("Parent_ID", parent) || !readColumn("Pre_Step_Position_mm", pre_pos) ||
+      !readColumn("Post_Step_Position_mm", post_pos)) {
+    std::cout << "Failed to read binary columns in: " << directory << std::endl;
+    return;
+  }
+  std::cout << directory << " successfully loaded!" << std::endl;
+  // output written before the weights were added holds unit weights
+  std::vector<char> weights;
+  const G4bool weighted = readColumn("Weight", weights);
+
+  auto is = [width](const std::vector<char>& column, size_t row, const char* value) {
+    return std::strncmp(column.data() + row*width, value, width) == 0;
+  };
+  auto dbl = [](const std::vector<char>& column, size_t index) {
+    double value;
+    std::memcpy(&value, column.data() + index*sizeof(double), sizeof(double));
+    return value;
+  };
+
+  // same selection as for the ROOT input
+  const PrimarySourceTable* primaries = PrimarySourceTable::GetInstance();
+  const size_t nEntries = particle.size() / width;
+  for (size_t i = 0; i < nEntries; i++) {
+    const G4bool stopped_in_target = dbl(ke_post, i) == 0.0
+        && (is(volume_post, i, "SiO2") || is(process_post, i, LooperWatchdogProcess::kProcessName));
+    const G4ThreeVector post(dbl(post_pos, 3*i)*mm, dbl(post_pos, 3*i + 1)*mm, dbl(post_pos, 3*i + 2)*mm);
+
+    const G4double weight = weighted ? dbl(weights, i) : 1.;
+
+    if (is(particle, i, "e-") && stopped_in_target) {
+      fElectronPositions.push_back(post);
+      fElectronWeights.push_back(weight);
+    }
+    if (is(particle, i, "proton") && stopped_in_target) {
+      fProtonPositions.push_back(post);
+      fProtonWeights.push_back(weight);
+    }
+
+    if (is(particle, i, "e-") && primaries->IsPrimaryTrack(static_cast<G4int>(dbl(parent, i))) && is(process_pre, i, "initStep")) {
+      fHolePositions.push_back(G4ThreeVector(dbl(pre_pos, 3*i)*mm, dbl(pre_pos, 3*i + 1)*mm, dbl(pre_pos, 3*i + 2)*mm));
+      fHoleWeights.push_back(weight);
+    }
+  }
+
+  G4cout << "File: " << directory << G4endl;
+  G4cout << "  Electrons: " << fElectronPositions.size() << G4endl;
+  G4cout << "  Protons:   " << fProtonPositions.size() << G4endl;
+  G4cout << "  Holes:     " << fHolePositions.size() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-    logicWorld_->SetFieldManager(worldFM, true);
+void DetectorConstruction::ConstructSDandField() {
+  static auto sdManager = SDManager::GetInstance();
+  // the SD is created once per thread; a new geometry only reattaches it
+  if (!sdManager->GetSD()) {
+    sdManager->CreateSD();
+    G4SDManager::GetSDMpointer()->AddNewDetector(sdManager->GetSD());
   }
+  auto sd = sdManager->GetSD();
+
+  // the field map is shared read-only by all threads (built in Construct);
+  // field manager, equation, stepper and chord finder are per thread and
+  // survive geometry rebuilds: forgetting the map makes UpdateThreadField
+  // swap it in and attach the manager to the new logical volumes
+  threadFieldMap_ = nullptr;
+  UpdateThreadField();
+
   //Set all the Daughters & World as sensitive Detectors
   G4int nD = logicWorld_->GetNoDaughters();
   for (G4int i = 0; i < nD; ++i) {
@@ -413,115 +1147,229 @@ void DetectorConstruction::ConstructSDandField() {
   // only for creating figures of deflection and scattering of particles outside geometry
   // otherwise uncomment this (makes ROOT files unnecessarily large)
   logicWorld_->SetSensitiveDetector(sd);
+
+  // near-surface photoabsorption biasing (/biasing/skin): one operator per
+  // thread, reattached to the grains of every new geometry
+  if (SkinBiasingOperator::IsAvailable()) {
+    static G4ThreadLocal SkinBiasingOperator* skinOperator = nullptr;
+    if (!skinOperator) skinOperator = new SkinBiasingOperator();
+    for (G4int i = 0; i < nD; ++i) {
+      auto lv = logicWorld_->GetDaughter(i)->GetLogicalVolume();
+      if (lv->GetMaterial() != logicWorld_->GetMaterial()) skinOperator->AttachTo(lv);
+    }
+  }
+
+  // tabulated photoemission in the grain region (/surrogate/mode): one model
+  // per thread, the region keeps it across new geometries
+  if (SurrogateEmissionModel::IsAvailable()) {
+    static G4ThreadLocal SurrogateEmissionModel* surrogate = nullptr;
+    if (!surrogate) surrogate = new SurrogateEmissionModel(SurrogateEmissionModel::GetRegion());
+  }
 }
 
 
 void DetectorConstruction::SetPBC(G4bool value)
 {
   boolPBC_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
 
 void DetectorConstruction::SetWorldX(G4double value)
 {
   worldX_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
 
 void DetectorConstruction::SetWorldY(G4double value)
 {
   worldY_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
 
 void DetectorConstruction::SetWorldZ(G4double value)
 {
   worldZ_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
 
 void DetectorConstruction::SetEpsilon(G4double value)
 {
   Epsilon_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kDielectric);
 }
 
 void DetectorConstruction::SetMaterialDensity(G4double value)
 {
   density_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
  
 
 void DetectorConstruction::SetRootInput(G4String value)
 {
   RootInput_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kCharges);
 }
  
 
 void DetectorConstruction::SetChargesFile(G4String value)
 {
   charges_filename_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  // a different file: take a fresh snapshot at the next build
+  chargesSnapshotValid_ = false;
+  MarkDirty(kFieldMap);
 }
 
 void DetectorConstruction::SetCADFile(G4String value)
 {
   CADFile_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
  
 void DetectorConstruction::SetCADScale(G4double value)
 {
   Scale_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
+}
+
+void DetectorConstruction::SetCADSolid(G4String value)
+{
+  cadSolidType_ = value;
+  MarkDirty(kGeometry);
+}
+
+void DetectorConstruction::SetCADSplit(G4bool value)
+{
+  splitGrains_ = value;
+  MarkDirty(kGeometry);
+}
+
+void DetectorConstruction::SetSpheresFile(G4String value)
+{
+  spheresFile_ = value;
+  MarkDirty(kGeometry);
+}
+
+void DetectorConstruction::SetCADCache(G4bool value)
+{
+  useMeshCache_ = value;
+  // only where the next read of the CAD file comes from
 }
 
 void DetectorConstruction::SetFieldFile(G4String value)
 {
   filename_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  // output name only, used by the next build of the map
 }
 
 void DetectorConstruction::SetFieldMinimumStep(G4double value)
 {
   fieldMinimumStep_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
 }
 
 void DetectorConstruction::SetFieldGradThreshold(G4double value)
 {
   fieldGradThreshold_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
+}
+
+void DetectorConstruction::SetFieldBypassRatio(G4double value)
+{
+  // picked up by every thread in UpdateThreadField at the next run
+  fieldBypassRatio_ = value;
+}
+
+void DetectorConstruction::SetFieldRelaxRatio(G4double value)
+{
+  fieldRelaxRatio_ = value;
+}
+
+void DetectorConstruction::SetFieldStepper(G4String value)
+{
+  // picked up by every thread in UpdateThreadField at the next run
+  fieldStepper_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldDriver(G4String value)
+{
+  fieldDriver_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldDeltaOneStep(G4double value)
+{
+  fieldDeltaOneStep_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldMinEpsilon(G4double value)
+{
+  fieldMinEpsilon_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldMaxEpsilon(G4double value)
+{
+  fieldMaxEpsilon_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldDeltaChord(G4double value)
+{
+  fieldDeltaChord_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetFieldDriverMinimumStep(G4double value)
+{
+  fieldDriverMinStep_ = value;
+  fieldConfig_++;
+}
+
+void DetectorConstruction::SetGrainFieldPolicy(G4String value)
+{
+  grainFieldPolicy_ = value;
+  fieldConfig_++;
 }
 
 void DetectorConstruction::SetOctreeMaxDepth(G4double value)
 {
   octreeDepth_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
 }
 
 void DetectorConstruction::SetMaterialTemperature(G4double value)
 {
   materialTemperature_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kGeometry);
 }
 
 void DetectorConstruction::SetEquivalentIterationTime(G4double value)
 {
   equivalentIterationTime_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
+}
+
+void DetectorConstruction::SetEventsPerIteration(G4int value)
+{
+  eventsPerIteration_ = value;
+}
+
+void DetectorConstruction::SetChargingFlux(G4double value)
+{
+  chargingFlux_ = value;
 }
 
 void DetectorConstruction::SetInitialDepth(G4double value)
 {
   initial_depth_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
 }
 
 void DetectorConstruction::SetChargeDissipationModel(G4bool value)
 {
   boolDissipationModel_ = value;
-  G4RunManager::GetRunManager()->ReinitializeGeometry();
+  MarkDirty(kFieldMap);
 }
\ No newline at end of file
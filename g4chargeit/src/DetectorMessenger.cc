@@ -40,6 +40,18 @@
 #include "G4UIcmdWithADouble.hh"
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWith3Vector.hh"
+#include "G4UIcmdWith3VectorAndUnit.hh"
+#include "G4UIcmdWithoutParameter.hh"
+#include "SDManager.hh"
+#include "ChargeCollector.hh"
+#include "PrimarySourceTable.hh"
+#include "SkinBiasingOperator.hh"
+#include "TrappedElectronProcess.hh"
+#include "LooperWatchdogProcess.hh"
+#include "PhotonStageCache.hh"
+#include "SurrogateEmissionModel.hh"
 
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -48,19 +60,60 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction * Det)
 :G4UImessenger(), 
  detector_(Det), rootManager_(G4RootAnalysisManager::Instance()), 
  fileNameCmd_(0), PBCCmd_(0), EpsilonCmd_(0), WorldXCmd_(0),WorldYCmd_(0), WorldZCmd_(0), 
- FieldMinimumStepCmd_(0), FieldGradThresholdCmd_(0), RootInputCmd_(nullptr), CADFileCmd_(nullptr), ScaleCmd_(0), 
+ FieldMinimumStepCmd_(0), FieldGradThresholdCmd_(0), FieldStepperCmd_(nullptr), FieldDriverCmd_(nullptr), FieldDeltaOneStepCmd_(0), FieldMinEpsilonCmd_(0), FieldMaxEpsilonCmd_(0), FieldDeltaChordCmd_(0), FieldDriverMinStepCmd_(0), FieldInsideGrainsCmd_(nullptr), FieldBypassRatioCmd_(0), FieldRelaxRatioCmd_(0), RootInputCmd_(nullptr), CADFileCmd_(nullptr), ScaleCmd_(0), CADCacheCmd_(0), CADSolidCmd_(nullptr), CADSplitCmd_(0),
+ SpheresDir_(nullptr), SpheresFileCmd_(nullptr),
  FieldFileCmd_(nullptr),ChargesFileCmd_(nullptr), EquivalentIterationTimeCmd_(0), MaterialTemperatureCmd_(0), MaterialDensityCmd_(0),
- InitialDepthCmd_(0)
+ InitialDepthCmd_(0), OutputFormatCmd_(nullptr), AsyncOutputCmd_(0), OutputBuffersCmd_(0), OutputBatchRowsCmd_(0),
+ ChargingDir_(nullptr), IterateCmd_(0), EventsPerIterationCmd_(0), ChargingFluxCmd_(0), ReferenceParticleCmd_(nullptr),
+ TrapElectronsCmd_(0), TrapMaxEnergyCmd_(0), TargetErrorCmd_(0), MaxEventsCmd_(0), ConvergenceCmd_(nullptr),
+ ConvergenceCellsCmd_(0), ProbeCmd_(0), ClearProbesCmd_(0),
+ SourceDir_(nullptr), SourceGeneratorCmd_(nullptr), SourcePerEventCmd_(0), SourceAddCmd_(0), SourceIntensityCmd_(0),
+ SourceParticleCmd_(nullptr), SourceSpectrumCmd_(nullptr), SourceInterpolationCmd_(nullptr), SourceCentreCmd_(0),
+ SourceHalfXCmd_(0), SourceHalfYCmd_(0), SourceDirectionCmd_(0), SourceIsotropicCmd_(0),
+ SourceMinEnergyCmd_(0), SourceTailEnergyCmd_(0), SourceTailFactorCmd_(0), SourceCullCmd_(0), SourceCullCellsCmd_(0), SourceCacheCmd_(nullptr), SourceCacheFileCmd_(nullptr),
+ BiasingDir_(nullptr), BiasingSkinCmd_(0), BiasingSkinFactorCmd_(0),
+ LooperDir_(nullptr), LooperMaxStepsCmd_(0), LooperPathCmd_(0), LooperDisplacementCmd_(0),
+ LooperVacuumTimeCmd_(0), LooperPolicyCmd_(nullptr),
+ SurrogateDir_(nullptr), SurrogateModeCmd_(nullptr), SurrogateTableCmd_(nullptr)
  
 { 
+  // created here, on the master, before any worker uses it
+  ChargeCollector::GetInstance();
+  PrimarySourceTable::GetInstance();
+  PhotonStageCache::GetInstance();
 
   fileNameCmd_ = new G4UIcmdWithAString("/geometry/rootoutput/file",this);
   fileNameCmd_->SetGuidance("Define the filename.");
   fileNameCmd_->SetParameterName("choice",false);
   fileNameCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
 
+  OutputFormatCmd_ = new G4UIcmdWithAString("/geometry/rootoutput/format",this);
+  OutputFormatCmd_->SetGuidance("Hit output backend: ROOT ntuple or binary column files.");
+  OutputFormatCmd_->SetGuidance("binary writes <file>.cols/<column>.bin plus header.json.");
+  OutputFormatCmd_->SetParameterName("choice",false);
+  OutputFormatCmd_->SetCandidates("root binary");
+  OutputFormatCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  AsyncOutputCmd_ = new G4UIcmdWithABool("/geometry/rootoutput/async",this);
+  AsyncOutputCmd_->SetGuidance("Write binary hit columns from a background thread (ignored for ROOT output).");
+  AsyncOutputCmd_->SetParameterName("choice",false);
+  AsyncOutputCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  OutputBuffersCmd_ = new G4UIcmdWithAnInteger("/geometry/rootoutput/buffers",this);
+  OutputBuffersCmd_->SetGuidance("Number of hit batches queued for the background writer (minimum 2).");
+  OutputBuffersCmd_->SetParameterName("choice",false);
+  OutputBuffersCmd_->SetRange("choice>=2");
+  OutputBuffersCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  OutputBatchRowsCmd_ = new G4UIcmdWithAnInteger("/geometry/rootoutput/batchSize",this);
+  OutputBatchRowsCmd_->SetGuidance("Number of hits collected before a batch is handed to the writer.");
+  OutputBatchRowsCmd_->SetParameterName("choice",false);
+  OutputBatchRowsCmd_->SetRange("choice>0");
+  OutputBatchRowsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
   PBCCmd_ = new G4UIcmdWithABool("/geometry/PBC",this);
   PBCCmd_->SetGuidance("PBC conditions on or off.");
+  PBCCmd_->SetGuidance("With PBC the field map also sums the periodic x/y images of the charges.");
   PBCCmd_->SetParameterName("choice",false);
   PBCCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
 
@@ -84,6 +137,36 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction * Det)
   ScaleCmd_->SetParameterName("choice",false);
   ScaleCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
 
+  CADCacheCmd_ = new G4UIcmdWithABool("/geometry/cadinput/cache", this);
+  CADCacheCmd_->SetGuidance("Read and write the <file>.meshcache sidecar of STL input (default true).");
+  CADCacheCmd_->SetGuidance("The cache holds the parsed, deduplicated mesh and is refreshed when the STL changes.");
+  CADCacheCmd_->SetParameterName("choice",false);
+  CADCacheCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  CADSolidCmd_ = new G4UIcmdWithAString("/geometry/cadinput/solid", this);
+  CADSolidCmd_->SetGuidance("Solid built from the STL mesh.");
+  CADSolidCmd_->SetGuidance("tessellated: G4TessellatedSolid with voxels (default).");
+  CADSolidCmd_->SetGuidance("bvh: BVHTessellatedSolid, navigation through a bounding volume hierarchy.");
+  CADSolidCmd_->SetParameterName("choice",false);
+  CADSolidCmd_->SetCandidates("tessellated bvh");
+  CADSolidCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  CADSplitCmd_ = new G4UIcmdWithABool("/geometry/cadinput/split", this);
+  CADSplitCmd_->SetGuidance("Place every connected grain of the STL mesh as its own SiO2 volume.");
+  CADSplitCmd_->SetGuidance("The navigator then skips whole grains by their bounding boxes.");
+  CADSplitCmd_->SetParameterName("choice",false);
+  CADSplitCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SpheresDir_ = new G4UIdirectory("/geometry/spheres/");
+  SpheresDir_->SetGuidance("Grains as analytic spheres instead of a CAD mesh.");
+
+  SpheresFileCmd_ = new G4UIcmdWithAString("/geometry/spheres/file", this);
+  SpheresFileCmd_->SetGuidance("Text file in geometry/ with one \"x y z radius\" line (mm) per sphere.");
+  SpheresFileCmd_->SetGuidance("Replaces /geometry/cadinput/file; every sphere becomes a G4Orb daughter,");
+  SpheresFileCmd_->SetGuidance("or one G4MultiUnion volume if any two spheres overlap.");
+  SpheresFileCmd_->SetParameterName("choice",false);
+  SpheresFileCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
   WorldXCmd_ = new G4UIcmdWithADoubleAndUnit("/geometry/worldX", this);
   WorldXCmd_->SetGuidance("Set XY Scale of the World.");
   WorldXCmd_->SetParameterName("choice",false);
@@ -129,6 +212,80 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction * Det)
   FieldGradThresholdCmd_->SetParameterName("choice",false);
   FieldGradThresholdCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
 
+  FieldStepperCmd_ = new G4UIcmdWithAString("/field/Stepper", this);
+  FieldStepperCmd_->SetGuidance("Integration of charged tracks in the field map.");
+  FieldStepperCmd_->SetGuidance("DormandPrince745: Runge-Kutta 5(4) with error control (default).");
+  FieldStepperCmd_->SetGuidance("ExactLeaf: exact uniform-field solution from leaf to leaf of the map.");
+  FieldStepperCmd_->SetGuidance("Other Geant4 steppers: ClassicalRK4, CashKarpRKF45, BogackiShampine45,");
+  FieldStepperCmd_->SetGuidance("TsitourasRK45, RK547FEq1 (FSAL) and the low-order BogackiShampine23,");
+  FieldStepperCmd_->SetGuidance("SimpleRunge, SimpleHeum and ExplicitEuler.");
+  FieldStepperCmd_->SetParameterName("choice",false);
+  FieldStepperCmd_->SetCandidates("DormandPrince745 ExactLeaf ClassicalRK4 CashKarpRKF45 BogackiShampine23 "
+                                  "BogackiShampine45 TsitourasRK45 SimpleHeum SimpleRunge ExplicitEuler RK547FEq1");
+  FieldStepperCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldDriverCmd_ = new G4UIcmdWithAString("/field/Driver", this);
+  FieldDriverCmd_->SetGuidance("Driver of the field stepper.");
+  FieldDriverCmd_->SetGuidance("Integration: G4IntegrationDriver (default). MagInt: G4MagInt_Driver.");
+  FieldDriverCmd_->SetGuidance("Interpolation: G4InterpolationDriver, DormandPrince745 only.");
+  FieldDriverCmd_->SetGuidance("FSAL: G4FSALIntegrationDriver, RK547FEq1 only.");
+  FieldDriverCmd_->SetParameterName("choice",false);
+  FieldDriverCmd_->SetCandidates("Integration MagInt Interpolation FSAL");
+  FieldDriverCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldDeltaOneStepCmd_ = new G4UIcmdWithADoubleAndUnit("/field/DeltaOneStep", this);
+  FieldDeltaOneStepCmd_->SetGuidance("Position accuracy of a field step (default 0.1 um).");
+  FieldDeltaOneStepCmd_->SetParameterName("choice",false);
+  FieldDeltaOneStepCmd_->SetRange("choice>0");
+  FieldDeltaOneStepCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldMinEpsilonCmd_ = new G4UIcmdWithADouble("/field/MinEpsilonStep", this);
+  FieldMinEpsilonCmd_->SetGuidance("Minimum relative accuracy of a field step (default 1e-7).");
+  FieldMinEpsilonCmd_->SetParameterName("choice",false);
+  FieldMinEpsilonCmd_->SetRange("choice>0");
+  FieldMinEpsilonCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldMaxEpsilonCmd_ = new G4UIcmdWithADouble("/field/MaxEpsilonStep", this);
+  FieldMaxEpsilonCmd_->SetGuidance("Maximum relative accuracy of a field step (default 1e-4).");
+  FieldMaxEpsilonCmd_->SetParameterName("choice",false);
+  FieldMaxEpsilonCmd_->SetRange("choice>0");
+  FieldMaxEpsilonCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldDeltaChordCmd_ = new G4UIcmdWithADoubleAndUnit("/field/DeltaChord", this);
+  FieldDeltaChordCmd_->SetGuidance("Largest distance between a chord and the curved track (default 0.25 mm).");
+  FieldDeltaChordCmd_->SetParameterName("choice",false);
+  FieldDeltaChordCmd_->SetRange("choice>0");
+  FieldDeltaChordCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldDriverMinStepCmd_ = new G4UIcmdWithADoubleAndUnit("/field/DriverMinimumStep", this);
+  FieldDriverMinStepCmd_->SetGuidance("Smallest step the field driver attempts (default 0.1 um).");
+  FieldDriverMinStepCmd_->SetParameterName("choice",false);
+  FieldDriverMinStepCmd_->SetRange("choice>0");
+  FieldDriverMinStepCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldInsideGrainsCmd_ = new G4UIcmdWithAString("/field/InsideGrains", this);
+  FieldInsideGrainsCmd_->SetGuidance("Field inside the grain volumes.");
+  FieldInsideGrainsCmd_->SetGuidance("none: field-free transport in the bulk (default).");
+  FieldInsideGrainsCmd_->SetGuidance("map: the dielectric-scaled field map, as in vacuum.");
+  FieldInsideGrainsCmd_->SetParameterName("choice",false);
+  FieldInsideGrainsCmd_->SetCandidates("none map");
+  FieldInsideGrainsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldBypassRatioCmd_ = new G4UIcmdWithADouble("/field/BypassEnergyRatio", this);
+  FieldBypassRatioCmd_->SetGuidance("Tracks whose kinetic energy exceeds this many times the largest");
+  FieldBypassRatioCmd_->SetGuidance("potential energy change in the field map are not deflected (0: never).");
+  FieldBypassRatioCmd_->SetParameterName("choice",false);
+  FieldBypassRatioCmd_->SetRange("choice>=0");
+  FieldBypassRatioCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FieldRelaxRatioCmd_ = new G4UIcmdWithADouble("/field/RelaxEnergyRatio", this);
+  FieldRelaxRatioCmd_->SetGuidance("Tracks whose kinetic energy exceeds this many times the largest");
+  FieldRelaxRatioCmd_->SetGuidance("potential energy change in the field map are integrated with");
+  FieldRelaxRatioCmd_->SetGuidance("10 times looser accuracy limits (0: never).");
+  FieldRelaxRatioCmd_->SetParameterName("choice",false);
+  FieldRelaxRatioCmd_->SetRange("choice>=0");
+  FieldRelaxRatioCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
   FieldOctreeDepthCmd_ = new G4UIcmdWithADouble("/field/OctreeDepth", this);
   FieldOctreeDepthCmd_->SetGuidance("Set maximum depth for Octree adaptive mesh.");
   FieldOctreeDepthCmd_->SetParameterName("choice",false);
@@ -149,6 +306,294 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction * Det)
   ChargesFileCmd_->SetParameterName("choice",false);
   ChargesFileCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
 
+  ChargingDir_ = new G4UIdirectory("/charging/");
+  ChargingDir_->SetGuidance("Charging iterations inside one process.");
+
+  IterateCmd_ = new G4UIcmdWithAnInteger("/charging/iterate",this);
+  IterateCmd_->SetGuidance("Run N iterations: beamOn, collect the deposited charges in memory,");
+  IterateCmd_->SetGuidance("rebuild the field map with dissipation and continue.");
+  IterateCmd_->SetGuidance("Iteration k > 0 writes <output>_it<k>.root and <fieldmap>_it<k>.");
+  IterateCmd_->SetParameterName("iterations",false);
+  IterateCmd_->SetRange("iterations>0");
+  IterateCmd_->AvailableForStates(G4State_Idle);
+
+  EventsPerIterationCmd_ = new G4UIcmdWithAnInteger("/charging/events",this);
+  EventsPerIterationCmd_->SetGuidance("Number of events of every iteration.");
+  EventsPerIterationCmd_->SetParameterName("events",false);
+  EventsPerIterationCmd_->SetRange("events>0");
+  EventsPerIterationCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ChargingFluxCmd_ = new G4UIcmdWithADouble("/charging/flux",this);
+  ChargingFluxCmd_->SetGuidance("Flux of the reference particle (per m2 per s) for the iteration time.");
+  ChargingFluxCmd_->SetGuidance("0 keeps /geometry/IterationTime for every iteration.");
+  ChargingFluxCmd_->SetParameterName("flux",false);
+  ChargingFluxCmd_->SetRange("flux>=0");
+  ChargingFluxCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ReferenceParticleCmd_ = new G4UIcmdWithAString("/charging/referenceParticle",this);
+  ReferenceParticleCmd_->SetGuidance("Particle counted for the iteration time (e.g. proton, gamma).");
+  ReferenceParticleCmd_->SetParameterName("particle",false);
+  ReferenceParticleCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  TrapElectronsCmd_ = new G4UIcmdWithABool("/charging/trapElectrons",this);
+  TrapElectronsCmd_->SetGuidance("Stop electrons in the grains whose CSDA range is shorter than the");
+  TrapElectronsCmd_->SetGuidance("distance to the grain surface, where they are (default false).");
+  TrapElectronsCmd_->SetGuidance("Needs /process/eLoss/CSDARange 1.");
+  TrapElectronsCmd_->SetParameterName("choice",false);
+  TrapElectronsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  TrapMaxEnergyCmd_ = new G4UIcmdWithADoubleAndUnit("/charging/trapMaxEnergy",this);
+  TrapMaxEnergyCmd_->SetGuidance("Only electrons below this energy are stopped (default 1 keV); above");
+  TrapMaxEnergyCmd_->SetGuidance("1.84 keV silicon K fluorescence can leave the grain.");
+  TrapMaxEnergyCmd_->SetParameterName("choice",false);
+  TrapMaxEnergyCmd_->SetRange("choice>0");
+  TrapMaxEnergyCmd_->SetDefaultUnit("keV");
+  TrapMaxEnergyCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  TargetErrorCmd_ = new G4UIcmdWithADouble("/charging/targetError",this);
+  TargetErrorCmd_->SetGuidance("Relative uncertainty at which an iteration stops (e.g. 0.05).");
+  TargetErrorCmd_->SetGuidance("Iterations then run chunks of /charging/events, each to its own");
+  TargetErrorCmd_->SetGuidance("<output>_c<k>.root, and write the events run to <output>_events.txt.");
+  TargetErrorCmd_->SetGuidance("Without a flux the iteration time is /geometry/IterationTime per chunk.");
+  TargetErrorCmd_->SetGuidance("0 runs /charging/events once (default).");
+  TargetErrorCmd_->SetParameterName("choice",false);
+  TargetErrorCmd_->SetRange("choice>=0");
+  TargetErrorCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  MaxEventsCmd_ = new G4UIcmdWithAnInteger("/charging/maxEvents",this);
+  MaxEventsCmd_->SetGuidance("Most events of an iteration with /charging/targetError.");
+  MaxEventsCmd_->SetGuidance("0 allows 100 chunks (default).");
+  MaxEventsCmd_->SetParameterName("choice",false);
+  MaxEventsCmd_->SetRange("choice>=0");
+  MaxEventsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ConvergenceCmd_ = new G4UIcmdWithAString("/charging/convergence",this);
+  ConvergenceCmd_->SetGuidance("Quantity whose uncertainty /charging/targetError applies to:");
+  ConvergenceCmd_->SetGuidance("charge: net charge per cell of a grid over the world (default);");
+  ConvergenceCmd_->SetGuidance("field: Coulomb field of the charges at the /charging/probe points.");
+  ConvergenceCmd_->SetParameterName("choice",false);
+  ConvergenceCmd_->SetCandidates("charge field");
+  ConvergenceCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ConvergenceCellsCmd_ = new G4UIcmdWithAnInteger("/charging/convergenceCells",this);
+  ConvergenceCellsCmd_->SetGuidance("Cells per axis of the charge grid (default 8).");
+  ConvergenceCellsCmd_->SetParameterName("choice",false);
+  ConvergenceCellsCmd_->SetRange("choice>0");
+  ConvergenceCellsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ProbeCmd_ = new G4UIcmdWith3VectorAndUnit("/charging/probe",this);
+  ProbeCmd_->SetGuidance("Add a probe point of the field convergence.");
+  ProbeCmd_->SetParameterName("x","y","z",false);
+  ProbeCmd_->SetDefaultUnit("um");
+  ProbeCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  ClearProbesCmd_ = new G4UIcmdWithoutParameter("/charging/clearProbes",this);
+  ClearProbesCmd_->SetGuidance("Remove the probe points.");
+  ClearProbesCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceDir_ = new G4UIdirectory("/source/");
+  SourceDir_->SetGuidance("Primary sources of the alias generator.");
+
+  SourceGeneratorCmd_ = new G4UIcmdWithAString("/source/generator",this);
+  SourceGeneratorCmd_->SetGuidance("gps: G4GeneralParticleSource configured with /gps/ (default).");
+  SourceGeneratorCmd_->SetGuidance("alias: the /source/ table, energies drawn from alias tables.");
+  SourceGeneratorCmd_->SetParameterName("choice",false);
+  SourceGeneratorCmd_->SetCandidates("gps alias");
+  SourceGeneratorCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourcePerEventCmd_ = new G4UIcmdWithAnInteger("/source/perEvent",this);
+  SourcePerEventCmd_->SetGuidance("Number of primaries of every event, for both generators.");
+  SourcePerEventCmd_->SetGuidance("Holes are counted for the electrons of all of them.");
+  SourcePerEventCmd_->SetParameterName("choice",false);
+  SourcePerEventCmd_->SetRange("choice>0");
+  SourcePerEventCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceAddCmd_ = new G4UIcmdWithADouble("/source/add",this);
+  SourceAddCmd_->SetGuidance("Add a source with the given intensity; the commands below apply to it.");
+  SourceAddCmd_->SetParameterName("choice",false);
+  SourceAddCmd_->SetRange("choice>=0");
+  SourceAddCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceIntensityCmd_ = new G4UIcmdWithADouble("/source/intensity",this);
+  SourceIntensityCmd_->SetGuidance("Relative intensity of the current source.");
+  SourceIntensityCmd_->SetParameterName("choice",false);
+  SourceIntensityCmd_->SetRange("choice>=0");
+  SourceIntensityCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceParticleCmd_ = new G4UIcmdWithAString("/source/particle",this);
+  SourceParticleCmd_->SetGuidance("Particle of the current source.");
+  SourceParticleCmd_->SetParameterName("choice",false);
+  SourceParticleCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceSpectrumCmd_ = new G4UIcmdWithAString("/source/spectrum",this);
+  SourceSpectrumCmd_->SetGuidance("Energy spectrum of the current source: lines of energy (MeV) and weight,");
+  SourceSpectrumCmd_->SetGuidance("as the /gps/hist/point files of the distributions directory.");
+  SourceSpectrumCmd_->SetParameterName("choice",false);
+  SourceSpectrumCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceInterpolationCmd_ = new G4UIcmdWithAString("/source/interpolation",this);
+  SourceInterpolationCmd_->SetGuidance("Interpolation between the spectrum points, as /gps/hist/inter.");
+  SourceInterpolationCmd_->SetParameterName("choice",false);
+  SourceInterpolationCmd_->SetCandidates("Lin Log");
+  SourceInterpolationCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceCentreCmd_ = new G4UIcmdWith3VectorAndUnit("/source/centre",this);
+  SourceCentreCmd_->SetGuidance("Centre of the emission rectangle of the current source.");
+  SourceCentreCmd_->SetParameterName("x","y","z",false);
+  SourceCentreCmd_->SetDefaultUnit("um");
+  SourceCentreCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceHalfXCmd_ = new G4UIcmdWithADoubleAndUnit("/source/halfx",this);
+  SourceHalfXCmd_->SetGuidance("Half length in x of the emission rectangle.");
+  SourceHalfXCmd_->SetParameterName("choice",false);
+  SourceHalfXCmd_->SetDefaultUnit("um");
+  SourceHalfXCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceHalfYCmd_ = new G4UIcmdWithADoubleAndUnit("/source/halfy",this);
+  SourceHalfYCmd_->SetGuidance("Half length in y of the emission rectangle.");
+  SourceHalfYCmd_->SetParameterName("choice",false);
+  SourceHalfYCmd_->SetDefaultUnit("um");
+  SourceHalfYCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceDirectionCmd_ = new G4UIcmdWith3Vector("/source/direction",this);
+  SourceDirectionCmd_->SetGuidance("Fixed direction of the current source (default 0 0 -1).");
+  SourceDirectionCmd_->SetParameterName("x","y","z",false);
+  SourceDirectionCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceIsotropicCmd_ = new G4UIcmdWithADoubleAndUnit("/source/isotropic",this);
+  SourceIsotropicCmd_->SetGuidance("Isotropic emission into -z up to the given angle from the z axis,");
+  SourceIsotropicCmd_->SetGuidance("as /gps/ang/type iso with /gps/ang/maxtheta.");
+  SourceIsotropicCmd_->SetParameterName("choice",false);
+  SourceIsotropicCmd_->SetDefaultUnit("deg");
+  SourceIsotropicCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceMinEnergyCmd_ = new G4UIcmdWithADoubleAndUnit("/source/minEnergy",this);
+  SourceMinEnergyCmd_->SetGuidance("Do not draw energies of the current source below this one (e.g. the");
+  SourceMinEnergyCmd_->SetGuidance("photoemission threshold); the primaries carry the fraction above it as weight.");
+  SourceMinEnergyCmd_->SetParameterName("choice",false);
+  SourceMinEnergyCmd_->SetRange("choice>=0");
+  SourceMinEnergyCmd_->SetDefaultUnit("eV");
+  SourceMinEnergyCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceTailEnergyCmd_ = new G4UIcmdWithADoubleAndUnit("/source/tailEnergy",this);
+  SourceTailEnergyCmd_->SetGuidance("Energy from which /source/tailFactor oversamples the current source.");
+  SourceTailEnergyCmd_->SetParameterName("choice",false);
+  SourceTailEnergyCmd_->SetRange("choice>=0");
+  SourceTailEnergyCmd_->SetDefaultUnit("eV");
+  SourceTailEnergyCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceTailFactorCmd_ = new G4UIcmdWithADouble("/source/tailFactor",this);
+  SourceTailFactorCmd_->SetGuidance("Draw the tail of the current source this many times more often,");
+  SourceTailFactorCmd_->SetGuidance("with correspondingly smaller statistical weights (default 1).");
+  SourceTailFactorCmd_->SetParameterName("choice",false);
+  SourceTailFactorCmd_->SetRange("choice>0");
+  SourceTailFactorCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceCullCmd_ = new G4UIcmdWithABool("/source/cull",this);
+  SourceCullCmd_->SetGuidance("Emit neutral fixed-direction sources only from the part of their plane");
+  SourceCullCmd_->SetGuidance("whose rays reach the grains; the acceptance is printed at the next run.");
+  SourceCullCmd_->SetGuidance("The reference count of /charging/flux stays exact, a fixed");
+  SourceCullCmd_->SetGuidance("/geometry/IterationTime has to be divided by the acceptance.");
+  SourceCullCmd_->SetParameterName("choice",false);
+  SourceCullCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceCullCellsCmd_ = new G4UIcmdWithAnInteger("/source/cullCells",this);
+  SourceCullCellsCmd_->SetGuidance("Cells along the longer side of a culled source plane (default 256).");
+  SourceCullCellsCmd_->SetParameterName("choice",false);
+  SourceCullCellsCmd_->SetRange("choice>0");
+  SourceCullCellsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceCacheCmd_ = new G4UIcmdWithAString("/source/cache",this);
+  SourceCacheCmd_->SetGuidance("off: no photon-stage cache (default).");
+  SourceCacheCmd_->SetGuidance("record: write the particles released by the photons of every event.");
+  SourceCacheCmd_->SetGuidance("replay: emit the recorded particles instead of running the generator.");
+  SourceCacheCmd_->SetGuidance("auto: record when /source/cacheFile does not exist, replay it otherwise;");
+  SourceCacheCmd_->SetGuidance("delete the file when the sources or the grains change.");
+  SourceCacheCmd_->SetParameterName("choice",false);
+  SourceCacheCmd_->SetCandidates("off record replay auto");
+  SourceCacheCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SourceCacheFileCmd_ = new G4UIcmdWithAString("/source/cacheFile",this);
+  SourceCacheFileCmd_->SetGuidance("File of the photon-stage cache (default photon-stage.bin).");
+  SourceCacheFileCmd_->SetParameterName("choice",false);
+  SourceCacheFileCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  BiasingDir_ = new G4UIdirectory("/biasing/");
+  BiasingDir_->SetGuidance("Variance reduction in the grains.");
+
+  BiasingSkinCmd_ = new G4UIcmdWithADoubleAndUnit("/biasing/skin",this);
+  BiasingSkinCmd_->SetGuidance("Boost the photoabsorption of gammas within this depth below the grain");
+  BiasingSkinCmd_->SetGuidance("surfaces (0: off, default); the charges carry the weights. The first");
+  BiasingSkinCmd_->SetGuidance("non-zero depth has to be given before /run/initialize.");
+  BiasingSkinCmd_->SetParameterName("choice",false);
+  BiasingSkinCmd_->SetRange("choice>=0");
+  BiasingSkinCmd_->SetDefaultUnit("nm");
+  BiasingSkinCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  BiasingSkinFactorCmd_ = new G4UIcmdWithADouble("/biasing/skinFactor",this);
+  BiasingSkinFactorCmd_->SetGuidance("Factor on the photoabsorption cross section in the skin (default 10).");
+  BiasingSkinFactorCmd_->SetParameterName("choice",false);
+  BiasingSkinFactorCmd_->SetRange("choice>0");
+  BiasingSkinFactorCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  LooperDir_ = new G4UIdirectory("/looper/");
+  LooperDir_->SetGuidance("Stop of charged tracks looping in the vacuum between charged grains.");
+  LooperDir_->SetGuidance("A limit of 0 (default) disables its test; the counts are printed per run.");
+
+  LooperMaxStepsCmd_ = new G4UIcmdWithAnInteger("/looper/maxSteps",this);
+  LooperMaxStepsCmd_->SetGuidance("Stop tracks in the vacuum after this many steps.");
+  LooperMaxStepsCmd_->SetParameterName("choice",false);
+  LooperMaxStepsCmd_->SetRange("choice>=0");
+  LooperMaxStepsCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  LooperPathCmd_ = new G4UIcmdWithADoubleAndUnit("/looper/loopPath",this);
+  LooperPathCmd_->SetGuidance("Stop tracks in the vacuum with a longer path than this while their");
+  LooperPathCmd_->SetGuidance("net displacement from the start is below /looper/loopDisplacement.");
+  LooperPathCmd_->SetParameterName("choice",false);
+  LooperPathCmd_->SetRange("choice>=0");
+  LooperPathCmd_->SetDefaultUnit("um");
+  LooperPathCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  LooperDisplacementCmd_ = new G4UIcmdWithADoubleAndUnit("/looper/loopDisplacement",this);
+  LooperDisplacementCmd_->SetGuidance("Net displacement below which a long path counts as a loop.");
+  LooperDisplacementCmd_->SetParameterName("choice",false);
+  LooperDisplacementCmd_->SetRange("choice>=0");
+  LooperDisplacementCmd_->SetDefaultUnit("um");
+  LooperDisplacementCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  LooperVacuumTimeCmd_ = new G4UIcmdWithADoubleAndUnit("/looper/maxVacuumTime",this);
+  LooperVacuumTimeCmd_->SetGuidance("Stop tracks that have spent longer than this in the vacuum.");
+  LooperVacuumTimeCmd_->SetParameterName("choice",false);
+  LooperVacuumTimeCmd_->SetRange("choice>=0");
+  LooperVacuumTimeCmd_->SetDefaultUnit("ns");
+  LooperVacuumTimeCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  LooperPolicyCmd_ = new G4UIcmdWithAString("/looper/policy",this);
+  LooperPolicyCmd_->SetGuidance("surface: deposit the charge at the nearest grain surface (default).");
+  LooperPolicyCmd_->SetGuidance("trapped: keep the charge where the track is, as trapped charge.");
+  LooperPolicyCmd_->SetGuidance("kill:    drop the track and its charge.");
+  LooperPolicyCmd_->SetParameterName("choice",false);
+  LooperPolicyCmd_->SetCandidates("surface trapped kill");
+  LooperPolicyCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SurrogateDir_ = new G4UIdirectory("/surrogate/");
+  SurrogateDir_->SetGuidance("Tabulated photoemission of the grains in place of the photon cascade.");
+
+  SurrogateModeCmd_ = new G4UIcmdWithAString("/surrogate/mode",this);
+  SurrogateModeCmd_->SetGuidance("off: full physics in the grains (default).");
+  SurrogateModeCmd_->SetGuidance("calibrate: tabulate the photoemission of full-physics runs in /surrogate/table");
+  SurrogateModeCmd_->SetGuidance("           (without /biasing/skin).");
+  SurrogateModeCmd_->SetGuidance("fast: absorb the photons in the grains and emit electrons from the table.");
+  SurrogateModeCmd_->SetGuidance("A mode other than off has to be given before /run/initialize to use fast.");
+  SurrogateModeCmd_->SetParameterName("choice",false);
+  SurrogateModeCmd_->SetCandidates("off calibrate fast");
+  SurrogateModeCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  SurrogateTableCmd_ = new G4UIcmdWithAString("/surrogate/table",this);
+  SurrogateTableCmd_->SetGuidance("File of the surrogate emission table (default surrogate-emission.txt).");
+  SurrogateTableCmd_->SetParameterName("choice",false);
+  SurrogateTableCmd_->AvailableForStates(G4State_PreInit,G4State_Idle);
+
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -156,14 +601,33 @@ DetectorMessenger::DetectorMessenger(DetectorConstruction * Det)
 DetectorMessenger::~DetectorMessenger()
 {
   delete fileNameCmd_;
+  delete OutputFormatCmd_;
+  delete AsyncOutputCmd_;
+  delete OutputBuffersCmd_;
+  delete OutputBatchRowsCmd_;
   delete PBCCmd_;
   delete EpsilonCmd_;
   delete ScaleCmd_;
+  delete CADCacheCmd_;
+  delete CADSolidCmd_;
+  delete CADSplitCmd_;
+  delete SpheresFileCmd_;
+  delete SpheresDir_;
   delete RootInputCmd_;
   delete WorldXCmd_;
   delete WorldYCmd_;
   delete WorldZCmd_;
   delete FieldMinimumStepCmd_;
+  delete FieldStepperCmd_;
+  delete FieldDriverCmd_;
+  delete FieldDeltaOneStepCmd_;
+  delete FieldMinEpsilonCmd_;
+  delete FieldMaxEpsilonCmd_;
+  delete FieldDeltaChordCmd_;
+  delete FieldDriverMinStepCmd_;
+  delete FieldInsideGrainsCmd_;
+  delete FieldBypassRatioCmd_;
+  delete FieldRelaxRatioCmd_;
   delete FieldGradThresholdCmd_;
   delete FieldFileCmd_;
   delete FieldOctreeDepthCmd_;
@@ -173,6 +637,51 @@ DetectorMessenger::~DetectorMessenger()
   delete InitialDepthCmd_;
   delete MaterialDensityCmd_;
   delete ChargeDissipationModelCmd_;
+  delete IterateCmd_;
+  delete EventsPerIterationCmd_;
+  delete ChargingFluxCmd_;
+  delete ReferenceParticleCmd_;
+  delete TrapElectronsCmd_;
+  delete TrapMaxEnergyCmd_;
+  delete TargetErrorCmd_;
+  delete MaxEventsCmd_;
+  delete ConvergenceCmd_;
+  delete ConvergenceCellsCmd_;
+  delete ProbeCmd_;
+  delete ClearProbesCmd_;
+  delete ChargingDir_;
+  delete SourceGeneratorCmd_;
+  delete SourcePerEventCmd_;
+  delete SourceAddCmd_;
+  delete SourceIntensityCmd_;
+  delete SourceParticleCmd_;
+  delete SourceSpectrumCmd_;
+  delete SourceInterpolationCmd_;
+  delete SourceCentreCmd_;
+  delete SourceHalfXCmd_;
+  delete SourceHalfYCmd_;
+  delete SourceDirectionCmd_;
+  delete SourceIsotropicCmd_;
+  delete SourceMinEnergyCmd_;
+  delete SourceTailEnergyCmd_;
+  delete SourceTailFactorCmd_;
+  delete SourceCullCmd_;
+  delete SourceCullCellsCmd_;
+  delete SourceCacheCmd_;
+  delete SourceCacheFileCmd_;
+  delete SourceDir_;
+  delete BiasingSkinCmd_;
+  delete BiasingSkinFactorCmd_;
+  delete BiasingDir_;
+  delete LooperMaxStepsCmd_;
+  delete LooperPathCmd_;
+  delete LooperDisplacementCmd_;
+  delete LooperVacuumTimeCmd_;
+  delete LooperPolicyCmd_;
+  delete LooperDir_;
+  delete SurrogateModeCmd_;
+  delete SurrogateTableCmd_;
+  delete SurrogateDir_;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -180,9 +689,21 @@ DetectorMessenger::~DetectorMessenger()
 void DetectorMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
 { 
 
+  // the file is opened at the start of each run by RunAction
   if( command == fileNameCmd_ )
-  {G4cout << "Opening ROOT file: " << newValue << G4endl;
-    rootManager_->OpenFile(newValue);}
+  { SDManager::SetOutputFile(newValue);}
+
+  if( command == OutputFormatCmd_ )
+  { SDManager::SetOutputFormat(newValue);}
+
+  if( command == AsyncOutputCmd_ )
+  { SDManager::SetAsyncOutput(AsyncOutputCmd_->GetNewBoolValue(newValue));}
+
+  if( command == OutputBuffersCmd_ )
+  { SDManager::SetOutputBuffers(OutputBuffersCmd_->GetNewIntValue(newValue));}
+
+  if( command == OutputBatchRowsCmd_ )
+  { SDManager::SetOutputBatchRows(OutputBatchRowsCmd_->GetNewIntValue(newValue));}
 
   if( command == PBCCmd_ )
   { detector_->SetPBC(PBCCmd_->GetNewBoolValue(newValue));}
@@ -207,6 +728,18 @@ void DetectorMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
 
   if( command == ScaleCmd_ )
   { detector_->SetCADScale(ScaleCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == CADCacheCmd_ )
+  { detector_->SetCADCache(CADCacheCmd_->GetNewBoolValue(newValue));}
+
+  if( command == CADSolidCmd_ )
+  { detector_->SetCADSolid(newValue);}
+
+  if( command == CADSplitCmd_ )
+  { detector_->SetCADSplit(CADSplitCmd_->GetNewBoolValue(newValue));}
+
+  if( command == SpheresFileCmd_ )
+  { detector_->SetSpheresFile(newValue);}
   
   if( command == WorldXCmd_ )
   { detector_->SetWorldX(WorldXCmd_->GetNewDoubleValue(newValue));}
@@ -223,6 +756,36 @@ void DetectorMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
   if( command == FieldGradThresholdCmd_ )
   { detector_->SetFieldGradThreshold(FieldGradThresholdCmd_->GetNewDoubleValue(newValue));}
 
+  if( command == FieldStepperCmd_ )
+  { detector_->SetFieldStepper(newValue);}
+
+  if( command == FieldDriverCmd_ )
+  { detector_->SetFieldDriver(newValue);}
+
+  if( command == FieldDeltaOneStepCmd_ )
+  { detector_->SetFieldDeltaOneStep(FieldDeltaOneStepCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldMinEpsilonCmd_ )
+  { detector_->SetFieldMinEpsilon(FieldMinEpsilonCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldMaxEpsilonCmd_ )
+  { detector_->SetFieldMaxEpsilon(FieldMaxEpsilonCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldDeltaChordCmd_ )
+  { detector_->SetFieldDeltaChord(FieldDeltaChordCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldDriverMinStepCmd_ )
+  { detector_->SetFieldDriverMinimumStep(FieldDriverMinStepCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldInsideGrainsCmd_ )
+  { detector_->SetGrainFieldPolicy(newValue);}
+
+  if( command == FieldBypassRatioCmd_ )
+  { detector_->SetFieldBypassRatio(FieldBypassRatioCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == FieldRelaxRatioCmd_ )
+  { detector_->SetFieldRelaxRatio(FieldRelaxRatioCmd_->GetNewDoubleValue(newValue));}
+
   if( command == FieldOctreeDepthCmd_ )
   { detector_->SetOctreeMaxDepth(FieldOctreeDepthCmd_->GetNewDoubleValue(newValue));}
 
@@ -238,6 +801,128 @@ void DetectorMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
   if( command == FieldFileCmd_ )
   { detector_->SetFieldFile(newValue);}
 
+  if( command == EventsPerIterationCmd_ )
+  { detector_->SetEventsPerIteration(EventsPerIterationCmd_->GetNewIntValue(newValue));}
+
+  if( command == ChargingFluxCmd_ )
+  { detector_->SetChargingFlux(ChargingFluxCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == ReferenceParticleCmd_ )
+  { ChargeCollector::GetInstance()->SetReferenceParticle(newValue);}
+
+  if( command == TrapElectronsCmd_ )
+  { TrappedElectronProcess::SetEnabled(TrapElectronsCmd_->GetNewBoolValue(newValue));}
+
+  if( command == TrapMaxEnergyCmd_ )
+  { TrappedElectronProcess::SetMaxEnergy(TrapMaxEnergyCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == TargetErrorCmd_ )
+  { detector_->SetTargetError(TargetErrorCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == MaxEventsCmd_ )
+  { detector_->SetMaxEventsPerIteration(MaxEventsCmd_->GetNewIntValue(newValue));}
+
+  if( command == ConvergenceCmd_ )
+  { detector_->SetConvergenceMeasure(newValue);}
+
+  if( command == ConvergenceCellsCmd_ )
+  { detector_->SetConvergenceCells(ConvergenceCellsCmd_->GetNewIntValue(newValue));}
+
+  if( command == ProbeCmd_ )
+  { detector_->AddProbe(ProbeCmd_->GetNew3VectorValue(newValue));}
+
+  if( command == ClearProbesCmd_ )
+  { detector_->ClearProbes();}
+
+  if( command == IterateCmd_ )
+  { detector_->Iterate(IterateCmd_->GetNewIntValue(newValue));}
+
+  PrimarySourceTable* sources = PrimarySourceTable::GetInstance();
+
+  if( command == SourceGeneratorCmd_ )
+  { sources->SetGenerator(newValue);}
+
+  if( command == SourcePerEventCmd_ )
+  { sources->SetPrimariesPerEvent(SourcePerEventCmd_->GetNewIntValue(newValue));}
+
+  if( command == SourceAddCmd_ )
+  { sources->AddSource(SourceAddCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceIntensityCmd_ )
+  { sources->SetIntensity(SourceIntensityCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceParticleCmd_ )
+  { sources->SetParticle(newValue);}
+
+  if( command == SourceSpectrumCmd_ )
+  { sources->SetSpectrum(newValue);}
+
+  if( command == SourceInterpolationCmd_ )
+  { sources->SetInterpolation(newValue);}
+
+  if( command == SourceCentreCmd_ )
+  { sources->SetCentre(SourceCentreCmd_->GetNew3VectorValue(newValue));}
+
+  if( command == SourceHalfXCmd_ )
+  { sources->SetHalfX(SourceHalfXCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceHalfYCmd_ )
+  { sources->SetHalfY(SourceHalfYCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceDirectionCmd_ )
+  { sources->SetDirection(SourceDirectionCmd_->GetNew3VectorValue(newValue));}
+
+  if( command == SourceIsotropicCmd_ )
+  { sources->SetIsotropic(SourceIsotropicCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceMinEnergyCmd_ )
+  { sources->SetMinEnergy(SourceMinEnergyCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceTailEnergyCmd_ )
+  { sources->SetTailEnergy(SourceTailEnergyCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceTailFactorCmd_ )
+  { sources->SetTailFactor(SourceTailFactorCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == SourceCullCmd_ )
+  { sources->SetCulling(SourceCullCmd_->GetNewBoolValue(newValue));}
+
+  if( command == SourceCullCellsCmd_ )
+  { sources->SetCullingCells(SourceCullCellsCmd_->GetNewIntValue(newValue));}
+
+  if( command == SourceCacheCmd_ )
+  { PhotonStageCache::GetInstance()->SetMode(newValue);}
+
+  if( command == SourceCacheFileCmd_ )
+  { PhotonStageCache::GetInstance()->SetFile(newValue);}
+
+  if( command == BiasingSkinCmd_ )
+  { SkinBiasingOperator::SetSkinDepth(BiasingSkinCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == BiasingSkinFactorCmd_ )
+  { SkinBiasingOperator::SetSkinFactor(BiasingSkinFactorCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == LooperMaxStepsCmd_ )
+  { LooperWatchdogProcess::SetMaxSteps(LooperMaxStepsCmd_->GetNewIntValue(newValue));}
+
+  if( command == LooperPathCmd_ )
+  { LooperWatchdogProcess::SetLoopPath(LooperPathCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == LooperDisplacementCmd_ )
+  { LooperWatchdogProcess::SetLoopDisplacement(LooperDisplacementCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == LooperVacuumTimeCmd_ )
+  { LooperWatchdogProcess::SetMaxVacuumTime(LooperVacuumTimeCmd_->GetNewDoubleValue(newValue));}
+
+  if( command == LooperPolicyCmd_ )
+  { LooperWatchdogProcess::SetPolicy(newValue);}
+
+  if( command == SurrogateModeCmd_ )
+  { SurrogateEmissionModel::SetMode(newValue);}
+
+  if( command == SurrogateTableCmd_ )
+  { SurrogateEmissionModel::SetTableFile(newValue);}
+
 
 }
 
@@ -0,0 +1,323 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ExactLeafStepper.cc
+/// \brief Implementation of the ExactLeafStepper class
+//
+
+#include "ExactLeafStepper.hh"
+#include "AdaptiveSumRadialFieldMap.hh"
+
+#include "G4EqMagElectricField.hh"
+#include "G4FieldTrack.hh"
+#include "G4LineSection.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // leaves crossed in one Advance before the rest of it keeps the current field
+  const G4int kMaxHops = 10000;
+  // the leaf is widened by this fraction of its size, so that a track leaving
+  // it lands inside the neighbour and always makes progress
+  const G4double kFaceTolerance = 1.e-9;
+  const G4double kRelativeTolerance = 1.e-12;
+
+  // 8-point Gauss-Legendre abscissae and weights on [-1,1] (positive half)
+  const G4double kGaussX[4] = { 0.1834346424956498, 0.5255324099163290,
+                                0.7966664774136267, 0.9602898564975363 };
+  const G4double kGaussW[4] = { 0.3626837833783620, 0.3137066458778873,
+                                0.2223810344533745, 0.1012285362903763 };
+
+  /// Exact trajectory in a uniform electric field.
+  /* With the momentum p in energy units, dp/dt = F is constant, so
+   * p(t) = p0 + F t and E(t) = sqrt(m^2 + p(t)^2). Along F the displacement
+   * is c (E - E0)/f, written without cancellation as
+   * c t (2 p0_par + f t)/(E + E0); across F the velocity is c p_perp/E(t),
+   * whose time integral is an asinh difference.
+   */
+  class UniformArc
+  {
+    public:
+
+      UniformArc(const G4ThreeVector& x0, const G4ThreeVector& p0,
+                 const G4ThreeVector& force, G4double massSquared)
+       : x0_(x0), p0_(p0), force_(force), f_(force.mag()), mass2_(massSquared)
+      {
+        unit_ = (f_ > 0.) ? force/f_ : G4ThreeVector();
+        pPar0_ = p0.dot(unit_);
+        pPerp_ = p0 - pPar0_*unit_;
+        eps2_ = massSquared + pPerp_.mag2();
+        eps_ = std::sqrt(eps2_);
+        energy0_ = std::sqrt(eps2_ + pPar0_*pPar0_);
+      }
+
+      G4ThreeVector Momentum(G4double t) const { return p0_ + t*force_; }
+
+      G4double Energy(G4double t) const
+      {
+        const G4double pPar = pPar0_ + f_*t;
+        return std::sqrt(eps2_ + pPar*pPar);
+      }
+
+      G4ThreeVector Position(G4double t) const
+      {
+        if (t == 0.) return x0_;
+        if (f_ == 0.) return x0_ + (c_light*t/energy0_)*p0_;
+
+        const G4double pPar = pPar0_ + f_*t;
+        const G4double energy = std::sqrt(eps2_ + pPar*pPar);
+        const G4double xPar = c_light*t*(2.*pPar0_ + f_*t)/(energy + energy0_);
+
+        // g = integral of dt/E = (asinh(pPar/eps) - asinh(pPar0/eps))/f
+        G4double g;
+        if (pPar*pPar0_ >= 0.) {
+          // same sign: the difference of asinh is asinh(f q), with q free
+          // of cancellation, so small steps and weak fields stay accurate
+          const G4double q = t*(2.*pPar0_ + f_*t)/(pPar*energy0_ + pPar0_*energy);
+          const G4double arg = f_*q;
+          g = (std::abs(arg) > 1.e-6) ? q*std::asinh(arg)/arg : q*(1. - arg*arg/6.);
+        } else {
+          g = (std::asinh(pPar/eps_) - std::asinh(pPar0_/eps_))/f_;
+        }
+        return x0_ + xPar*unit_ + (c_light*g)*pPerp_;
+      }
+
+      // dx/dt along one axis, and the speed ds/dt
+      G4double Velocity(G4int axis, G4double t) const
+      {
+        return c_light*(p0_[axis] + force_[axis]*t)/Energy(t);
+      }
+      G4double Speed(G4double t) const { return c_light*Momentum(t).mag()/Energy(t); }
+
+      /// Path length between two times.
+      G4double PathLength(G4double t0, G4double t1) const
+      {
+        if (t1 < t0) return -PathLength(t1, t0);
+        // the speed has a kink where the momentum along F changes sign
+        const G4double turn = (f_ > 0.) ? -pPar0_/f_ : -1.;
+        if (turn > t0 && turn < t1) return PathLength(t0, turn) + PathLength(turn, t1);
+        return Gauss(t0, t1);
+      }
+
+      /// Time after which the path length reaches length.
+      G4double TimeForLength(G4double length) const
+      {
+        const G4double tolerance = kRelativeTolerance*length;
+        G4double t = 0., s = 0.;
+        G4double lo = 0., hi = -1.;  // bracket, hi < 0 while unknown
+
+        for (G4int i = 0; i < 100 && std::abs(length - s) > tolerance; ++i) {
+          const G4double v = Speed(t);
+          G4double next;
+          if (v > 0. && i == 0) {
+            // first guess from s = v t + a t^2/2, a = dv/dt = c (p.F) m^2/(|p| E^3)
+            const G4double a = c_light*p0_.dot(force_)*mass2_/(p0_.mag()*energy0_*energy0_*energy0_);
+            const G4double disc = v*v + 2.*a*length;
+            next = (disc > 0.) ? 2.*length/(v + std::sqrt(disc)) : length/v;
+          } else if (v > 0.) {
+            next = t + (length - s)/v;
+          } else if (f_ > 0.) {
+            // at rest: start from the uniformly accelerated distance
+            next = t + std::sqrt(2.*(length - s)*Energy(t)/(c_light*c_light*f_));
+          } else {
+            return t;
+          }
+          if (hi >= 0. && (next <= lo || next >= hi)) next = 0.5*(lo + hi);
+
+          s += PathLength(t, next);
+          t = next;
+          if (s < length) lo = t; else hi = t;
+          if (hi >= 0. && hi - lo <= kRelativeTolerance*hi) break;
+        }
+        return t;
+      }
+
+      /// Earliest time in [0,tMax] at which the coordinate leaves [lo,hi],
+      /// or tMax if it stays inside.
+      G4double ExitTime(G4int axis, G4double lo, G4double hi, G4double tMax) const
+      {
+        // the coordinate is monotone on either side of the time its
+        // velocity changes sign
+        G4double pieces[3] = { 0., tMax, tMax };
+        G4int nPieces = 1;
+        if (force_[axis] != 0.) {
+          const G4double turn = -p0_[axis]/force_[axis];
+          if (turn > 0. && turn < tMax) {
+            pieces[1] = turn;
+            nPieces = 2;
+          }
+        }
+
+        for (G4int i = 0; i < nPieces; ++i) {
+          const G4double end = Position(pieces[i + 1])[axis];
+          if (end > hi) return Crossing(axis, hi, pieces[i], pieces[i + 1]);
+          if (end < lo) return Crossing(axis, lo, pieces[i], pieces[i + 1]);
+        }
+        return tMax;
+      }
+
+    private:
+
+      G4double Gauss(G4double a, G4double b) const
+      {
+        const G4double mid = 0.5*(a + b), half = 0.5*(b - a);
+        G4double sum = 0.;
+        for (G4int i = 0; i < 4; ++i) {
+          sum += kGaussW[i]*(Speed(mid - half*kGaussX[i]) + Speed(mid + half*kGaussX[i]));
+        }
+        return half*sum;
+      }
+
+      // root of x_axis(t) = bound on [t0,t1], where the coordinate is monotone
+      // and crosses the bound: Newton's method kept inside the bracket
+      G4double Crossing(G4int axis, G4double bound, G4double t0, G4double t1) const
+      {
+        const G4double g0 = Position(t0)[axis] - bound;
+        if (g0 == 0.) return t0;
+        const G4double sign = (g0 < 0.) ? 1. : -1.;  // g increases towards the root if g0 < 0
+        G4double lo = t0, hi = t1, t = 0.5*(t0 + t1);
+
+        for (G4int i = 0; i < 100; ++i) {
+          const G4double g = Position(t)[axis] - bound;
+          if (g == 0.) return t;
+          if (sign*g < 0.) lo = t; else hi = t;
+          if (hi - lo <= kRelativeTolerance*hi) break;
+
+          const G4double v = Velocity(axis, t);
+          G4double next = (v != 0.) ? t - g/v : lo - 1.;
+          if (next <= lo || next >= hi) next = 0.5*(lo + hi);
+          t = next;
+        }
+        return hi;
+      }
+
+      G4ThreeVector x0_, p0_, force_, unit_, pPerp_;
+      G4double f_, mass2_, pPar0_, eps2_, eps_, energy0_;
+  };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ExactLeafStepper::ExactLeafStepper(G4EqMagElectricField* equation, G4int nvar)
+ : G4MagIntegratorStepper(equation, nvar), equation_(equation)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ExactLeafStepper::Stepper(const G4double y[], const G4double[], G4double h,
+                               G4double yout[], G4double yerr[])
+{
+  const G4int nvar = GetNumberOfVariables();
+
+  // the equation keeps charge and mass to itself: read them back from its
+  // right-hand side for a unit electric field along x, which is
+  // dp_x/ds = k W/(c |p|) and dt/ds = W/(c |p|), with k = dp/dt per unit
+  // field and W the total energy
+  const G4double unitField[6] = { 0., 0., 0., 1., 0., 0. };
+  G4double rhs[G4FieldTrack::ncompSVEC];
+  equation_->EvaluateRhsGivenB(y, unitField, rhs);
+
+  const G4ThreeVector momentum(y[3], y[4], y[5]);
+  const G4double p = momentum.mag();
+  const G4double energy = rhs[7]*p*c_light;
+  forceFactor_ = rhs[3]*p*c_light/energy;
+  massSquared_ = std::max(energy*energy - p*p, 0.);
+
+  const G4Field* field = equation_->GetFieldObj();
+  if (field != field_) {
+    field_ = field;
+    fieldMap_ = dynamic_cast<const AdaptiveSumRadialFieldMap*>(field);
+  }
+
+  State state{ G4ThreeVector(y[0], y[1], y[2]), momentum, (nvar > 7) ? y[7] : 0. };
+  start_ = state.position;
+  Advance(state, 0.5*h);
+  middle_ = state.position;
+  Advance(state, 0.5*h);
+  end_ = state.position;
+
+  for (G4int i = 0; i < nvar; ++i) {
+    yout[i] = y[i];
+    yerr[i] = 0.;
+  }
+  yout[0] = state.position.x();
+  yout[1] = state.position.y();
+  yout[2] = state.position.z();
+  yout[3] = state.momentum.x();
+  yout[4] = state.momentum.y();
+  yout[5] = state.momentum.z();
+  if (nvar > 7) yout[7] = state.time;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ExactLeafStepper::Advance(State& state, G4double length)
+{
+  G4double remaining = length;
+
+  for (G4int hop = 0; remaining > 0.; ++hop) {
+    G4ThreeVector field, lo, hi;
+    const G4bool inMap = fieldMap_ && fieldMap_->GetLeaf(state.position, field, lo, hi);
+    if (!inMap) field = G4ThreeVector();
+
+    const UniformArc arc(state.position, state.momentum, forceFactor_*field, massSquared_);
+    G4double used = remaining;
+    if (inMap && hop < kMaxHops) {
+      // the trajectory is a plane curve turning by less than pi, so its arc
+      // inside the leaf is shorter than pi times the leaf diagonal
+      used = std::min(remaining, CLHEP::pi*(hi - lo).mag());
+    }
+    G4double t = arc.TimeForLength(used);
+
+    if (inMap && hop < kMaxHops) {
+      G4double exit = t;
+      for (G4int axis = 0; axis < 3; ++axis) {
+        const G4double tolerance = kFaceTolerance*(hi[axis] - lo[axis]);
+        exit = arc.ExitTime(axis, lo[axis] - tolerance, hi[axis] + tolerance, exit);
+      }
+      if (exit < t) {
+        t = exit;
+        used = std::min(arc.PathLength(0., t), remaining);
+      }
+    }
+
+    state.position = arc.Position(t);
+    state.momentum = arc.Momentum(t);
+    state.time += t;
+    remaining -= used;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ExactLeafStepper::DistChord() const
+{
+  return G4LineSection::Distance(middle_, start_, end_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,530 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file FastSTLReader.cc
+/// \brief Implementation of the FastSTLReader class
+//
+
+#include "FastSTLReader.hh"
+
+#include "G4Exception.hh"
+#include "G4TessellatedSolid.hh"
+#include "G4TriangularFacet.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+  const char kCacheMagic[8] = {'G', '4', 'C', 'M', 'E', 'S', 'H', '\0'};
+  const std::uint32_t kCacheVersion = 1;
+
+  // binary STL: 80 byte header, uint32 triangle count, 50 bytes per triangle
+  const std::size_t kBinaryHeader = 84;
+  const std::size_t kBinaryRecord = 50;
+
+  G4bool IsBinary(const char* data, std::size_t size)
+  {
+    // the size test also catches binary files whose header starts with "solid"
+    if (size < kBinaryHeader) return false;
+    std::uint32_t count;
+    std::memcpy(&count, data + 80, sizeof(count));
+    return kBinaryHeader + kBinaryRecord * static_cast<std::size_t>(count) == size;
+  }
+
+  G4String Trim(std::string_view text)
+  {
+    const char* blank = " \t\r\n";
+    const std::size_t first = text.find_first_not_of(blank);
+    if (first == std::string_view::npos) return "";
+    const std::size_t last = text.find_last_not_of(blank);
+    return G4String(std::string(text.substr(first, last - first + 1)));
+  }
+
+  // Parse the number starting at pos (after blanks) and move pos past it.
+  G4bool ReadNumber(std::string_view text, std::size_t& pos, G4double& value)
+  {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t')) ++pos;
+
+    char token[64];
+    std::size_t length = 0;
+    while (pos < text.size() && length < sizeof(token) - 1 &&
+           text[pos] != ' ' && text[pos] != '\t' && text[pos] != '\r' && text[pos] != '\n') {
+      token[length++] = text[pos++];
+    }
+    token[length] = '\0';
+
+    char* end = nullptr;
+    value = std::strtod(token, &end);
+    return length > 0 && end == token + length;
+  }
+
+  // Corners of every "vertex" line starting in [begin, end), in file order.
+  G4bool ReadVertices(std::string_view text, std::size_t begin, std::size_t end,
+                      std::vector<G4ThreeVector>& corners)
+  {
+    const G4int nChunks = std::max(omp_get_max_threads(), 1);
+    std::vector<std::vector<G4ThreeVector>> parts(nChunks);
+    G4int failed = 0;
+
+    #pragma omp parallel for schedule(static) reduction(+:failed)
+    for (G4int c = 0; c < nChunks; ++c) {
+      const std::size_t from = begin + (end - begin) * c / nChunks;
+      const std::size_t to   = begin + (end - begin) * (c + 1) / nChunks;
+
+      // a keyword belongs to the chunk holding its first character
+      std::size_t pos = from;
+      while ((pos = text.find("vertex", pos)) < to) {
+        pos += 6;
+        G4double xyz[3];
+        if (!ReadNumber(text, pos, xyz[0]) || !ReadNumber(text, pos, xyz[1]) ||
+            !ReadNumber(text, pos, xyz[2])) {
+          failed++;
+          break;
+        }
+        parts[c].emplace_back(xyz[0], xyz[1], xyz[2]);
+      }
+    }
+    if (failed) return false;
+
+    for (auto& part : parts) {
+      corners.insert(corners.end(), part.begin(), part.end());
+    }
+    return true;
+  }
+
+  struct VertexKey
+  {
+    explicit VertexKey(const G4ThreeVector& v)
+     : x(v.x() + 0.), y(v.y() + 0.), z(v.z() + 0.)  // + 0. turns -0 into +0
+    {}
+    G4bool operator==(const VertexKey& other) const
+    { return x == other.x && y == other.y && z == other.z; }
+
+    G4double x, y, z;
+  };
+
+  struct VertexKeyHash
+  {
+    std::size_t operator()(const VertexKey& key) const
+    {
+      std::size_t seed = 0;
+      for (G4double value : {key.x, key.y, key.z}) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        seed ^= std::hash<std::uint64_t>()(bits) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+      }
+      return seed;
+    }
+  };
+
+  template <typename T>
+  void Put(std::ostream& out, const T& value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <typename T>
+  G4bool Get(std::istream& in, T& value)
+  {
+    return static_cast<G4bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+FastSTLReader::FastSTLReader()
+ : useCache_(true), fromCache_(false)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string FastSTLReader::CacheFileFor(const std::string& path)
+{
+  return path + ".meshcache";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool FastSTLReader::Read(const std::string& path)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+
+  meshes_.clear();
+  fromCache_ = false;
+
+  std::error_code ec;
+  Stamp stamp;
+  stamp.size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    G4Exception("FastSTLReader::Read", "FileNotFound", FatalException,
+                ("STL file not found: " + path).c_str());
+    return false;
+  }
+  stamp.mtime = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+
+  const std::string cacheFile = CacheFileFor(path);
+
+  if (useCache_ && LoadCache(cacheFile, stamp)) {
+    fromCache_ = true;
+  } else {
+    const int fd = open(path.c_str(), O_RDONLY);
+    void* map = MAP_FAILED;
+    if (fd >= 0 && stamp.size > 0) {
+      map = mmap(nullptr, stamp.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (fd >= 0) close(fd);
+    if (map == MAP_FAILED) {
+      G4Exception("FastSTLReader::Read", "FileOpenError", FatalException,
+                  ("Failed to map STL file: " + path).c_str());
+      return false;
+    }
+    madvise(map, stamp.size, MADV_WILLNEED);
+
+    const char* data = static_cast<const char*>(map);
+    const G4bool ok = IsBinary(data, stamp.size) ? ParseBinary(data, stamp.size)
+                                                 : ParseASCII(data, stamp.size);
+    munmap(map, stamp.size);
+    if (!ok) return false;
+
+    if (useCache_) SaveCache(cacheFile, stamp);
+  }
+
+  std::size_t nTriangles = 0, nVertices = 0;
+  for (const auto& mesh : meshes_) {
+    nTriangles += mesh.triangles.size();
+    nVertices += mesh.vertices.size();
+  }
+  std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+  G4cout << "Read " << nTriangles << " triangles (" << nVertices << " vertices, "
+         << meshes_.size() << " solids) from " << (fromCache_ ? cacheFile : path)
+         << " in " << duration.count() << " s" << G4endl;
+
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool FastSTLReader::ParseBinary(const char* data, std::size_t size)
+{
+  const long count = static_cast<long>((size - kBinaryHeader) / kBinaryRecord);
+  std::vector<G4ThreeVector> corners(3 * count);
+
+  #pragma omp parallel for schedule(static)
+  for (long t = 0; t < count; ++t) {
+    // skip the facet normal, the orientation comes from the vertex order
+    float xyz[9];
+    std::memcpy(xyz, data + kBinaryHeader + kBinaryRecord * t + 12, sizeof(xyz));
+    for (G4int k = 0; k < 3; ++k) {
+      corners[3 * t + k].set(xyz[3 * k], xyz[3 * k + 1], xyz[3 * k + 2]);
+    }
+  }
+
+  // the header is free text, exporters usually put the solid name there
+  AddMesh(Trim(std::string_view(data, strnlen(data, 80))), corners);
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool FastSTLReader::ParseASCII(const char* data, std::size_t size)
+{
+  const std::string_view text(data, size);
+  const std::size_t npos = std::string_view::npos;
+
+  // one mesh per "solid ... endsolid" block, like the CADMesh reader
+  std::size_t begin = 0;
+  while (begin < size) {
+    const std::size_t solid = text.find("solid", begin);
+    if (solid == npos) break;
+
+    std::size_t end = text.find("endsolid", solid);
+    if (end == npos) end = size;
+    const std::size_t lineEnd = std::min(text.find('\n', solid), end);
+
+    std::vector<G4ThreeVector> corners;
+    if (!ReadVertices(text.substr(0, end), lineEnd, end, corners)) {
+      G4Exception("FastSTLReader::ParseASCII", "ParseError", FatalException,
+                  "Malformed vertex line in the STL file.");
+      return false;
+    }
+    if (corners.size() % 3 != 0) {
+      G4Exception("FastSTLReader::ParseASCII", "ParseError", FatalException,
+                  "STL files expect exactly 3 vertices for a triangular facet.");
+      return false;
+    }
+    AddMesh(Trim(text.substr(solid + 5, lineEnd - solid - 5)), corners);
+
+    const std::size_t next = text.find('\n', end);
+    begin = next == npos ? size : next;
+  }
+
+  if (meshes_.empty()) {
+    G4Exception("FastSTLReader::ParseASCII", "ParseError", FatalException,
+                "The STL file appears to be empty.");
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FastSTLReader::AddMesh(const G4String& name, const std::vector<G4ThreeVector>& corners)
+{
+  TriangleMesh mesh;
+  mesh.name = name;
+  mesh.triangles.reserve(corners.size() / 3);
+  // a closed triangle mesh has about half as many vertices as triangles
+  mesh.vertices.reserve(corners.size() / 6 + 3);
+
+  std::unordered_map<VertexKey, G4int, VertexKeyHash> index;
+  index.reserve(corners.size() / 6 + 3);
+
+  G4long degenerate = 0;
+  for (std::size_t t = 0; t + 2 < corners.size(); t += 3) {
+    std::array<G4int, 3> triangle;
+    for (G4int k = 0; k < 3; ++k) {
+      auto found = index.emplace(VertexKey(corners[t + k]), static_cast<G4int>(mesh.vertices.size()));
+      if (found.second) mesh.vertices.push_back(corners[t + k]);
+      triangle[k] = found.first->second;
+    }
+
+    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) {
+      degenerate++;
+      continue;
+    }
+    mesh.triangles.push_back(triangle);
+  }
+
+  if (degenerate > 0) {
+    G4cout << "FastSTLReader: dropped " << degenerate << " degenerate triangles from solid \""
+           << name << "\"" << G4endl;
+  }
+  meshes_.push_back(std::move(mesh));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<TriangleMesh> FastSTLReader::SplitConnected(const TriangleMesh& mesh)
+{
+  // union-find over the vertices, joined along every facet
+  std::vector<G4int> parent(mesh.vertices.size());
+  for (std::size_t i = 0; i < parent.size(); ++i) parent[i] = static_cast<G4int>(i);
+
+  auto find = [&parent](G4int i) {
+    while (parent[i] != i) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  };
+
+  for (const auto& t : mesh.triangles) {
+    for (G4int k = 1; k < 3; ++k) {
+      const G4int a = find(t[0]), b = find(t[k]);
+      if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+  }
+
+  // component of every root, in order of first appearance
+  std::vector<G4int> component(mesh.vertices.size(), -1);
+  std::vector<TriangleMesh> parts;
+  for (const auto& t : mesh.triangles) {
+    const G4int root = find(t[0]);
+    if (component[root] < 0) {
+      component[root] = static_cast<G4int>(parts.size());
+      parts.emplace_back();
+    }
+  }
+
+  // renumber the vertices of every component
+  std::vector<G4int> local(mesh.vertices.size(), -1);
+  for (const auto& t : mesh.triangles) {
+    TriangleMesh& part = parts[component[find(t[0])]];
+    std::array<G4int, 3> triangle;
+    for (G4int k = 0; k < 3; ++k) {
+      if (local[t[k]] < 0) {
+        local[t[k]] = static_cast<G4int>(part.vertices.size());
+        part.vertices.push_back(mesh.vertices[t[k]]);
+      }
+      triangle[k] = local[t[k]];
+    }
+    part.triangles.push_back(triangle);
+  }
+
+  std::stable_sort(parts.begin(), parts.end(), [](const TriangleMesh& a, const TriangleMesh& b) {
+    return a.triangles.size() > b.triangles.size();
+  });
+  for (std::size_t i = 0; i < parts.size(); ++i) {
+    parts[i].name = mesh.name + "_grain" + std::to_string(i);
+  }
+  return parts;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4TessellatedSolid* FastSTLReader::BuildSolid(const TriangleMesh& mesh, G4double scale,
+                                              const G4String& name)
+{
+  std::vector<G4TriangularFacet*> facets(mesh.triangles.size());
+
+  #pragma omp parallel for schedule(static)
+  for (long i = 0; i < static_cast<long>(facets.size()); ++i) {
+    const auto& t = mesh.triangles[i];
+    facets[i] = new G4TriangularFacet(mesh.vertices[t[0]] * scale, mesh.vertices[t[1]] * scale,
+                                      mesh.vertices[t[2]] * scale, ABSOLUTE);
+  }
+
+  auto solid = new G4TessellatedSolid(name);
+  for (auto facet : facets) {
+    solid->AddFacet(facet);
+  }
+  // builds the voxel structure
+  solid->SetSolidClosed(true);
+
+  if (solid->GetNumberOfFacets() == 0) {
+    G4Exception("FastSTLReader::BuildSolid", "EmptyMesh", FatalException,
+                "The loaded mesh has 0 faces.");
+    return nullptr;
+  }
+  return solid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool FastSTLReader::LoadCache(const std::string& cacheFile, const Stamp& stamp)
+{
+  std::ifstream in(cacheFile, std::ios::binary);
+  if (!in) return false;
+
+  char magic[sizeof(kCacheMagic)];
+  std::uint32_t version = 0, nMeshes = 0;
+  Stamp cached;
+  in.read(magic, sizeof(magic));
+  if (!in || std::memcmp(magic, kCacheMagic, sizeof(magic)) != 0 ||
+      !Get(in, version) || version != kCacheVersion ||
+      !Get(in, cached.size) || !Get(in, cached.mtime) || !Get(in, nMeshes)) {
+    G4cout << "Ignoring unreadable mesh cache " << cacheFile << G4endl;
+    return false;
+  }
+  if (cached.size != stamp.size || cached.mtime != stamp.mtime) {
+    G4cout << "Mesh cache " << cacheFile << " is older than its STL file, re-reading" << G4endl;
+    return false;
+  }
+
+  std::vector<TriangleMesh> meshes(nMeshes);
+  for (auto& mesh : meshes) {
+    std::uint32_t nameLength = 0;
+    std::uint64_t nVertices = 0, nTriangles = 0;
+
+    if (!Get(in, nameLength)) return false;
+    std::string name(nameLength, '\0');
+    in.read(&name[0], nameLength);
+    mesh.name = name;
+
+    if (!Get(in, nVertices)) return false;
+    std::vector<G4double> xyz(3 * nVertices);
+    in.read(reinterpret_cast<char*>(xyz.data()), xyz.size() * sizeof(G4double));
+    mesh.vertices.resize(nVertices);
+    for (std::size_t i = 0; i < nVertices; ++i) {
+      mesh.vertices[i].set(xyz[3 * i], xyz[3 * i + 1], xyz[3 * i + 2]);
+    }
+
+    if (!Get(in, nTriangles)) return false;
+    mesh.triangles.resize(nTriangles);
+    in.read(reinterpret_cast<char*>(mesh.triangles.data()),
+            nTriangles * sizeof(std::array<G4int, 3>));
+    if (!in) return false;
+
+    for (const auto& t : mesh.triangles) {
+      for (G4int i : t) {
+        if (i < 0 || static_cast<std::uint64_t>(i) >= nVertices) return false;
+      }
+    }
+  }
+
+  meshes_ = std::move(meshes);
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void FastSTLReader::SaveCache(const std::string& cacheFile, const Stamp& stamp) const
+{
+  // written under a private name and renamed, so concurrent jobs on the same
+  // geometry never see a partial cache
+  const std::string partial = cacheFile + ".tmp" + std::to_string(getpid());
+  {
+    std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+    out.write(kCacheMagic, sizeof(kCacheMagic));
+    Put(out, kCacheVersion);
+    Put(out, stamp.size);
+    Put(out, stamp.mtime);
+    Put(out, static_cast<std::uint32_t>(meshes_.size()));
+
+    for (const auto& mesh : meshes_) {
+      Put(out, static_cast<std::uint32_t>(mesh.name.size()));
+      out.write(mesh.name.data(), mesh.name.size());
+
+      std::vector<G4double> xyz;
+      xyz.reserve(3 * mesh.vertices.size());
+      for (const auto& v : mesh.vertices) {
+        xyz.insert(xyz.end(), {v.x(), v.y(), v.z()});
+      }
+      Put(out, static_cast<std::uint64_t>(mesh.vertices.size()));
+      out.write(reinterpret_cast<const char*>(xyz.data()), xyz.size() * sizeof(G4double));
+
+      Put(out, static_cast<std::uint64_t>(mesh.triangles.size()));
+      out.write(reinterpret_cast<const char*>(mesh.triangles.data()),
+                mesh.triangles.size() * sizeof(std::array<G4int, 3>));
+    }
+
+    if (!out) {
+      G4Exception("FastSTLReader::SaveCache", "CacheWriteError", JustWarning,
+                  ("Failed to write mesh cache: " + cacheFile).c_str());
+      out.close();
+      std::remove(partial.c_str());
+      return;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(partial, cacheFile, ec);
+  if (ec) std::filesystem::remove(partial, ec);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
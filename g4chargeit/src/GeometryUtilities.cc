@@ -0,0 +1,62 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file GeometryUtilities.cc
+/// \brief Implementation of the geometry helper functions
+//
+
+#include "GeometryUtilities.hh"
+
+#include "G4VSolid.hh"
+
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool GeometryUtilities::NearestSurface(const G4VSolid& solid, const G4ThreeVector& point,
+                                         G4double minStep, G4ThreeVector& direction,
+                                         G4double& distance)
+{
+  const G4bool inside = solid.Inside(point) == kInside;
+  auto safety = [&solid, inside](const G4ThreeVector& p) {
+    return inside ? solid.DistanceToOut(p) : solid.DistanceToIn(p);
+  };
+
+  const G4double depth = safety(point);
+  if (depth <= 0. || depth == kInfinity) return false;
+
+  const G4double h = std::max(1.e-3*depth, minStep);
+  const G4ThreeVector dx(h, 0., 0.), dy(0., h, 0.), dz(0., 0., h);
+  const G4ThreeVector gradient(safety(point + dx) - safety(point - dx),
+                               safety(point + dy) - safety(point - dy),
+                               safety(point + dz) - safety(point - dz));
+  if (gradient.mag2() == 0.) return false;
+
+  direction = -gradient.unit();
+  distance = inside ? solid.DistanceToOut(point, direction) : solid.DistanceToIn(point, direction);
+  return distance != kInfinity;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
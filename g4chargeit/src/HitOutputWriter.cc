@@ -0,0 +1,257 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file HitOutputWriter.cc
+/// \brief Implementation of the HitBatch and HitOutputWriter classes
+//
+
+#include "HitOutputWriter.hh"
+#include "SensitiveDetectorHit.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <chrono>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitBatch::Append(SensitiveDetectorHit* hit, G4int eventNum)
+{
+  eventNumber.push_back(eventNum);
+  processPre.push_back(hit->GetPreProcessName());
+  processPost.push_back(hit->GetPostProcessName());
+  particleType.push_back(hit->GetParticleType());
+  volumePre.push_back(hit->GetPreVolumeName());
+  volumePost.push_back(hit->GetPostVolumeName());
+
+  kineticEnergyPre.push_back(hit->GetPreKineticEnergy() / MeV);
+  kineticEnergyPost.push_back(hit->GetPostKineticEnergy() / MeV);
+  parentID.push_back(hit->GetParentID());
+  weight.push_back(hit->GetWeight());
+
+  prePosition.push_back(hit->GetPrePositionX() / mm);
+  prePosition.push_back(hit->GetPrePositionY() / mm);
+  prePosition.push_back(hit->GetPrePositionZ() / mm);
+
+  postPosition.push_back(hit->GetPostPositionX() / mm);
+  postPosition.push_back(hit->GetPostPositionY() / mm);
+  postPosition.push_back(hit->GetPostPositionZ() / mm);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitBatch::Clear()
+{
+  // clear() keeps the capacity, so recycled batches do not reallocate
+  eventNumber.clear();
+  processPre.clear();
+  processPost.clear();
+  particleType.clear();
+  volumePre.clear();
+  volumePost.clear();
+  kineticEnergyPre.clear();
+  kineticEnergyPost.clear();
+  parentID.clear();
+  weight.clear();
+  prePosition.clear();
+  postPosition.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitBatch::Reserve(std::size_t rows)
+{
+  eventNumber.reserve(rows);
+  processPre.reserve(rows);
+  processPost.reserve(rows);
+  particleType.reserve(rows);
+  volumePre.reserve(rows);
+  volumePost.reserve(rows);
+  kineticEnergyPre.reserve(rows);
+  kineticEnergyPost.reserve(rows);
+  parentID.reserve(rows);
+  weight.reserve(rows);
+  prePosition.reserve(3*rows);
+  postPosition.reserve(3*rows);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::vector<G4int>& HitBatch::Ints(G4int /*column*/) const
+{
+  // kEventNumber is the only Int column
+  return eventNumber;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::vector<G4String>& HitBatch::Strings(G4int column) const
+{
+  switch (column) {
+    case kProcessPre:   return processPre;
+    case kProcessPost:  return processPost;
+    case kParticleType: return particleType;
+    case kVolumePre:    return volumePre;
+    default:            return volumePost;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::vector<G4double>& HitBatch::Doubles(G4int column) const
+{
+  switch (column) {
+    case kKineticEnergyPre:  return kineticEnergyPre;
+    case kKineticEnergyPost: return kineticEnergyPost;
+    case kParentID:          return parentID;
+    case kWeight:            return weight;
+    case kPrePosition:       return prePosition;
+    default:                 return postPosition;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitOutputWriter::Ring::Ring(std::size_t capacity)
+ : slots_(capacity + 1, nullptr), capacity_(capacity + 1), head_(0), tail_(0)
+{}
+
+G4bool HitOutputWriter::Ring::Push(HitBatch* batch)
+{
+  const std::size_t tail = tail_.load(std::memory_order_relaxed);
+  const std::size_t next = (tail + 1) % capacity_;
+  if (next == head_.load(std::memory_order_acquire)) return false; // full
+
+  slots_[tail] = batch;
+  tail_.store(next, std::memory_order_release);
+  return true;
+}
+
+HitBatch* HitOutputWriter::Ring::Pop()
+{
+  const std::size_t head = head_.load(std::memory_order_relaxed);
+  if (head == tail_.load(std::memory_order_acquire)) return nullptr; // empty
+
+  HitBatch* batch = slots_[head];
+  head_.store((head + 1) % capacity_, std::memory_order_release);
+  return batch;
+}
+
+G4bool HitOutputWriter::Ring::Empty() const
+{
+  return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitOutputWriter::HitOutputWriter(Sink sink, G4int nBuffers, std::size_t batchRows)
+ : sink_(std::move(sink)), batchRows_(batchRows),
+   full_(std::max(nBuffers, 2)), free_(std::max(nBuffers, 2)),
+   stop_(false), stalls_(0)
+{
+  // at least two buffers: one being filled while the other is written
+  for (G4int i = 0; i < std::max(nBuffers, 2); ++i) {
+    buffers_.push_back(std::make_unique<HitBatch>());
+    buffers_.back()->Reserve(batchRows_);
+    free_.Push(buffers_.back().get());
+  }
+
+  thread_ = std::thread(&HitOutputWriter::Run, this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitOutputWriter::~HitOutputWriter()
+{
+  Finish();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+HitBatch* HitOutputWriter::AcquireBatch()
+{
+  HitBatch* batch = free_.Pop();
+  if (batch) return batch;
+
+  // back-pressure: every buffer is queued or being written
+  stalls_++;
+  while (!(batch = free_.Pop())) {
+    std::this_thread::yield();
+  }
+  return batch;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutputWriter::Submit(HitBatch* batch)
+{
+  if (!batch) return;
+
+  // cannot fail: the ring holds as many slots as there are buffers
+  while (!full_.Push(batch)) {
+    std::this_thread::yield();
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutputWriter::Finish()
+{
+  if (!thread_.joinable()) return;
+
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void HitOutputWriter::Run()
+{
+  G4int idle = 0;
+
+  while (true) {
+    HitBatch* batch = full_.Pop();
+
+    if (batch) {
+      idle = 0;
+      sink_(*batch);
+      batch->Clear();
+      free_.Push(batch);
+      continue;
+    }
+
+    // the queue is drained before the stop request is honoured
+    if (stop_.load(std::memory_order_acquire) && full_.Empty()) break;
+
+    // spin briefly, then back off so an idle writer does not steal a core
+    if (++idle < 64) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,243 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file LooperWatchdogProcess.cc
+/// \brief Implementation of the LooperWatchdogProcess and
+///        LooperWatchdogPhysics classes
+//
+
+#include "LooperWatchdogProcess.hh"
+#include "GeometryUtilities.hh"
+
+#include "G4Exception.hh"
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4VTouchable.hh"
+
+#include <algorithm>
+
+G4int LooperWatchdogProcess::maxSteps_ = 0;
+G4double LooperWatchdogProcess::loopPath_ = 0.;
+G4double LooperWatchdogProcess::loopDisplacement_ = 0.;
+G4double LooperWatchdogProcess::maxVacuumTime_ = 0.;
+LooperWatchdogProcess::Policy LooperWatchdogProcess::policy_ = LooperWatchdogProcess::kSurface;
+const G4VSolid* LooperWatchdogProcess::grains_ = nullptr;
+G4ThreadLocal LooperStatistics LooperWatchdogProcess::statistics_;
+
+namespace
+{
+  // depth below the surface at which the "surface" policy leaves a charge,
+  // so it lies inside the grain like the charges stopped there
+  const G4double kSurfaceDepth = 1.*nm;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LooperStatistics& LooperStatistics::operator+=(const LooperStatistics& other)
+{
+  bySteps += other.bySteps;
+  byLoop += other.byLoop;
+  byVacuumTime += other.byVacuumTime;
+  steps += other.steps;
+  seconds += other.seconds;
+  return *this;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LooperWatchdogProcess::LooperWatchdogProcess(const G4String& processName)
+ : G4VProcess(processName, fGeneral),
+   lastTime_(0.), lastInVacuum_(false), vacuumTime_(0.), reason_(kNone)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LooperWatchdogProcess::SetPolicy(const G4String& value)
+{
+  if (value == "surface") {
+    policy_ = kSurface;
+  } else if (value == "trapped") {
+    policy_ = kTrapped;
+  } else if (value == "kill") {
+    policy_ = kKill;
+  } else {
+    G4ExceptionDescription msg;
+    msg << "Unknown looper policy " << value << ", keeping " << GetPolicy() << ".";
+    G4Exception("LooperWatchdogProcess::SetPolicy", "Looper001", JustWarning, msg);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const G4String& LooperWatchdogProcess::GetPolicy()
+{
+  static const G4String names[] = {"surface", "trapped", "kill"};
+  return names[policy_];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LooperStatistics LooperWatchdogProcess::TakeStatistics()
+{
+  const LooperStatistics statistics = statistics_;
+  statistics_ = LooperStatistics();
+  return statistics;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool LooperWatchdogProcess::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return particle.GetPDGCharge() != 0. && !particle.IsShortLived();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LooperWatchdogProcess::StartTracking(G4Track* track)
+{
+  G4VProcess::StartTracking(track);
+  reason_ = kNone;
+  if (!IsActive()) return;
+
+  startPosition_ = track->GetPosition();
+  lastTime_ = track->GetGlobalTime();
+  lastInVacuum_ = false;
+  vacuumTime_ = 0.;
+  startClock_ = std::chrono::steady_clock::now();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double LooperWatchdogProcess::PostStepGetPhysicalInteractionLength(
+    const G4Track& track, G4double, G4ForceCondition* condition)
+{
+  *condition = NotForced;
+  if (!IsActive()) return DBL_MAX;
+
+  // vacuum: the material of the world, as opposed to the grains
+  const G4VTouchable* touchable = track.GetTouchable();
+  const G4VPhysicalVolume* volume = touchable->GetVolume();
+  const G4VPhysicalVolume* world = touchable->GetVolume(touchable->GetHistoryDepth());
+  const G4bool inVacuum = volume && volume->GetLogicalVolume()->GetMaterial()
+                                    == world->GetLogicalVolume()->GetMaterial();
+
+  // the previous step counts towards the vacuum time if it started there
+  const G4double time = track.GetGlobalTime();
+  if (lastInVacuum_) vacuumTime_ += time - lastTime_;
+  lastTime_ = time;
+  lastInVacuum_ = inVacuum;
+
+  // tracks are only stopped in the vacuum; in a grain they stop anyway
+  if (!inVacuum) return DBL_MAX;
+
+  if (maxSteps_ > 0 && track.GetCurrentStepNumber() > maxSteps_) {
+    reason_ = kSteps;
+  } else if (loopPath_ > 0. && track.GetTrackLength() > loopPath_
+             && (track.GetPosition() - startPosition_).mag() < loopDisplacement_) {
+    reason_ = kLoop;
+  } else if (maxVacuumTime_ > 0. && vacuumTime_ > maxVacuumTime_) {
+    reason_ = kVacuumTime;
+  } else {
+    return DBL_MAX;
+  }
+
+  // a zero step ends the track at its current position
+  return 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VParticleChange* LooperWatchdogProcess::PostStepDoIt(const G4Track& track, const G4Step&)
+{
+  aParticleChange.Initialize(track);
+  aParticleChange.ProposeTrackStatus(fStopAndKill);
+
+  if (policy_ != kKill) {
+    // zero kinetic energy marks the end of the track as a charge
+    aParticleChange.ProposeLocalEnergyDeposit(track.GetKineticEnergy());
+    aParticleChange.ProposeEnergy(0.);
+
+    G4ThreeVector surface;
+    if (policy_ == kSurface && NearestSurface(track.GetPosition(), surface)) {
+      aParticleChange.ProposePosition(surface);
+    }
+  }
+
+  if (reason_ == kSteps) statistics_.bySteps++;
+  if (reason_ == kLoop) statistics_.byLoop++;
+  if (reason_ == kVacuumTime) statistics_.byVacuumTime++;
+  statistics_.steps += track.GetCurrentStepNumber();
+  statistics_.seconds += std::chrono::duration<G4double>(
+      std::chrono::steady_clock::now() - startClock_).count();
+  reason_ = kNone;
+
+  return &aParticleChange;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool LooperWatchdogProcess::NearestSurface(const G4ThreeVector& point, G4ThreeVector& surface)
+{
+  if (!grains_) return false;
+
+  G4ThreeVector direction;
+  G4double distance = 0.;
+  if (!GeometryUtilities::NearestSurface(*grains_, point, kSurfaceDepth, direction, distance)) {
+    return false;
+  }
+
+  surface = point + (distance + kSurfaceDepth)*direction;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+LooperWatchdogPhysics::LooperWatchdogPhysics(const G4String& name)
+ : G4VPhysicsConstructor(name)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void LooperWatchdogPhysics::ConstructProcess()
+{
+  auto* process = new LooperWatchdogProcess();
+  process->SetVerboseLevel(verboseLevel);
+
+  auto particleIterator = GetParticleIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    G4ParticleDefinition* particle = particleIterator->value();
+    if (process->IsApplicable(*particle)) {
+      particle->GetProcessManager()->AddDiscreteProcess(process);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,341 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PhotonStageCache.cc
+/// \brief Implementation of the PhotonStageCache class
+//
+
+#include "PhotonStageCache.hh"
+#include "PrimarySourceTable.hh"
+
+#include "G4Event.hh"
+#include "G4Gamma.hh"
+#include "G4IonTable.hh"
+#include "G4ParticleTable.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+
+#include <algorithm>
+#include <cstring>
+
+PhotonStageCache* PhotonStageCache::singletonInstance_ = nullptr;
+
+namespace
+{
+  // file layout: magic, number of events, number of particles, then per
+  // event the number of its particles followed by their records
+  const char kMagic[8] = {'P', 'H', 'S', 'T', 'A', 'G', 'E', '2'};
+  const std::streamoff kHeaderSize = sizeof(kMagic) + 2*sizeof(std::uint64_t);
+}
+
+static_assert(sizeof(PhotonStageCache::Particle) == 64, "PhotonStageCache::Particle must be packed");
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::PrimaryInfo::Print() const
+{
+  G4cout << "Replayed photon-stage particle, recorded parent " << parentID_ << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhotonStageCache::PhotonStageCache()
+ : mode_("off"), file_("photon-stage.bin"), recording_(false), replaying_(false),
+   eventOffset_(0), recordedLast_(false),
+   recordedEvents_(0), recordedParticles_(0), wrapWarned_(false)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhotonStageCache* PhotonStageCache::GetInstance()
+{
+  // created on the master before the workers start
+  if (not singletonInstance_) { singletonInstance_ = new PhotonStageCache; }
+
+  return singletonInstance_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::SetMode(const G4String& mode)
+{
+  mode_ = mode;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::BeginRun()
+{
+  recording_ = false;
+  replaying_ = false;
+  wrapWarned_ = false;
+  const G4bool append = eventOffset_ > 0 && recordedLast_;
+  recordedLast_ = false;
+  if (mode_ == "off") return;
+
+  // a further chunk of an iteration appends to the recording of the previous
+  if (append) {
+    output_.open(file_, std::ios::binary | std::ios::in | std::ios::out);
+    if (output_.is_open()) {
+      output_.seekp(0, std::ios::end);
+      recording_ = true;
+      G4cout << "Continuing the recording of the photon stage to " << file_ << G4endl;
+      return;
+    }
+  }
+
+  if (mode_ == "replay" || (mode_ == "auto" && std::ifstream(file_).good())) {
+    replaying_ = Load();
+    if (replaying_) {
+      G4cout << "Replaying the photon stage of " << eventOffsets_.size() - 1 << " events ("
+             << particles_.size() << " particles) from " << file_ << G4endl;
+      return;
+    }
+    if (mode_ == "replay") {
+      G4ExceptionDescription msg;
+      msg << "Cannot replay " << file_ << ": missing, incomplete or not a photon-stage file.";
+      G4Exception("PhotonStageCache::BeginRun", "Cache001", FatalException, msg);
+      return;
+    }
+  }
+
+  // the totals in the header are written at the end of the run
+  output_.open(file_, std::ios::binary | std::ios::trunc);
+  if (!output_.is_open()) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write " << file_ << ", the photon stage is not recorded.";
+    G4Exception("PhotonStageCache::BeginRun", "Cache002", JustWarning, msg);
+    return;
+  }
+  const std::uint64_t zero = 0;
+  output_.write(kMagic, sizeof(kMagic));
+  output_.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+  output_.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+  recordedEvents_ = 0;
+  recordedParticles_ = 0;
+  loadedFile_.clear();
+  recording_ = true;
+  G4cout << "Recording the photon stage to " << file_ << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::EndRun()
+{
+  if (!recording_) return;
+  recording_ = false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  output_.seekp(sizeof(kMagic));
+  output_.write(reinterpret_cast<const char*>(&recordedEvents_), sizeof(recordedEvents_));
+  output_.write(reinterpret_cast<const char*>(&recordedParticles_), sizeof(recordedParticles_));
+  output_.close();
+  recordedLast_ = true;
+  G4cout << "Recorded the photon stage of " << recordedEvents_ << " events ("
+         << recordedParticles_ << " particles) to " << file_ << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool PhotonStageCache::Load()
+{
+  // unchanged since the last replay
+  if (loadedFile_ == file_ && !eventOffsets_.empty()) return true;
+
+  std::ifstream in(file_, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  std::uint64_t events = 0, particles = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&events), sizeof(events));
+  in.read(reinterpret_cast<char*>(&particles), sizeof(particles));
+  // a recording that did not reach EndRun holds no events in its header
+  if (!in.good() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || events == 0) return false;
+
+  particles_.resize(particles);
+  eventOffsets_.assign(1, 0);
+  eventOffsets_.reserve(events + 1);
+  std::uint64_t offset = 0;
+  for (std::uint64_t i = 0; i < events; ++i) {
+    std::uint32_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in.good() || offset + count > particles) break;
+    in.read(reinterpret_cast<char*>(particles_.data() + offset), count*sizeof(Particle));
+    offset += count;
+    eventOffsets_.push_back(offset);
+  }
+  if (!in.good() || eventOffsets_.size() != events + 1 || offset != particles) {
+    particles_.clear();
+    eventOffsets_.clear();
+    return false;
+  }
+
+  loadedFile_ = file_;
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhotonStageCache::EventRecord& PhotonStageCache::ThreadRecord()
+{
+  static G4ThreadLocal EventRecord* record = nullptr;
+  if (!record) record = new EventRecord;
+  return *record;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::BeginEvent()
+{
+  EventRecord& record = ThreadRecord();
+  record.photonStage.clear();
+  record.particles.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::Record(const G4Track* track)
+{
+  EventRecord& record = ThreadRecord();
+  const G4int trackID = track->GetTrackID();
+  const G4int parentID = track->GetParentID();
+  if (trackID >= static_cast<G4int>(record.photonStage.size())) {
+    record.photonStage.resize(trackID + 1, 0);
+  }
+
+  const G4bool fromPhotonStage = parentID == 0 || record.photonStage[parentID];
+  if (!fromPhotonStage) return;
+
+  if (track->GetDefinition() == G4Gamma::Gamma()) {
+    record.photonStage[trackID] = 1;
+    return;
+  }
+
+  // the first particle beyond the photon stage, a primary of the replay
+  const G4ThreeVector& position = track->GetPosition();
+  const G4ThreeVector& direction = track->GetMomentumDirection();
+  Particle particle;
+  particle.position[0] = position.x()/mm;
+  particle.position[1] = position.y()/mm;
+  particle.position[2] = position.z()/mm;
+  particle.direction[0] = static_cast<G4float>(direction.x());
+  particle.direction[1] = static_cast<G4float>(direction.y());
+  particle.direction[2] = static_cast<G4float>(direction.z());
+  particle.energy = static_cast<G4float>(track->GetKineticEnergy()/MeV);
+  particle.weight = static_cast<G4float>(track->GetWeight());
+  particle.time = static_cast<G4float>(track->GetGlobalTime()/ns);
+  particle.pdg = track->GetDefinition()->GetPDGEncoding();
+  particle.parentID = parentID;
+  particle.trackID = trackID;
+  particle.padding = 0;
+  record.particles.push_back(particle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::EndEvent()
+{
+  if (!recording_) return;
+
+  // every event is written, also without particles, so the replay keeps
+  // the number of events of the recording
+  const EventRecord& record = ThreadRecord();
+  const std::uint32_t count = static_cast<std::uint32_t>(record.particles.size());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  output_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  output_.write(reinterpret_cast<const char*>(record.particles.data()), count*sizeof(Particle));
+  recordedEvents_++;
+  recordedParticles_ += count;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhotonStageCache::GeneratePrimaries(G4Event* event) const
+{
+  const std::uint64_t events = eventOffsets_.size() - 1;
+  const std::uint64_t eventID = static_cast<std::uint64_t>(event->GetEventID() + eventOffset_);
+  if (eventID >= events && !wrapWarned_.exchange(true)) {
+    G4ExceptionDescription msg;
+    msg << "The run has more events than the " << events << " recorded in " << file_
+        << "; the recorded events are replayed again.";
+    G4Exception("PhotonStageCache::GeneratePrimaries", "Cache003", JustWarning, msg);
+  }
+
+  // primaries get the track IDs 1, 2, ... in the order they are added
+  EventRecord& record = ThreadRecord();
+  record.replayedTrackIDs.clear();
+  G4int lastTrackID = PrimarySourceTable::GetInstance()->GetPrimariesPerEvent();
+
+  const std::uint64_t index = eventID % events;
+  for (std::uint64_t i = eventOffsets_[index]; i < eventOffsets_[index + 1]; ++i) {
+    const Particle& recorded = particles_[i];
+    G4ParticleDefinition* definition = G4ParticleTable::GetParticleTable()->FindParticle(recorded.pdg);
+    if (!definition) definition = G4IonTable::GetIonTable()->GetIon(recorded.pdg);
+    if (!definition) continue;
+    record.replayedTrackIDs.push_back(recorded.trackID);
+    lastTrackID = std::max<G4int>(lastTrackID, recorded.trackID);
+
+    auto* particle = new G4PrimaryParticle(definition);
+    particle->SetKineticEnergy(recorded.energy*MeV);
+    particle->SetMomentumDirection(G4ThreeVector(recorded.direction[0], recorded.direction[1],
+                                                 recorded.direction[2]).unit());
+    particle->SetWeight(recorded.weight);
+    particle->SetUserInformation(new PrimaryInfo(recorded.parentID));
+
+    const G4ThreeVector position(recorded.position[0]*mm, recorded.position[1]*mm,
+                                 recorded.position[2]*mm);
+    auto* vertex = new G4PrimaryVertex(position, recorded.time*ns);
+    vertex->SetPrimary(particle);
+    event->AddPrimaryVertex(vertex);
+  }
+  // the other tracks follow the primaries; moved past the track IDs of the
+  // recording they are never taken for primaries or their secondaries
+  record.replayShift = lastTrackID - static_cast<G4int>(record.replayedTrackIDs.size());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int PhotonStageCache::GetParentID(const G4Track* track)
+{
+  const G4int parentID = track->GetParentID();
+  if (parentID != 0) {
+    if (!GetInstance()->IsReplaying()) return parentID;
+    // a secondary of a replayed primary has the primary's recorded track ID
+    const EventRecord& record = ThreadRecord();
+    if (parentID <= static_cast<G4int>(record.replayedTrackIDs.size())) {
+      return record.replayedTrackIDs[parentID - 1];
+    }
+    return parentID + record.replayShift;
+  }
+
+  const G4PrimaryParticle* primary = track->GetDynamicParticle()->GetPrimaryParticle();
+  const auto* info = primary ? dynamic_cast<const PrimaryInfo*>(primary->GetUserInformation())
+                             : nullptr;
+  return info ? info->GetParentID() : parentID;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
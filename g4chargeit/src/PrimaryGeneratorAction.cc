@@ -32,9 +32,13 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 #include "PrimaryGeneratorAction.hh"
+#include "PrimarySourceTable.hh"
+#include "PhotonStageCache.hh"
 
 #include "G4Event.hh"
 #include "G4GeneralParticleSource.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
 #include "G4ParticleTable.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleDefinition.hh"
@@ -44,7 +48,7 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 PrimaryGeneratorAction::PrimaryGeneratorAction()
- : G4VUserPrimaryGeneratorAction(),particleGun_(0)
+ : G4VUserPrimaryGeneratorAction(),particleGun_(0),tableVersion_(-1)
 {
   
   G4int n_particle = 1;
@@ -66,7 +70,86 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction()
 
 void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent)
 {
-  particleGun_->GeneratePrimaryVertex(anEvent) ;
+  // the particles released by the recorded photons replace the generators
+  const PhotonStageCache* cache = PhotonStageCache::GetInstance();
+  if (cache->IsReplaying()) {
+    cache->GeneratePrimaries(anEvent);
+    return;
+  }
+
+  PrimarySourceTable* table = PrimarySourceTable::GetInstance();
+
+  if (table->UseAliasGenerator()) {
+    GenerateFromSourceTable(anEvent);
+    return;
+  }
+
+  for (G4int i = 0; i < table->GetPrimariesPerEvent(); ++i) {
+    particleGun_->GeneratePrimaryVertex(anEvent) ;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryGeneratorAction::GenerateFromSourceTable(G4Event* anEvent)
+{
+  const PrimarySourceTable* table = PrimarySourceTable::GetInstance();
+  const auto& sources = table->GetSources();
+
+  // the particle table lookups are repeated only when the sources change
+  if (tableVersion_ != table->GetVersion()) {
+    definitions_.clear();
+    for (const auto& source : sources) {
+      G4ParticleDefinition* definition = G4ParticleTable::GetParticleTable()->FindParticle(source.particle);
+      if (!definition || !source.spectrum || source.spectrum->IsEmpty()) {
+        G4ExceptionDescription msg;
+        msg << "Source " << definitions_.size() << " (" << source.particle << ") needs a known particle "
+            << "and a spectrum (/source/spectrum) for the alias generator.";
+        G4Exception("PrimaryGeneratorAction::GenerateFromSourceTable", "Source001", FatalException, msg);
+      }
+      definitions_.push_back(definition);
+    }
+    tableVersion_ = table->GetVersion();
+  }
+
+  for (G4int i = 0; i < table->GetPrimariesPerEvent(); ++i) {
+    const std::size_t index = table->SelectSource(G4UniformRand());
+    const PrimarySourceTable::Source& source = sources[index];
+
+    G4ThreeVector position = source.centre;
+    if (source.shadow) {
+      // culled: only the part of the plane that reaches the grains
+      const G4double u1 = G4UniformRand();
+      const G4double u2 = G4UniformRand();
+      position += source.shadow->Sample(u1, u2, G4UniformRand());
+    } else {
+      const G4double u1 = G4UniformRand();
+      position += G4ThreeVector((2.*u1 - 1.)*source.halfX, (2.*G4UniformRand() - 1.)*source.halfY, 0.);
+    }
+
+    G4ThreeVector direction = source.direction;
+    if (source.isotropic) {
+      // uniform in solid angle around -z, as /gps/ang/type iso with maxtheta
+      const G4double cosTheta = 1. - G4UniformRand()*(1. - source.cosMaxTheta);
+      const G4double sinTheta = std::sqrt(std::max(0., 1. - cosTheta*cosTheta));
+      const G4double phi = twopi*G4UniformRand();
+      direction.set(-sinTheta*std::cos(phi), -sinTheta*std::sin(phi), -cosTheta);
+    }
+
+    // the weight is 1 unless the source biases its energies
+    const G4double u1 = G4UniformRand();
+    G4double weight = 1.;
+    const G4double energy = source.spectrum->Sample(u1, G4UniformRand(), &weight);
+
+    auto* particle = new G4PrimaryParticle(definitions_[index]);
+    particle->SetKineticEnergy(energy);
+    particle->SetMomentumDirection(direction);
+    particle->SetWeight(weight);
+
+    auto* vertex = new G4PrimaryVertex(position, 0.);
+    vertex->SetPrimary(particle);
+    anEvent->AddPrimaryVertex(vertex);
+  }
 }
 
 
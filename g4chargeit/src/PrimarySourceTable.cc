@@ -0,0 +1,306 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file PrimarySourceTable.cc
+/// \brief Implementation of the PrimarySourceTable class
+//
+
+#include "PrimarySourceTable.hh"
+
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4UnitsTable.hh"
+
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimarySourceTable* PrimarySourceTable::singletonInstance_ = nullptr;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimarySourceTable::PrimarySourceTable()
+ : generator_("gps"), primariesPerEvent_(1), sources_(1), cumulative_(1, 1.), version_(0),
+   culling_(false), cullingCells_(256), shadowVersion_(-1), shadowGeometryVersion_(-1)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimarySourceTable* PrimarySourceTable::GetInstance()
+{
+  // created on the master before the workers start
+  if (not singletonInstance_) { singletonInstance_ = new PrimarySourceTable; }
+
+  return singletonInstance_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetGenerator(const G4String& value)
+{
+  generator_ = value;
+  version_++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetPrimariesPerEvent(G4int value)
+{
+  primariesPerEvent_ = std::max(value, 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::AddSource(G4double intensity)
+{
+  sources_.emplace_back();
+  SetIntensity(intensity);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetIntensity(G4double value)
+{
+  Current().intensity = std::max(value, 0.);
+  UpdateCumulative();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::UpdateCumulative()
+{
+  cumulative_.clear();
+  G4double sum = 0.;
+  for (const auto& source : sources_) {
+    sum += source.intensity*(source.shadow ? source.shadow->GetAcceptance() : 1.);
+    cumulative_.push_back(sum);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetCulling(G4bool value)
+{
+  culling_ = value;
+  version_++;
+}
+
+void PrimarySourceTable::SetCullingCells(G4int value)
+{
+  cullingCells_ = std::max(value, 1);
+  version_++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::UpdateShadows(const G4VSolid& grains, const G4ThreeVector& worldHalf, G4bool periodic,
+                                       G4int geometryVersion)
+{
+  if (!UseAliasGenerator()) return;
+  if (shadowVersion_ == version_ && shadowGeometryVersion_ == geometryVersion) return;
+  shadowVersion_ = version_;
+  shadowGeometryVersion_ = geometryVersion;
+
+  for (std::size_t i = 0; i < sources_.size(); ++i) {
+    Source& source = sources_[i];
+    source.shadow.reset();
+    if (!culling_) continue;
+
+    // charged primaries can be bent onto the grains by the field
+    const G4ParticleDefinition* definition = G4ParticleTable::GetParticleTable()->FindParticle(source.particle);
+    if (source.isotropic || !definition || definition->GetPDGCharge() != 0.) {
+      G4cout << "Source " << i << " (" << source.particle << "): not culled, "
+             << "only neutral sources with a fixed direction are" << G4endl;
+      continue;
+    }
+
+    auto shadow = std::make_shared<SourceShadowMask>();
+    shadow->Build(grains, source.centre, source.halfX, source.halfY, source.direction,
+                  worldHalf, periodic, cullingCells_);
+    if (shadow->GetAcceptance() == 0.) {
+      G4Exception("PrimarySourceTable::UpdateShadows", "SourceMissesGrains", JustWarning,
+                  ("No ray of source " + std::to_string(i) + " reaches the grains, it is not culled.").c_str());
+      continue;
+    }
+    source.shadow = shadow;
+    G4cout << "Source " << i << " (" << source.particle << "): culled to "
+           << 100.*shadow->GetAcceptance() << "% of its plane" << G4endl;
+  }
+  UpdateCumulative();
+
+  if (GetAcceptance() < 1.) {
+    G4cout << "Source acceptance " << GetAcceptance() << ": an event stands for "
+           << 1./GetAcceptance() << " primaries of the full planes" << G4endl;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double PrimarySourceTable::GetAcceptance() const
+{
+  G4double total = 0.;
+  for (const auto& source : sources_) total += source.intensity;
+
+  return total > 0. ? cumulative_.back()/total : 1.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetParticle(const G4String& value)
+{
+  Current().particle = value;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetSpectrum(const G4String& fileName)
+{
+  Source& source = Current();
+  source.spectrumFile = fileName;
+  LoadSpectrum(source);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetInterpolation(const G4String& value)
+{
+  Source& source = Current();
+  source.interpolation = (value == "Log") ? SpectrumSampler::kPowerLaw : SpectrumSampler::kLinear;
+  if (!source.spectrumFile.empty()) LoadSpectrum(source);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::LoadSpectrum(Source& source)
+{
+  // a new sampler, so a generator still holding the old one is not affected
+  auto spectrum = std::make_shared<SpectrumSampler>();
+  source.spectrum.reset();
+  if (!spectrum->Load(source.spectrumFile, source.interpolation)) return;
+
+  const G4bool biased = source.minEnergy > 0. || source.tailFactor != 1.;
+  if (biased && !spectrum->SetBias(source.minEnergy, source.tailEnergy, source.tailFactor)) {
+    G4Exception("PrimarySourceTable::LoadSpectrum", "SpectrumBias", JustWarning,
+                (source.spectrumFile + ": nothing of the spectrum is left above the minimum energy").c_str());
+    return;
+  }
+
+  source.spectrum = spectrum;
+  G4cout << "Source " << sources_.size() - 1 << ": " << source.spectrumFile << " ("
+         << (source.interpolation == SpectrumSampler::kPowerLaw ? "Log" : "Lin") << ")";
+  if (biased) {
+    G4cout << ", from " << G4BestUnit(source.minEnergy, "Energy");
+    if (source.tailFactor != 1. && source.tailEnergy < DBL_MAX) {
+      G4cout << ", " << source.tailFactor << "x from " << G4BestUnit(source.tailEnergy, "Energy");
+    }
+    G4cout << " (weighted)";
+  }
+  G4cout << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::WarnBiasIgnored(const G4String& command) const
+{
+  if (UseAliasGenerator()) return;
+  G4ExceptionDescription msg;
+  msg << command << " only applies to /source/generator alias; the gps generator "
+      << "ignores it and samples the unbiased /gps/ spectrum.";
+  G4Exception("PrimarySourceTable::WarnBiasIgnored", "BiasIgnored", JustWarning, msg);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetMinEnergy(G4double value)
+{
+  WarnBiasIgnored("/source/minEnergy");
+  Source& source = Current();
+  source.minEnergy = value;
+  if (!source.spectrumFile.empty()) LoadSpectrum(source);
+}
+
+void PrimarySourceTable::SetTailEnergy(G4double value)
+{
+  WarnBiasIgnored("/source/tailEnergy");
+  Source& source = Current();
+  source.tailEnergy = value;
+  if (!source.spectrumFile.empty()) LoadSpectrum(source);
+}
+
+void PrimarySourceTable::SetTailFactor(G4double value)
+{
+  WarnBiasIgnored("/source/tailFactor");
+  Source& source = Current();
+  source.tailFactor = value;
+  if (!source.spectrumFile.empty()) LoadSpectrum(source);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetCentre(const G4ThreeVector& value)
+{
+  Current().centre = value;
+}
+
+void PrimarySourceTable::SetHalfX(G4double value)
+{
+  Current().halfX = value;
+}
+
+void PrimarySourceTable::SetHalfY(G4double value)
+{
+  Current().halfY = value;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetDirection(const G4ThreeVector& value)
+{
+  Source& source = Current();
+  source.direction = value.unit();
+  source.isotropic = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySourceTable::SetIsotropic(G4double maxTheta)
+{
+  Source& source = Current();
+  source.isotropic = true;
+  source.cosMaxTheta = std::cos(maxTheta);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t PrimarySourceTable::SelectSource(G4double u) const
+{
+  // a handful of sources: a linear search of the cumulative intensities
+  const G4double target = u*cumulative_.back();
+  std::size_t i = 0;
+  while (i + 1 < sources_.size() && target >= cumulative_[i]) ++i;
+  return i;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
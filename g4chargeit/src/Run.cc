@@ -31,11 +31,14 @@
 
 #include "Run.hh"
 #include "SDManager.hh"
+#include "AdaptiveSumRadialFieldMap.hh"
+#include "TrackFieldManager.hh"
+#include "PhotonStageCache.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 Run::Run()
-: G4Run()
+: G4Run(), fieldCalls_(0), fieldSteps_(0)
 { }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -50,6 +53,27 @@ void Run::RecordEvent(const G4Event*)
  
   SDManager::RecordTrees();    
 
+  // field work of this thread during the event
+  fieldCalls_ += AdaptiveSumRadialFieldMap::TakeFieldCallCount();
+  fieldSteps_ += TrackFieldManager::TakeFieldStepCount();
+  loopers_ += LooperWatchdogProcess::TakeStatistics();
+  periodic_ += WorldPeriodicBoundaryProcess::TakeStatistics();
+
+  // particles of the photon stage, while it is recorded
+  PhotonStageCache::GetInstance()->EndEvent();
 } 
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Run::Merge(const G4Run* run)
+{
+  auto localRun = static_cast<const Run*>(run);
+  fieldCalls_ += localRun->fieldCalls_;
+  fieldSteps_ += localRun->fieldSteps_;
+  loopers_ += localRun->loopers_;
+  periodic_ += localRun->periodic_;
+
+  G4Run::Merge(run);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -35,10 +35,19 @@
 #include "Run.hh"
 #include "SDManager.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "ThreadCoordinator.hh"
+#include "DetectorConstruction.hh"
+#include "LooperWatchdogProcess.hh"
+#include "PhotonStageCache.hh"
+#include "SurrogateEmissionModel.hh"
 
 #include "G4Run.hh"
+#include "G4RunManager.hh"
 #include "Randomize.hh"
 #include "G4Timer.hh"
+#include "G4Threading.hh"
+
+#include <algorithm>
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -47,6 +56,8 @@ RunAction::RunAction(PrimaryGeneratorAction*)
     rootManager_(G4RootAnalysisManager::Instance())
 {
   timer = new G4Timer();
+  // in MT mode merge the worker ntuples into the master file
+  if (G4Threading::IsMultithreadedApplication()) rootManager_->SetNtupleMerging(true);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -71,9 +82,25 @@ void RunAction::BeginOfRunAction(const G4Run*)
 
   // show Rndm status
   if (isMaster) G4Random::showEngineStatus();
+  auto detector = const_cast<DetectorConstruction*>(static_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction()));
+  // rebuild what the macro changed since the last run (field map, charges)
+  if (isMaster) detector->UpdateStages();
+  // record the photon stage of this run or replay an earlier recording
+  if (isMaster) PhotonStageCache::GetInstance()->BeginRun();
+  // load the surrogate emission table, or start calibrating it
+  if (isMaster) SurrogateEmissionModel::BeginRun();
+  // the cores go to the event workers until the end of the run
+  if (isMaster) ThreadCoordinator::GetInstance()->BeginTracking();
+  // pick up a field map rebuilt since the last run
+  detector->UpdateThreadField();
   timer->Start(); 
   // open the file 
   rootManager_->SetVerboseLevel(1); 
+  if (!SDManager::IsBinaryOutput() && !SDManager::GetOutputFile().empty()) {
+    G4cout << "Opening ROOT file: " << SDManager::GetOutputFile() << G4endl;
+    rootManager_->OpenFile(SDManager::GetOutputFile());
+  }
 
   // create trees
   SDManager::CreateTrees(); 
@@ -87,12 +114,47 @@ void RunAction::EndOfRunAction(const G4Run*)
 
   // show Rndm status
   if (isMaster) G4Random::showEngineStatus();
-
-  // close the file
-  rootManager_ -> Write();
-  rootManager_ -> CloseFile();
+  if (isMaster) ThreadCoordinator::GetInstance()->EndTracking();
+  if (isMaster) PhotonStageCache::GetInstance()->EndRun();
+  if (isMaster) SurrogateEmissionModel::EndRun();
+
+  // write hits still buffered for the output thread, then close the file
+  SDManager::FlushTrees();
+  if (!SDManager::IsBinaryOutput()) {
+    rootManager_ -> Write();
+    rootManager_ -> CloseFile();
+  }
   timer->Stop(); // Stop the timer
   G4cout << "Elapsed time: " << *timer << G4endl;
+
+  // totals of all threads, merged into the master run
+  if (isMaster && run_->GetFieldSteps() > 0) {
+    auto detector = static_cast<const DetectorConstruction*>(
+        G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    G4cout << "Field (" << detector->GetFieldStepper() << "/" << detector->GetFieldDriver() << "): "
+           << run_->GetFieldCalls() << " field calls in " << run_->GetFieldSteps() << " steps, "
+           << G4double(run_->GetFieldCalls())/run_->GetFieldSteps() << " per step, "
+           << G4double(run_->GetFieldCalls())/std::max(run_->GetNumberOfEvent(), 1) << " per event" << G4endl;
+  }
+
+  // the tracking time of the stopped tracks until they were caught, a lower
+  // bound of what they would have cost
+  if (isMaster && LooperWatchdogProcess::IsActive()) {
+    const LooperStatistics& loopers = run_->GetLoopers();
+    G4cout << "Loopers (" << LooperWatchdogProcess::GetPolicy() << "): " << loopers.Tracks()
+           << " tracks stopped (" << loopers.bySteps << " by steps, " << loopers.byLoop << " looping, "
+           << loopers.byVacuumTime << " by vacuum time) after " << loopers.steps << " steps and "
+           << loopers.seconds << " s of tracking" << G4endl;
+  }
+
+  // steps in the world for which the periodic boundary DoIt still runs
+  if (isMaster && run_->GetPeriodic().steps > 0) {
+    const PeriodicStatistics& periodic = run_->GetPeriodic();
+    const G4long invoked = periodic.forced + periodic.limited;
+    G4cout << "Periodic boundary: DoIt on " << invoked << " of " << periodic.steps
+           << " world steps (" << 100.*invoked/periodic.steps << " %; " << periodic.forced
+           << " forced, " << periodic.limited << " limited short of a face)" << G4endl;
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -29,6 +29,18 @@
 
 #include "SDManager.hh"
 #include "SensitiveDetector.hh"
+#include "BinaryHitWriter.hh"
+
+#include "G4MTRunManager.hh"
+#include "G4RootAnalysisManager.hh"
+#include "G4Threading.hh"
+
+namespace {
+    // master copy of the ntuple, only booked so worker ntuples can be merged
+    std::array<int, kNumHitColumns> masterColumnID;
+    std::vector<double> masterPreValues;
+    std::vector<double> masterPostValues;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -46,8 +58,57 @@ SDManager* SDManager::GetInstance()
   return singletonInstance_;
 }
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SDManager::CreateTrees()
+{
+  if (!sd_) {
+    // master thread in MT mode: the SDs live on the workers
+    if (!IsBinaryOutput()) {
+      SensitiveDetector::BookNtuple(G4RootAnalysisManager::Instance(), masterColumnID,
+                                    masterPreValues, masterPostValues);
+    }
+    return;
+  }
+
+  sd_ -> SetAsyncOutput(asyncOutput_);
+  sd_ -> SetOutputBuffers(outputBuffers_);
+  sd_ -> SetOutputBatchRows(outputBatchRows_);
+  sd_ -> SetBinaryOutput(IsBinaryOutput());
+  sd_ -> SetOutputFile(outputFile_);
+  sd_ -> CreateTrees();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SDManager::FlushTrees()
+{
+  if (sd_) {
+    sd_ -> FlushTrees();
+    return;
+  }
+
+  // master thread in MT mode: the workers have finished, merge their columns
+  if (IsBinaryOutput() && G4Threading::IsMultithreadedApplication()) {
+    std::vector<std::string> parts;
+    const G4int nThreads = G4MTRunManager::GetMasterRunManager()->GetNumberOfThreads();
+    for (G4int i = 0; i < nThreads; ++i) {
+      parts.push_back(BinaryHitWriter::ThreadDirectoryFor(outputFile_, i));
+    }
+    BinaryHitWriter::Merge(parts, BinaryHitWriter::DirectoryFor(outputFile_));
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 SDManager* SDManager::singletonInstance_ = nullptr;
-SensitiveDetector* SDManager::sd_ = nullptr;
+G4ThreadLocal SensitiveDetector* SDManager::sd_ = nullptr;
+
+G4bool SDManager::asyncOutput_ = false;
+G4int SDManager::outputBuffers_ = 2;
+G4int SDManager::outputBatchRows_ = 4096;
+G4String SDManager::outputFile_ = "";
+G4String SDManager::outputFormat_ = "root";
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......  
 
@@ -28,6 +28,8 @@
 //
 
 #include "SensitiveDetector.hh"
+#include "ChargeCollector.hh"
+#include "SurrogateEmissionModel.hh"
 
 #include "G4HCofThisEvent.hh"
 #include "G4Step.hh"
@@ -36,6 +38,9 @@
 #include "G4RootAnalysisManager.hh"
 #include "G4Event.hh"
 #include "G4RunManager.hh"
+#include "G4Threading.hh"
+
+#include <atomic>
 
 //#include "<vector>"
 
@@ -45,7 +50,10 @@ SensitiveDetector::SensitiveDetector(std::string sdName)
 
 : G4VSensitiveDetector(sdName),
    hits_(nullptr), collectionID_(-1), event_(nullptr),
-   rootManager_(G4RootAnalysisManager::Instance()) 
+   rootManager_(G4RootAnalysisManager::Instance()),
+   asyncOutput_(false), outputBuffers_(2), outputBatchRows_(4096),
+   writer_(nullptr), batch_(nullptr), binaryOutput_(false), outputFile_(""),
+   binaryWriter_(nullptr)
 {  
    // print the SD name 
    G4cout<<"Creating SD with name:"<<sdName<<G4endl;
@@ -57,7 +65,9 @@ SensitiveDetector::SensitiveDetector(std::string sdName)
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 SensitiveDetector::~SensitiveDetector()
-{}
+{
+  if (writer_) writer_->Finish();
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -95,30 +105,75 @@ G4bool SensitiveDetector::ProcessHits(G4Step* step,
 
 void SensitiveDetector::CreateTrees()
 {
-   // create an ROOT Tree (n-tuple) and get the tree pointer.
-   treeID_ = rootManager_-> CreateNtuple("Hit Data",
-                                        "Particle, Energy, and Position Information");
-
-   // create branches for particle tree
-   evtBranchID_ = rootManager_ -> CreateNtupleIColumn(treeID_, "Event_Number");
-   processPreID_ = rootManager_ -> CreateNtupleSColumn(treeID_, "Process_Name_Pre");
-   processPostID_ = rootManager_ -> CreateNtupleSColumn(treeID_, "Process_Name_Post");
-   particleTypeID_ = rootManager_ -> CreateNtupleSColumn(treeID_, "Particle_Type");
-   volumePreID_ = rootManager_ -> CreateNtupleSColumn(treeID_, "Volume_Name_Pre");
-   volumePostID_ = rootManager_ -> CreateNtupleSColumn(treeID_, "Volume_Name_Post");
+   if (binaryOutput_) {
+     // binary column files replace the ROOT tree
+     binaryWriter_ = std::make_unique<BinaryHitWriter>();
+     // worker threads write parts that the master merges at the end of the run
+     binaryWriter_->Open(G4Threading::IsWorkerThread()
+         ? BinaryHitWriter::ThreadDirectoryFor(outputFile_, G4Threading::G4GetThreadId())
+         : BinaryHitWriter::DirectoryFor(outputFile_));
+   } else {
+     treeID_ = BookNtuple(rootManager_, columnID_, vectorPreValues_, vectorPostValues_);
+   }
 
-   // create branches for energy Tree
+   // the analysis manager is thread-local, so ROOT fills must stay on the
+   // tracking thread; only the binary sink is written in the background
+   if (asyncOutput_ && !binaryOutput_) {
+     static std::atomic<G4bool> warned(false);
+     if (!warned.exchange(true)) {
+       G4ExceptionDescription msg;
+       msg << "/geometry/rootoutput/async needs /geometry/rootoutput/format binary;"
+           << " ROOT hits are written on the tracking thread.";
+       G4Exception("SensitiveDetector::CreateTrees", "SensitiveDetector001", JustWarning, msg);
+     }
+   }
 
-   kineticEnergyPreID_ = rootManager_ -> CreateNtupleDColumn(treeID_, "Kinetic_Energy_Pre_MeV");
-   kineticEnergyPostID_ = rootManager_ -> CreateNtupleDColumn(treeID_, "Kinetic_Energy_Post_MeV");
-   parentID_ = rootManager_ -> CreateNtupleDColumn(treeID_, "Parent_ID");
+   // start the background writer for this run
+   if (asyncOutput_ && binaryOutput_) {
+     writer_ = std::make_unique<HitOutputWriter>(
+         [this](const HitBatch& batch) { WriteBatch(batch); },
+         outputBuffers_, static_cast<std::size_t>(outputBatchRows_));
+     batch_ = writer_->AcquireBatch();
+     G4cout << "Asynchronous binary output with " << outputBuffers_ 
+            << " buffers of " << outputBatchRows_ << " hits" << G4endl;
+   } else {
+     batch_ = &syncBatch_;
+   }
+}
 
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-   // create branches for position tree
-   rootManager_ -> CreateNtupleDColumn(treeID_, "Pre_Step_Position_mm",vectorPreValues_);   
-   rootManager_ -> CreateNtupleDColumn(treeID_, "Post_Step_Position_mm",vectorPostValues_);
+G4int SensitiveDetector::BookNtuple(G4RootAnalysisManager* rootManager,
+                                    std::array<int, kNumHitColumns>& columnID,
+                                    std::vector<double>& preValues,
+                                    std::vector<double>& postValues)
+{
+   // create an ROOT Tree (n-tuple) and get the tree pointer.
+   G4int treeID = rootManager -> CreateNtuple("Hit Data",
+                                              "Particle, Energy, and Position Information");
+
+   // create one branch per hit column
+   for (int i = 0; i < kNumHitColumns; ++i) {
+     const HitColumn& column = kHitColumns[i];
+     switch (column.type) {
+       case HitColumnType::Int:
+         columnID[i] = rootManager -> CreateNtupleIColumn(treeID, column.name);
+         break;
+       case HitColumnType::String:
+         columnID[i] = rootManager -> CreateNtupleSColumn(treeID, column.name);
+         break;
+       case HitColumnType::Double:
+         columnID[i] = rootManager -> CreateNtupleDColumn(treeID, column.name);
+         break;
+       case HitColumnType::DoubleVector:
+         columnID[i] = rootManager -> CreateNtupleDColumn(treeID, column.name,
+             i == kPrePosition ? preValues : postValues);
+         break;
+     }
+   }
 
-   rootManager_-> FinishNtuple(treeID_);
+   rootManager -> FinishNtuple(treeID);
+   return treeID;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -130,33 +185,86 @@ void SensitiveDetector::RecordTrees()
    int eventNum = G4RunManager::GetRunManager()->GetCurrentEvent()->GetEventID();
 
    for ( auto sdHit : *(hits_->GetVector()) ) {
+     batch_->Append(sdHit, eventNum);
+   }
+
+   // keep the deposited charges in memory for the next iteration
+   auto collector = ChargeCollector::GetInstance();
+   if (collector->IsEnabled()) collector->AddEvent(*hits_->GetVector());
+
+   // photoemission of the grains for the surrogate (/surrogate/mode calibrate)
+   SurrogateEmissionModel::Calibrate(*hits_->GetVector());
+
+   if (!writer_) {
+     // synchronous output: write the event straight away
+     WriteBatch(*batch_);
+     batch_->Clear();
+   } else if (batch_->Size() >= writer_->GetBatchRows()) {
+     // hand the full batch to the writer thread and continue with a free one
+     writer_->Submit(batch_);
+     batch_ = writer_->AcquireBatch();
+   }
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SensitiveDetector::FlushTrees()
+{
+   if (writer_) {
+     // submit the partially filled batch and wait for the writer to drain
+     if (batch_ && batch_->Size() > 0) writer_->Submit(batch_);
+     writer_->Finish();
+
+     if (writer_->GetStallCount() > 0) {
+       G4cout << "Output writer stalled event processing " << writer_->GetStallCount() 
+              << " times (consider more buffers)" << G4endl;
+     }
+
+     writer_.reset();
+     batch_ = nullptr;
+   }
+
+   if (binaryWriter_) {
+     binaryWriter_->Close();
+     binaryWriter_.reset();
+   }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SensitiveDetector::WriteBatch(const HitBatch& batch)
+{
+
+   if (binaryWriter_) {
+     binaryWriter_->Write(batch);
+     return;
+   }
+
+   for ( std::size_t i = 0; i < batch.Size(); ++i ) {
   
-     // save particle information
-     rootManager_ -> FillNtupleIColumn(treeID_, evtBranchID_, eventNum); 
-     rootManager_ -> FillNtupleSColumn(treeID_, processPreID_, sdHit -> GetPreProcessName());
-     rootManager_ -> FillNtupleSColumn(treeID_, processPostID_, sdHit -> GetPostProcessName());
-     rootManager_ -> FillNtupleSColumn(treeID_, particleTypeID_, sdHit ->GetParticleType());
-     rootManager_ -> FillNtupleSColumn(treeID_, volumePreID_, sdHit ->GetPreVolumeName());
-     rootManager_ -> FillNtupleSColumn(treeID_, volumePostID_, sdHit ->GetPostVolumeName());
-
-     // save energy information
-     rootManager_ -> FillNtupleDColumn(treeID_, kineticEnergyPreID_, sdHit ->GetPreKineticEnergy() / MeV);
-     rootManager_ -> FillNtupleDColumn(treeID_, kineticEnergyPostID_, sdHit ->GetPostKineticEnergy() / MeV);
-     rootManager_ -> FillNtupleDColumn(treeID_, parentID_, sdHit ->GetParentID());
-
-     // save post step position 
-     vectorPreValues_.clear();    
-     vectorPreValues_.push_back(sdHit ->GetPrePositionX() / mm);
-     vectorPreValues_.push_back(sdHit ->GetPrePositionY() / mm);
-     vectorPreValues_.push_back(sdHit ->GetPrePositionZ() / mm); 
-
-     // save post step position 
-     vectorPostValues_.clear();   
-     vectorPostValues_.push_back(sdHit ->GetPostPositionX() / mm);
-     vectorPostValues_.push_back(sdHit ->GetPostPositionY() / mm);
-     vectorPostValues_.push_back(sdHit ->GetPostPositionZ() / mm); 
-
-     // add position information to branch
+     // save one row, column by column in kHitColumns order
+     for (int column = 0; column < kNumHitColumns; ++column) {
+       switch (kHitColumns[column].type) {
+         case HitColumnType::Int:
+           rootManager_ -> FillNtupleIColumn(treeID_, columnID_[column], batch.Ints(column)[i]);
+           break;
+         case HitColumnType::String:
+           rootManager_ -> FillNtupleSColumn(treeID_, columnID_[column], batch.Strings(column)[i]);
+           break;
+         case HitColumnType::Double:
+           rootManager_ -> FillNtupleDColumn(treeID_, columnID_[column], batch.Doubles(column)[i]);
+           break;
+         case HitColumnType::DoubleVector: {
+           // position vectors are bound to the branch when the ntuple is booked
+           const auto& values = batch.Doubles(column);
+           auto& target = (column == kPrePosition) ? vectorPreValues_ : vectorPostValues_;
+           target.assign(values.begin() + 3*i, values.begin() + 3*i + 3);
+           break;
+         }
+       }
+     }
+
      rootManager_ -> AddNtupleRow(treeID_);
     
    }
@@ -28,6 +28,7 @@
 //
 
 #include "SensitiveDetectorHit.hh"
+#include "PhotonStageCache.hh"
 #include "G4Step.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4VProcess.hh"
@@ -60,7 +61,10 @@ SensitiveDetectorHit::SensitiveDetectorHit(const G4Step* step) {
 
    kineticEnergyPre_ = step -> GetPreStepPoint() -> GetKineticEnergy();
    kineticEnergyPost_ = step -> GetPostStepPoint() -> GetKineticEnergy();
-   parentID_ = step -> GetTrack() -> GetParentID();
+   // replayed photon-stage particles report the parent of their recording
+   parentID_ = PhotonStageCache::GetParentID(step -> GetTrack());
+   // statistical weight, 1 unless the primary was biased
+   weight_ = step -> GetTrack() -> GetWeight();
 
    // step info for particle pre position
    postPreX_ = step -> GetPreStepPoint() -> GetPosition().x();
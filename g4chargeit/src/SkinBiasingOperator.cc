@@ -0,0 +1,221 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SkinBiasingOperator.cc
+/// \brief Implementation of the SkinBiasingOperator class
+//
+
+#include "SkinBiasingOperator.hh"
+
+#include "G4BiasingProcessInterface.hh"
+#include "G4BiasingProcessSharedData.hh"
+#include "G4BOptnChangeCrossSection.hh"
+#include "G4EmParameters.hh"
+#include "G4Gamma.hh"
+#include "G4GenericBiasingPhysics.hh"
+#include "G4NavigationHistory.hh"
+#include "G4ParticleChangeForNothing.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4VSolid.hh"
+#include "G4VTouchable.hh"
+
+#include <algorithm>
+
+G4double SkinBiasingOperator::sharedSkinDepth_ = 0.;
+G4double SkinBiasingOperator::sharedSkinFactor_ = 10.;
+G4bool SkinBiasingOperator::physicsRegistered_ = false;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SkinBiasingOperator::StepLimitOperation::StepLimitOperation()
+ : G4VBiasingOperation("SkinStepLimit"), distance_(DBL_MAX),
+   particleChange_(new G4ParticleChangeForNothing())
+{}
+
+SkinBiasingOperator::StepLimitOperation::~StepLimitOperation()
+{
+  delete particleChange_;
+}
+
+G4double SkinBiasingOperator::StepLimitOperation::DistanceToApplyOperation(
+    const G4Track*, G4double, G4ForceCondition* condition)
+{
+  *condition = NotForced;
+  return distance_;
+}
+
+G4VParticleChange* SkinBiasingOperator::StepLimitOperation::GenerateBiasingFinalState(
+    const G4Track* track, const G4Step*)
+{
+  // the step only ends at the skin boundary, the photon goes on unchanged
+  particleChange_->Initialize(*track);
+  return particleChange_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SkinBiasingOperator::SkinBiasingOperator()
+ : G4VBiasingOperator("SkinBiasingOperator"),
+   skinDepth_(0.), skinFactor_(1.),
+   stepLimit_(std::make_unique<StepLimitOperation>()),
+   depthTrack_(nullptr), depth_(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SkinBiasingOperator::~SkinBiasingOperator()
+{
+  for (auto& entry : operations_) delete entry.second;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SkinBiasingOperator::SetSkinDepth(G4double depth)
+{
+  sharedSkinDepth_ = std::max(depth, 0.);
+  if (sharedSkinDepth_ <= 0. || physicsRegistered_) return;
+
+  // the biasing process wrappers have to exist before the physics is built
+  auto physicsList = dynamic_cast<G4VModularPhysicsList*>(
+    const_cast<G4VUserPhysicsList*>(G4RunManager::GetRunManager()->GetUserPhysicsList()));
+  if (G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit || !physicsList) {
+    G4ExceptionDescription msg;
+    msg << "/biasing/skin has to be given before /run/initialize; the photoabsorption"
+        << " stays unbiased.";
+    G4Exception("SkinBiasingOperator::SetSkinDepth", "SkinBiasing001", JustWarning, msg);
+    sharedSkinDepth_ = 0.;
+    return;
+  }
+
+  // the photoelectric effect must be a process of its own to be wrapped,
+  // not a part of the gamma general process
+  G4EmParameters::Instance()->SetGeneralProcessActive(false);
+
+  auto biasingPhysics = new G4GenericBiasingPhysics();
+  biasingPhysics->PhysicsBias("gamma", {"phot"});
+  biasingPhysics->NonPhysicsBias("gamma");
+  physicsList->RegisterPhysics(biasingPhysics);
+  physicsRegistered_ = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SkinBiasingOperator::SetSkinFactor(G4double factor)
+{
+  sharedSkinFactor_ = factor;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SkinBiasingOperator::StartRun()
+{
+  skinDepth_ = sharedSkinDepth_;
+  skinFactor_ = sharedSkinFactor_;
+  depthTrack_ = nullptr;
+
+  // one cross-section change per wrapped photoelectric process of this thread
+  if (operations_.empty()) {
+    const G4ProcessManager* processManager = G4Gamma::Gamma()->GetProcessManager();
+    const G4BiasingProcessSharedData* sharedData =
+      G4BiasingProcessInterface::GetSharedData(processManager);
+    if (sharedData) {
+      for (const auto wrapper : sharedData->GetPhysicsBiasingProcessInterfaces()) {
+        operations_[wrapper] =
+          new G4BOptnChangeCrossSection("SkinXS-" + wrapper->GetWrappedProcess()->GetProcessName());
+      }
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SkinBiasingOperator::Depth(const G4Track* track)
+{
+  // the occurrence and the non-physics wrappers both ask in the same step
+  if (track == depthTrack_ && track->GetPosition() == depthPosition_) return depth_;
+
+  const G4VTouchable* touchable = track->GetTouchable();
+  const G4ThreeVector local =
+    touchable->GetHistory()->GetTopTransform().TransformPoint(track->GetPosition());
+
+  depthTrack_ = track;
+  depthPosition_ = track->GetPosition();
+  depth_ = touchable->GetSolid()->DistanceToOut(local);
+  return depth_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VBiasingOperation* SkinBiasingOperator::ProposeOccurenceBiasingOperation(
+    const G4Track* track, const G4BiasingProcessInterface* callingProcess)
+{
+  if (skinDepth_ <= 0. || skinFactor_ == 1.) return nullptr;
+  if (Depth(track) >= skinDepth_) return nullptr;  // analog in the bulk
+
+  auto it = operations_.find(callingProcess);
+  if (it == operations_.end()) return nullptr;
+
+  // no analog cross section (e.g. below the tabulated range): nothing to boost
+  const G4double analogLength =
+    callingProcess->GetWrappedProcess()->GetCurrentInteractionLength();
+  if (analogLength <= 0. || analogLength > DBL_MAX / 10.) return nullptr;
+  const G4double biasedXS = skinFactor_ / analogLength;
+
+  // as in G4BOptrChangeCrossSection: a new interaction length is sampled
+  // unless the previous step was biased by the same operation and the
+  // interaction did not occur, in which case the sampled length is updated
+  G4BOptnChangeCrossSection* operation = it->second;
+  G4VBiasingOperation* previous = callingProcess->GetPreviousOccurenceBiasingOperation();
+  if (previous != operation || operation->GetInteractionOccured()) {
+    operation->SetBiasedCrossSection(biasedXS);
+    operation->Sample();
+  } else {
+    operation->UpdateForStep(callingProcess->GetPreviousStepSize());
+    operation->SetBiasedCrossSection(biasedXS);
+    operation->UpdateForStep(0.);
+  }
+  return operation;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VBiasingOperation* SkinBiasingOperator::ProposeNonPhysicsBiasingOperation(
+    const G4Track* track, const G4BiasingProcessInterface*)
+{
+  if (skinDepth_ <= 0. || skinFactor_ == 1.) return nullptr;
+
+  // end the step where the photon crosses the skin boundary along the
+  // shortest path; a quarter of the skin at least, so steps do not shrink
+  // towards the boundary
+  const G4double depth = Depth(track);
+  stepLimit_->SetDistance(std::max(std::abs(depth - skinDepth_), 0.25 * skinDepth_));
+  return stepLimit_.get();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,147 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SourceShadowMask.cc
+/// \brief Implementation of the SourceShadowMask class
+//
+
+#include "SourceShadowMask.hh"
+
+#include "G4GeometryTolerance.hh"
+#include "G4VSolid.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // a ray nearly parallel to the xy plane wraps around the periodic world
+  // many times; beyond this it is taken as missing the grains
+  const G4int kMaxWraps = 1000;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourceShadowMask::Build(const G4VSolid& grains, const G4ThreeVector& centre, G4double halfX, G4double halfY,
+                             const G4ThreeVector& direction, const G4ThreeVector& worldHalf, G4bool periodic,
+                             G4int maxCells)
+{
+  halfX_ = halfX;
+  halfY_ = halfY;
+
+  const G4double longer = std::max(halfX, halfY);
+  cellsX_ = longer > 0. ? std::max(1, static_cast<G4int>(std::lround(maxCells*halfX/longer))) : 1;
+  const G4int cellsY = longer > 0. ? std::max(1, static_cast<G4int>(std::lround(maxCells*halfY/longer))) : 1;
+  cellX_ = 2.*halfX/cellsX_;
+  cellY_ = 2.*halfY/cellsY;
+
+  // rays on a lattice of half cells: the corners and edge midpoints of a
+  // cell are shared with its neighbours
+  const G4int pointsX = 2*cellsX_ + 1;
+  const G4int pointsY = 2*cellsY + 1;
+  std::vector<char> rayHit(pointsX*pointsY, 0);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (G4int j = 0; j < pointsY; ++j) {
+    for (G4int i = 0; i < pointsX; ++i) {
+      const G4ThreeVector start = centre + G4ThreeVector(-halfX + 0.5*i*cellX_, -halfY + 0.5*j*cellY_, 0.);
+      rayHit[j*pointsX + i] = RayHits(grains, start, direction, worldHalf, periodic);
+    }
+  }
+
+  std::vector<char> hit(cellsX_*cellsY, 0);
+  for (G4int iy = 0; iy < cellsY; ++iy) {
+    for (G4int ix = 0; ix < cellsX_; ++ix) {
+      for (G4int j = 2*iy; j <= 2*iy + 2 && !hit[iy*cellsX_ + ix]; ++j) {
+        for (G4int i = 2*ix; i <= 2*ix + 2; ++i) {
+          if (rayHit[j*pointsX + i]) { hit[iy*cellsX_ + ix] = 1; break; }
+        }
+      }
+    }
+  }
+
+  // grow by one cell, for grain edges between the rays
+  cells_.clear();
+  for (G4int iy = 0; iy < cellsY; ++iy) {
+    for (G4int ix = 0; ix < cellsX_; ++ix) {
+      G4bool near = false;
+      for (G4int jy = std::max(iy - 1, 0); jy <= std::min(iy + 1, cellsY - 1) && !near; ++jy) {
+        for (G4int jx = std::max(ix - 1, 0); jx <= std::min(ix + 1, cellsX_ - 1); ++jx) {
+          if (hit[jy*cellsX_ + jx]) { near = true; break; }
+        }
+      }
+      if (near) cells_.push_back(iy*cellsX_ + ix);
+    }
+  }
+
+  acceptance_ = static_cast<G4double>(cells_.size())/(cellsX_*cellsY);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ThreeVector SourceShadowMask::Sample(G4double u1, G4double u2, G4double u3) const
+{
+  const std::size_t n = cells_.size();
+  const G4int cell = cells_[std::min(static_cast<std::size_t>(u1*n), n - 1)];
+
+  return G4ThreeVector(-halfX_ + (cell % cellsX_ + u2)*cellX_, -halfY_ + (cell / cellsX_ + u3)*cellY_, 0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SourceShadowMask::RayHits(const G4VSolid& grains, G4ThreeVector position, const G4ThreeVector& direction,
+                                 const G4ThreeVector& worldHalf, G4bool periodic)
+{
+  // a primary outside the world is not tracked
+  const G4double tolerance = G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+  for (G4int axis = 0; axis < 3; ++axis) {
+    if (std::abs(position[axis]) > worldHalf[axis] + tolerance) return false;
+  }
+
+  for (G4int wrap = 0; wrap <= kMaxWraps; ++wrap) {
+    // distance to the face of the world box the ray leaves through
+    G4double exit = kInfinity;
+    G4int face = -1;
+    for (G4int axis = 0; axis < 3; ++axis) {
+      if (direction[axis] == 0.) continue;
+      const G4double wall = direction[axis] > 0. ? worldHalf[axis] : -worldHalf[axis];
+      const G4double distance = std::max((wall - position[axis])/direction[axis], 0.);
+      if (distance < exit) {
+        exit = distance;
+        face = axis;
+      }
+    }
+
+    if (grains.DistanceToIn(position, direction) < exit) return true;
+    if (!periodic || face < 0 || face == 2) return false;
+
+    // re-enter at the opposite face, as the periodic boundary process does
+    position += exit*direction;
+    position[face] = -position[face];
+  }
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
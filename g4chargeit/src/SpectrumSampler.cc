@@ -0,0 +1,251 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SpectrumSampler.cc
+/// \brief Implementation of the SpectrumSampler class
+//
+
+#include "SpectrumSampler.hh"
+
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SpectrumSampler::Load(const G4String& fileName, Interpolation interpolation)
+{
+  interpolation_ = interpolation;
+  pointEnergy_.clear();
+  pointWeight_.clear();
+
+  std::ifstream in(fileName);
+  if (!in.is_open()) {
+    G4Exception("SpectrumSampler::Load", "SpectrumFile", JustWarning,
+                ("Cannot open spectrum file " + fileName).c_str());
+    return false;
+  }
+
+  std::string line;
+  G4int skipped = 0;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    G4double energy, weight;
+    if (!(fields >> energy >> weight)) continue;  // blank or comment line
+    // GPS needs increasing energies as well; a negative weight is no density
+    if ((!pointEnergy_.empty() && energy*MeV <= pointEnergy_.back()) || weight < 0.) {
+      skipped++;
+      continue;
+    }
+    pointEnergy_.push_back(energy*MeV);
+    pointWeight_.push_back(weight);
+  }
+  if (skipped > 0) {
+    G4Exception("SpectrumSampler::Load", "SpectrumPoints", JustWarning,
+                (fileName + ": skipped " + std::to_string(skipped)
+                 + " points with a non-increasing energy or a negative weight").c_str());
+  }
+
+  if (!Tabulate()) {
+    G4Exception("SpectrumSampler::Load", "SpectrumEmpty", JustWarning,
+                (fileName + " holds no spectrum with a positive integral").c_str());
+    return false;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SpectrumSampler::SetBias(G4double minEnergy, G4double tailEnergy, G4double tailFactor)
+{
+  minEnergy_ = minEnergy;
+  tailEnergy_ = tailEnergy;
+  tailFactor_ = tailFactor;
+
+  return Tabulate();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SpectrumSampler::BiasFactor(G4double energy) const
+{
+  if (energy < minEnergy_) return 0.;
+  return energy < tailEnergy_ ? 1. : tailFactor_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SpectrumSampler::Tabulate()
+{
+  energy_.clear();
+  weight_.clear();
+  exponent_.clear();
+  segmentWeight_.clear();
+  probability_.clear();
+  alias_.clear();
+
+  // the file points plus the bias edges inside the spectrum, interpolated
+  // as the spectrum is, so that the bias factor is constant on a segment
+  const G4double edges[2] = { std::min(minEnergy_, tailEnergy_), std::max(minEnergy_, tailEnergy_) };
+  for (std::size_t i = 0; i < pointEnergy_.size(); ++i) {
+    energy_.push_back(pointEnergy_[i]);
+    weight_.push_back(pointWeight_[i]);
+    if (i + 1 == pointEnergy_.size()) break;
+
+    const G4double a = pointEnergy_[i], b = pointEnergy_[i+1];
+    const G4double fa = pointWeight_[i], fb = pointWeight_[i+1];
+    for (G4double edge : edges) {
+      if (edge <= a || edge >= b || edge == energy_.back()) continue;
+      energy_.push_back(edge);
+      weight_.push_back(interpolation_ == kPowerLaw && fa > 0. && fb > 0.
+          ? fa*std::pow(edge/a, std::log(fb/fa)/std::log(b/a)) : fa + (fb - fa)*(edge - a)/(b - a));
+    }
+  }
+
+  std::vector<G4double> biased;
+  G4double total = 0., biasedTotal = 0.;
+  for (std::size_t i = 0; i + 1 < energy_.size(); ++i) {
+    exponent_.push_back(weight_[i] > 0. && weight_[i+1] > 0.
+        ? std::log(weight_[i+1]/weight_[i])/std::log(energy_[i+1]/energy_[i]) : 0.);
+    const G4double integral = SegmentIntegral(i);
+    total += integral;
+    biased.push_back(integral*BiasFactor(0.5*(energy_[i] + energy_[i+1])));
+    biasedTotal += biased.back();
+  }
+  if (!(biasedTotal > 0.)) {
+    energy_.clear();
+    weight_.clear();
+    exponent_.clear();
+    return false;
+  }
+
+  // weight of a sampled energy: true over biased density, both normalized
+  for (std::size_t i = 0; i < biased.size(); ++i) {
+    const G4double factor = BiasFactor(0.5*(energy_[i] + energy_[i+1]));
+    segmentWeight_.push_back(factor > 0. ? biasedTotal/total/factor : 0.);
+  }
+
+  BuildAliasTable(biased);
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SpectrumSampler::Sample(G4double u1, G4double u2, G4double* weight) const
+{
+  // column and acceptance from the same number (Walker)
+  const G4double column = u1*probability_.size();
+  std::size_t segment = std::min(static_cast<std::size_t>(column), probability_.size() - 1);
+  if (column - segment >= probability_[segment]) segment = alias_[segment];
+
+  if (weight) *weight = segmentWeight_[segment];
+
+  return SampleSegment(segment, u2);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SpectrumSampler::IsPowerLaw(std::size_t segment) const
+{
+  return interpolation_ == kPowerLaw && weight_[segment] > 0. && weight_[segment+1] > 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SpectrumSampler::SegmentIntegral(std::size_t segment) const
+{
+  const G4double a = energy_[segment], b = energy_[segment+1];
+  const G4double fa = weight_[segment], fb = weight_[segment+1];
+
+  if (!IsPowerLaw(segment)) return 0.5*(fa + fb)*(b - a);
+
+  const G4double k1 = exponent_[segment] + 1.;
+  if (std::abs(k1) < 1e-9) return fa*a*std::log(b/a);
+  return fa*a/k1*(std::pow(b/a, k1) - 1.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SpectrumSampler::SampleSegment(std::size_t segment, G4double u) const
+{
+  const G4double a = energy_[segment], b = energy_[segment+1];
+  const G4double fa = weight_[segment], fb = weight_[segment+1];
+
+  if (IsPowerLaw(segment)) {
+    // weight fa*(E/a)^k: invert its integral from a
+    const G4double k1 = exponent_[segment] + 1.;
+    if (std::abs(k1) < 1e-9) return a*std::pow(b/a, u);
+    return a*std::pow(1. + u*(std::pow(b/a, k1) - 1.), 1./k1);
+  }
+
+  // linear weight: the root of the quadratic cumulative, in the form that
+  // neither cancels for a flat segment nor divides by zero when fa = 0
+  const G4double area = u*0.5*(fa + fb)*(b - a);
+  if (area <= 0.) return a;
+  const G4double slope = (fb - fa)/(b - a);
+  const G4double root = std::sqrt(std::max(0., fa*fa + 2.*slope*area));
+  return std::min(b, a + 2.*area/(fa + root));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SpectrumSampler::BuildAliasTable(const std::vector<G4double>& weights)
+{
+  // Vose's construction: every column holds its own segment with
+  // probability_[i] and alias_[i] otherwise
+  const std::size_t n = weights.size();
+  G4double total = 0.;
+  for (G4double w : weights) total += w;
+
+  probability_.assign(n, 1.);
+  alias_.resize(n);
+  std::vector<G4double> scaled(n);
+  std::vector<std::size_t> small, large;
+  for (std::size_t i = 0; i < n; ++i) {
+    alias_[i] = i;
+    scaled[i] = weights[i]*n/total;
+    (scaled[i] < 1. ? small : large).push_back(i);
+  }
+
+  while (!small.empty() && !large.empty()) {
+    const std::size_t s = small.back(), l = large.back();
+    small.pop_back();
+    probability_[s] = scaled[s];
+    alias_[s] = l;
+    scaled[l] -= 1. - scaled[s];
+    if (scaled[l] < 1.) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // what is left is 1 up to rounding
+  for (std::size_t i : small) probability_[i] = 1.;
+  for (std::size_t i : large) probability_[i] = 1.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,350 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SurrogateEmissionModel.cc
+/// \brief Implementation of the SurrogateEmissionModel class
+//
+
+#include "SurrogateEmissionModel.hh"
+#include "SensitiveDetectorHit.hh"
+#include "GeometryUtilities.hh"
+
+#include "G4DynamicParticle.hh"
+#include "G4Electron.hh"
+#include "G4Exception.hh"
+#include "G4FastSimulationPhysics.hh"
+#include "G4FastStep.hh"
+#include "G4FastTrack.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4VSolid.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+
+SurrogateEmissionModel::Mode SurrogateEmissionModel::mode_ = SurrogateEmissionModel::kOff;
+G4String SurrogateEmissionModel::tableFile_ = "surrogate-emission.txt";
+G4bool SurrogateEmissionModel::physicsRegistered_ = false;
+const G4VSolid* SurrogateEmissionModel::grains_ = nullptr;
+SurrogateEmissionTable SurrogateEmissionModel::table_;
+G4String SurrogateEmissionModel::loadedFile_;
+SurrogateEmissionTable SurrogateEmissionModel::calibration_;
+std::mutex SurrogateEmissionModel::mutex_;
+
+namespace
+{
+  const char* kRegionName = "Grains";
+
+  // distance beyond the far surface at which photons continue, so they are
+  // located in the vacuum and not on the boundary
+  const G4double kSurfaceOffset = 1.*nm;
+
+  // depth below the surface at which the electrons start: their first step,
+  // which gives the hole, begins in the grain, and what is left to cross is
+  // far below the calibrated escape paths
+  const G4double kEmissionDepth = 0.01*nm;
+
+  // point on the surface of a grain nearest to a point inside it, and the
+  // outward normal there
+  G4ThreeVector NearestSurface(const G4VSolid& grain, const G4ThreeVector& point,
+                               G4ThreeVector& normal)
+  {
+    G4ThreeVector outward;
+    G4double distance = 0.;
+    if (!GeometryUtilities::NearestSurface(grain, point, kSurfaceOffset, outward, distance)) {
+      // on the surface or no descent: straight out along the normal
+      outward = grain.SurfaceNormal(point);
+      distance = grain.DistanceToOut(point, outward);
+      if (distance == kInfinity) distance = 0.;
+    }
+    const G4ThreeVector surface = point + distance*outward;
+    normal = grain.SurfaceNormal(surface);
+    return surface;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SurrogateEmissionModel::SurrogateEmissionModel(G4Region* region)
+ : G4VFastSimulationModel("SurrogateEmission", region)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::SetMode(const G4String& mode)
+{
+  const Mode previous = mode_;
+  if (mode == "off") {
+    mode_ = kOff;
+  } else if (mode == "calibrate") {
+    mode_ = kCalibrate;
+  } else if (mode == "fast") {
+    mode_ = kFast;
+  } else {
+    G4ExceptionDescription msg;
+    msg << "Unknown surrogate mode " << mode << ", the mode is unchanged.";
+    G4Exception("SurrogateEmissionModel::SetMode", "Surrogate001", JustWarning, msg);
+    return;
+  }
+
+  // a new calibration starts from empty tallies
+  if (mode_ == kCalibrate && previous != kCalibrate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    calibration_.Clear();
+  }
+  if (mode_ == kOff || physicsRegistered_) return;
+
+  // the fast simulation process of the photons has to exist before the
+  // physics is built; the calibration does without it
+  auto physicsList = dynamic_cast<G4VModularPhysicsList*>(
+    const_cast<G4VUserPhysicsList*>(G4RunManager::GetRunManager()->GetUserPhysicsList()));
+  if (G4StateManager::GetStateManager()->GetCurrentState() == G4State_PreInit && physicsList) {
+    auto fastSimulationPhysics = new G4FastSimulationPhysics();
+    fastSimulationPhysics->ActivateFastSimulation("gamma");
+    physicsList->RegisterPhysics(fastSimulationPhysics);
+    physicsRegistered_ = true;
+  } else if (mode_ == kFast) {
+    G4ExceptionDescription msg;
+    msg << "/surrogate/mode has to be given before /run/initialize for the fast mode;"
+        << " the grains stay with the full physics.";
+    G4Exception("SurrogateEmissionModel::SetMode", "Surrogate002", JustWarning, msg);
+    mode_ = previous;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4Region* SurrogateEmissionModel::GetRegion()
+{
+  G4Region* region = G4RegionStore::GetInstance()->GetRegion(kRegionName, false);
+  if (!region) {
+    region = new G4Region(kRegionName);
+    // the cuts of the world, which follow /run/setCut
+    region->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+  }
+  return region;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::ReleaseEnvelopes()
+{
+  G4Region* region = G4RegionStore::GetInstance()->GetRegion(kRegionName, false);
+  if (!region) return;
+
+  // the region outlives the volumes, which are still alive here
+  auto first = region->GetRootLogicalVolumeIterator();
+  const std::vector<G4LogicalVolume*> volumes(first, first + region->GetNumberOfRootVolumes());
+  for (auto volume : volumes) region->RemoveRootLogicalVolume(volume, false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::AddEnvelope(G4LogicalVolume* volume)
+{
+  GetRegion()->AddRootLogicalVolume(volume);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::BeginRun()
+{
+  if (mode_ == kCalibrate) {
+    G4cout << "Calibrating the surrogate emission table " << tableFile_ << G4endl;
+    return;
+  }
+  if (mode_ != kFast) return;
+
+  // unchanged since the last run
+  if (loadedFile_ != tableFile_) {
+    if (!table_.Read(tableFile_)) {
+      G4ExceptionDescription msg;
+      msg << "Cannot read the surrogate emission table " << tableFile_
+          << ": missing or not a table of this binning.";
+      G4Exception("SurrogateEmissionModel::BeginRun", "Surrogate003", FatalException, msg);
+      return;
+    }
+    loadedFile_ = tableFile_;
+  }
+  G4cout << "Surrogate emission in the grains from " << tableFile_ << " ("
+         << table_.GetAbsorptions() << " absorbed photons, " << table_.GetElectrons()
+         << " escaped electrons)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::EndRun()
+{
+  if (mode_ != kCalibrate) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!calibration_.Write(tableFile_)) {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the surrogate emission table " << tableFile_ << ".";
+    G4Exception("SurrogateEmissionModel::EndRun", "Surrogate004", JustWarning, msg);
+    return;
+  }
+  loadedFile_.clear();
+  G4cout << "Surrogate emission table: " << calibration_.GetAbsorptions() << " absorbed photons, "
+         << calibration_.GetElectrons() << " escaped electrons written to " << tableFile_ << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::Calibrate(const std::vector<SensitiveDetectorHit*>& hits)
+{
+  if (mode_ != kCalibrate || !grains_) return;
+
+  const G4String target_volume = "SiO2";
+
+  // photon paths and absorptions (energy, length / depth), and the
+  // electrons (energy, cosine) that left a grain they were created in
+  std::vector<std::pair<G4double, G4double>> paths, electrons;
+  std::vector<G4double> absorptions;
+  G4int primaryAbsorptions = 0;
+  G4double primaryEnergy = 0., primaryDepth = 0.;
+  G4bool grainElectron = false;
+
+  // the hits of a track follow each other, starting with its first step
+  for (auto hit : hits) {
+    const G4String ptype = hit->GetParticleType();
+    const G4ThreeVector pre(hit->GetPrePositionX(), hit->GetPrePositionY(), hit->GetPrePositionZ());
+    const G4ThreeVector post(hit->GetPostPositionX(), hit->GetPostPositionY(), hit->GetPostPositionZ());
+    const G4bool preInGrain = hit->GetPreVolumeName() == target_volume;
+    const G4bool postInGrain = hit->GetPostVolumeName() == target_volume;
+
+    if (hit->GetPreProcessName() == "initStep") grainElectron = ptype == "e-" && preInGrain;
+
+    if (ptype == "gamma") {
+      if (preInGrain) paths.emplace_back(hit->GetPreKineticEnergy(), (post - pre).mag());
+      if (hit->GetPostKineticEnergy() == 0. && postInGrain) {
+        absorptions.push_back(hit->GetPreKineticEnergy());
+        if (hit->GetParentID() == 0.) {
+          primaryAbsorptions++;
+          primaryEnergy = hit->GetPreKineticEnergy();
+          primaryDepth = grains_->DistanceToOut(post);
+        }
+      }
+    } else if (grainElectron && preInGrain && !postInGrain) {
+      // first exit of the electron from the grain
+      const G4ThreeVector normal = grains_->SurfaceNormal(post);
+      electrons.emplace_back(hit->GetPostKineticEnergy(), (post - pre).unit().dot(normal));
+      grainElectron = false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& path : paths) calibration_.AddPath(path.first, path.second);
+  for (const auto energy : absorptions) calibration_.AddAbsorption(energy);
+  // the electrons of the event go to the absorption of its primary photon
+  if (primaryAbsorptions == 1) calibration_.AddEmission(primaryEnergy, primaryDepth, electrons);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SurrogateEmissionModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4Gamma::Definition();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SurrogateEmissionModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  return mode_ == kFast && table_.Covers(fastTrack.GetPrimaryTrack()->GetKineticEnergy());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track* track = fastTrack.GetPrimaryTrack();
+  const G4VSolid* grain = fastTrack.GetEnvelopeSolid();
+  const G4ThreeVector position = fastTrack.GetPrimaryTrackLocalPosition();
+  const G4ThreeVector direction = fastTrack.GetPrimaryTrackLocalDirection();
+  const G4double energy = track->GetKineticEnergy();
+
+  G4double chord = grain->DistanceToOut(position, direction);
+  if (chord == kInfinity) chord = 0.;
+  const G4double path = -std::log(G4UniformRand())/table_.Absorption(energy);
+
+  if (path >= chord) {
+    // through the grain: the photon continues beyond its far surface
+    const G4double travel = chord + kSurfaceOffset;
+    fastStep.ProposePrimaryTrackFinalPosition(position + travel*direction);
+    fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + travel/c_light);
+    fastStep.ProposePrimaryTrackPathLength(travel);
+    return;
+  }
+
+  const G4ThreeVector absorption = position + path*direction;
+  const G4double time = track->GetGlobalTime() + path/c_light;
+  fastStep.ProposePrimaryTrackFinalPosition(absorption);
+  fastStep.ProposePrimaryTrackFinalTime(time);
+  fastStep.ProposePrimaryTrackPathLength(path);
+  fastStep.KillPrimaryTrack();
+
+  // the electrons leave from the surface point nearest to the absorption,
+  // starting just inside so that the hole stays in the dielectric
+  const G4double depth = grain->DistanceToOut(absorption);
+  G4ThreeVector normal;
+  const G4ThreeVector surface = NearestSurface(*grain, absorption, normal);
+  const G4ThreeVector u = normal.orthogonal().unit();
+  const G4ThreeVector v = normal.cross(u);
+
+  const G4double yield = table_.Yield(energy, depth);
+  G4int count = static_cast<G4int>(yield);
+  if (G4UniformRand() < yield - count) count++;
+  fastStep.SetNumberOfSecondaryTracks(count);
+
+  G4double deposit = energy;
+  for (G4int i = 0; i < count; ++i) {
+    // the photon energy bounds what all electrons carry away
+    const G4double electronEnergy = std::min(table_.SampleElectronEnergy(energy), deposit);
+    if (electronEnergy <= 0.) break;
+    deposit -= electronEnergy;
+
+    const G4double cosTheta = table_.SampleCosine(energy);
+    const G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+    const G4double phi = twopi*G4UniformRand();
+    const G4ThreeVector electronDirection =
+      cosTheta*normal + sinTheta*(std::cos(phi)*u + std::sin(phi)*v);
+
+    fastStep.CreateSecondaryTrack(G4DynamicParticle(G4Electron::Definition(), electronDirection, electronEnergy),
+                                  surface - kEmissionDepth*normal, time);
+  }
+  fastStep.ProposeTotalEnergyDeposited(deposit);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,286 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file SurrogateEmissionTable.cc
+/// \brief Implementation of the SurrogateEmissionTable class
+//
+
+#include "SurrogateEmissionTable.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+namespace
+{
+  const char* kMagic = "SURROGATE1";
+
+  // lower edges of the logarithmic binnings and their bins per decade
+  const G4double kPhotonMin = 1.*eV;
+  const G4double kPhotonPerDecade = 10.;
+  const G4double kDepthMin = 0.1*nm;
+  const G4double kDepthPerDecade = 5.;
+  const G4double kElectronMin = 0.1*eV;
+  const G4double kElectronPerDecade = 10.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SurrogateEmissionTable::SurrogateEmissionTable()
+{
+  Clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionTable::Clear()
+{
+  path_.assign(kPhotonBins, 0.);
+  absorbed_.assign(kPhotonBins, 0.);
+  emitting_.assign(kPhotonBins*kDepthBins, 0.);
+  escaped_.assign(kPhotonBins*kDepthBins, 0.);
+  electrons_.assign(kPhotonBins*kElectronBins, 0.);
+  cosines_.assign(kPhotonBins*kCosineBins, 0.);
+  Accumulate();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int SurrogateEmissionTable::PhotonBin(G4double energy)
+{
+  if (energy < kPhotonMin) return -1;
+  const G4int bin = static_cast<G4int>(kPhotonPerDecade*std::log10(energy/kPhotonMin));
+  return bin < kPhotonBins ? bin : -1;
+}
+
+G4int SurrogateEmissionTable::DepthBin(G4double depth)
+{
+  if (depth < kDepthMin) return 0;
+  const G4int bin = 1 + static_cast<G4int>(kDepthPerDecade*std::log10(depth/kDepthMin));
+  return std::min(bin, kDepthBins - 1);
+}
+
+G4int SurrogateEmissionTable::ElectronBin(G4double energy)
+{
+  if (energy < kElectronMin) return 0;
+  const G4int bin = static_cast<G4int>(kElectronPerDecade*std::log10(energy/kElectronMin));
+  return std::min(bin, kElectronBins - 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionTable::AddPath(G4double energy, G4double length)
+{
+  const G4int i = PhotonBin(energy);
+  if (i >= 0) path_[i] += length/mm;
+}
+
+void SurrogateEmissionTable::AddAbsorption(G4double energy)
+{
+  const G4int i = PhotonBin(energy);
+  if (i >= 0) absorbed_[i] += 1.;
+}
+
+void SurrogateEmissionTable::AddEmission(G4double energy, G4double depth,
+    const std::vector<std::pair<G4double, G4double>>& electrons)
+{
+  const G4int i = PhotonBin(energy);
+  if (i < 0) return;
+
+  const G4int j = DepthBin(depth);
+  emitting_[i*kDepthBins + j] += 1.;
+  escaped_[i*kDepthBins + j] += electrons.size();
+  for (const auto& electron : electrons) {
+    electrons_[i*kElectronBins + ElectronBin(electron.first)] += 1.;
+    const G4int k = static_cast<G4int>(std::clamp(electron.second, 0., 1.)*kCosineBins);
+    cosines_[i*kCosineBins + std::min(k, kCosineBins - 1)] += 1.;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SurrogateEmissionTable::Write(const G4String& file) const
+{
+  std::ofstream out(file);
+  if (!out) return false;
+
+  out << "# g4chargeit surrogate emission table, one line per photon energy bin:\n"
+      << "# path (mm), absorptions, absorptions and escaped electrons by depth,\n"
+      << "# escaped electrons by energy and by cosine (see SurrogateEmissionTable.hh)\n"
+      << kMagic << " " << kPhotonBins << " " << kDepthBins << " "
+      << kElectronBins << " " << kCosineBins << "\n"
+      << std::setprecision(10);
+
+  auto row = [&out](const std::vector<G4double>& values, G4int i, G4int n) {
+    for (G4int k = 0; k < n; ++k) out << " " << values[i*n + k];
+  };
+  for (G4int i = 0; i < kPhotonBins; ++i) {
+    out << path_[i] << " " << absorbed_[i];
+    row(emitting_, i, kDepthBins);
+    row(escaped_, i, kDepthBins);
+    row(electrons_, i, kElectronBins);
+    row(cosines_, i, kCosineBins);
+    out << "\n";
+  }
+  return out.good();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SurrogateEmissionTable::Read(const G4String& file)
+{
+  std::ifstream in(file);
+  std::string line;
+  while (std::getline(in, line) && (line.empty() || line[0] == '#')) {}
+
+  // the binning is compiled in, a table of another binning cannot be used
+  std::istringstream header(line);
+  std::string magic;
+  G4int photonBins = 0, depthBins = 0, electronBins = 0, cosineBins = 0;
+  header >> magic >> photonBins >> depthBins >> electronBins >> cosineBins;
+  if (magic != kMagic || photonBins != kPhotonBins || depthBins != kDepthBins
+      || electronBins != kElectronBins || cosineBins != kCosineBins) return false;
+
+  Clear();
+  auto row = [&in](std::vector<G4double>& values, G4int i, G4int n) {
+    for (G4int k = 0; k < n; ++k) in >> values[i*n + k];
+  };
+  for (G4int i = 0; i < kPhotonBins; ++i) {
+    in >> path_[i] >> absorbed_[i];
+    row(emitting_, i, kDepthBins);
+    row(escaped_, i, kDepthBins);
+    row(electrons_, i, kElectronBins);
+    row(cosines_, i, kCosineBins);
+  }
+  if (in.fail()) {
+    Clear();
+    return false;
+  }
+
+  Accumulate();
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SurrogateEmissionTable::Accumulate()
+{
+  electronSums_.resize(electrons_.size());
+  cosineSums_.resize(cosines_.size());
+  covered_.assign(kPhotonBins, 0);
+
+  for (G4int i = 0; i < kPhotonBins; ++i) {
+    std::partial_sum(electrons_.begin() + i*kElectronBins, electrons_.begin() + (i + 1)*kElectronBins,
+                     electronSums_.begin() + i*kElectronBins);
+    std::partial_sum(cosines_.begin() + i*kCosineBins, cosines_.begin() + (i + 1)*kCosineBins,
+                     cosineSums_.begin() + i*kCosineBins);
+
+    const G4double emitting = std::accumulate(emitting_.begin() + i*kDepthBins,
+                                              emitting_.begin() + (i + 1)*kDepthBins, 0.);
+    covered_[i] = path_[i] > 0. && absorbed_[i] > 0. && emitting > 0.;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool SurrogateEmissionTable::Covers(G4double energy) const
+{
+  const G4int i = PhotonBin(energy);
+  return i >= 0 && covered_[i];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SurrogateEmissionTable::Absorption(G4double energy) const
+{
+  const G4int i = PhotonBin(energy);
+  return absorbed_[i]/(path_[i]*mm);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SurrogateEmissionTable::Yield(G4double energy, G4double depth) const
+{
+  const G4int i = PhotonBin(energy);
+  const G4int j = DepthBin(depth);
+
+  // depths without absorptions in the calibration take the nearest with
+  for (G4int offset = 0; offset < kDepthBins; ++offset) {
+    for (const G4int k : {j - offset, j + offset}) {
+      if (k < 0 || k >= kDepthBins || emitting_[i*kDepthBins + k] == 0.) continue;
+      return escaped_[i*kDepthBins + k]/emitting_[i*kDepthBins + k];
+    }
+  }
+  return 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int SurrogateEmissionTable::Sample(const G4double* cumulative, G4int bins)
+{
+  const G4double u = G4UniformRand()*cumulative[bins - 1];
+  return static_cast<G4int>(std::upper_bound(cumulative, cumulative + bins - 1, u) - cumulative);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SurrogateEmissionTable::SampleElectronEnergy(G4double energy) const
+{
+  const G4int i = PhotonBin(energy);
+  const G4int k = Sample(&electronSums_[i*kElectronBins], kElectronBins);
+
+  // log-uniform within the bin, never above the photon energy
+  const G4double sampled = kElectronMin*std::pow(10., (k + G4UniformRand())/kElectronPerDecade);
+  return std::min(sampled, energy);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SurrogateEmissionTable::SampleCosine(G4double energy) const
+{
+  const G4int i = PhotonBin(energy);
+  const G4int k = Sample(&cosineSums_[i*kCosineBins], kCosineBins);
+  return (k + G4UniformRand())/kCosineBins;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double SurrogateEmissionTable::GetAbsorptions() const
+{
+  return std::accumulate(emitting_.begin(), emitting_.end(), 0.);
+}
+
+G4double SurrogateEmissionTable::GetElectrons() const
+{
+  return std::accumulate(escaped_.begin(), escaped_.end(), 0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
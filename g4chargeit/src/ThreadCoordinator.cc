@@ -0,0 +1,190 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file ThreadCoordinator.cc
+/// \brief Implementation of the ThreadCoordinator class
+//
+
+#include "ThreadCoordinator.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+#include <sys/resource.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ThreadCoordinator* ThreadCoordinator::singletonInstance_ = nullptr;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ThreadCoordinator::ThreadCoordinator()
+ : cores_(1), workerThreads_(1), current_(-1), startWall_(0.), startCPU_(0.)
+{
+#ifdef _OPENMP
+  cores_ = omp_get_max_threads();
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ThreadCoordinator* ThreadCoordinator::GetInstance()
+{
+  if (not singletonInstance_) { singletonInstance_ = new ThreadCoordinator; }
+
+  return singletonInstance_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::SetCores(G4int cores, G4int workerThreads)
+{
+  workerThreads_ = std::max(1, workerThreads);
+  cores_ = std::max({1, cores, workerThreads_});
+
+  G4cout << "Thread coordination: " << cores_ << " cores, OpenMP precomputation on "
+         << cores_ << " threads, tracking on " << workerThreads_ << " thread(s)" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::BeginPrecompute()
+{
+#ifdef _OPENMP
+  omp_set_num_threads(cores_);
+#endif
+  BeginPhase("Field map precomputation", cores_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::BeginTracking()
+{
+#ifdef _OPENMP
+  // no OpenMP team next to the workers; idle OpenMP threads should not spin
+  // either, which needs OMP_WAIT_POLICY=passive in the job environment
+  omp_set_num_threads(1);
+#endif
+  BeginPhase("Event processing", workerThreads_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::BeginPhase(const G4String& name, G4int threads)
+{
+  if (current_ >= 0) EndPhase();
+
+  auto phase = std::find_if(phases_.begin(), phases_.end(),
+                            [&name](const Phase& p) { return p.name == name; });
+  if (phase == phases_.end()) {
+    phases_.push_back(Phase());
+    phases_.back().name = name;
+    phase = phases_.end() - 1;
+  }
+  phase->threads = threads;
+
+  current_ = static_cast<G4int>(phase - phases_.begin());
+  startWall_ = WallTime();
+  startCPU_ = ProcessCPUTime();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::EndPhase()
+{
+  if (current_ < 0) return;
+
+  Phase& phase = phases_[current_];
+  const G4double wall = WallTime() - startWall_;
+  const G4double cpu = ProcessCPUTime() - startCPU_;
+  phase.wall += wall;
+  phase.cpu += cpu;
+  phase.calls++;
+  current_ = -1;
+
+  G4cout << phase.name << ": " << wall << " s wall, " << cpu << " s CPU, "
+         << std::fixed << std::setprecision(1)
+         << (wall > 0. ? 100.*cpu/(wall*cores_) : 0.) << "% of " << cores_ << " cores"
+         << std::defaultfloat << std::setprecision(6) << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ThreadCoordinator::PrintReport() const
+{
+  if (phases_.empty()) return;
+
+  G4cout << "\n=== Core Utilization (" << cores_ << " cores) ===" << G4endl;
+  G4cout << std::left << std::setw(28) << "Phase" << std::right
+         << std::setw(7) << "Calls" << std::setw(9) << "Threads"
+         << std::setw(12) << "Wall [s]" << std::setw(12) << "CPU [s]"
+         << std::setw(10) << "Busy [%]" << G4endl;
+
+  G4double totalWall = 0., totalCPU = 0.;
+  for (const auto& phase : phases_) {
+    // busy: CPU time over the wall time of all reserved cores
+    const G4double busy = phase.wall > 0. ? 100.*phase.cpu/(phase.wall*cores_) : 0.;
+    G4cout << std::left << std::setw(28) << phase.name << std::right
+           << std::setw(7) << phase.calls << std::setw(9) << phase.threads
+           << std::fixed << std::setprecision(2)
+           << std::setw(12) << phase.wall << std::setw(12) << phase.cpu
+           << std::setprecision(1) << std::setw(10) << busy
+           << std::defaultfloat << std::setprecision(6) << G4endl;
+    totalWall += phase.wall;
+    totalCPU += phase.cpu;
+  }
+
+  G4cout << std::fixed << std::setprecision(1)
+         << "Overall: " << (totalWall > 0. ? 100.*totalCPU/(totalWall*cores_) : 0.)
+         << "% of the reserved cores busy"
+         << std::defaultfloat << std::setprecision(6) << G4endl;
+  G4cout << "=================================\n" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ThreadCoordinator::ProcessCPUTime()
+{
+  // user + system time of every thread of the process
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+       + 1e-6*(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ThreadCoordinator::WallTime()
+{
+  return std::chrono::duration<G4double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,123 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrackFieldManager.cc
+/// \brief Implementation of the TrackFieldManager class
+//
+
+#include "TrackFieldManager.hh"
+#include "AdaptiveSumRadialFieldMap.hh"
+
+#include "G4Track.hh"
+#include "G4PhysicalConstants.hh"
+
+#include <cmath>
+
+G4ThreadLocal G4long TrackFieldManager::fieldSteps_ = 0;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackFieldManager::ConfigureForTrack(const G4Track* track)
+{
+  if (!fieldMap_) return;
+
+  const G4double charge = track->GetDynamicParticle()->GetCharge();
+  const G4double drop = std::abs(charge)*eplus*potentialRange_;
+  const G4double energy = track->GetKineticEnergy();
+
+  Mode mode = kTight;
+  if (bypassRatio_ > 0. && energy > bypassRatio_*drop) {
+    mode = kBypass;
+  } else if (relaxRatio_ > 0. && energy > relaxRatio_*drop) {
+    mode = kRelaxed;
+  }
+  if (mode != mode_) Apply(mode);
+  if (mode != kBypass && charge != 0.) fieldSteps_++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4long TrackFieldManager::TakeFieldStepCount()
+{
+  const G4long steps = fieldSteps_;
+  fieldSteps_ = 0;
+  return steps;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackFieldManager::SetFieldMap(AdaptiveSumRadialFieldMap* fieldMap)
+{
+  fieldMap_ = fieldMap;
+  potentialRange_ = fieldMap ? fieldMap->GetPotentialRange() : 0.;
+  SetDetectorField(fieldMap);
+  mode_ = kTight;
+  Apply(kTight);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackFieldManager::SetAccuracy(G4double deltaOneStep, G4double minEpsilon,
+                                    G4double maxEpsilon)
+{
+  deltaOneStep_ = deltaOneStep;
+  minEpsilon_ = minEpsilon;
+  maxEpsilon_ = maxEpsilon;
+  Apply(mode_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackFieldManager::SetEnergyRatios(G4double bypassRatio, G4double relaxRatio)
+{
+  bypassRatio_ = bypassRatio;
+  relaxRatio_ = relaxRatio;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackFieldManager::Apply(Mode mode)
+{
+  // detaching the field makes G4Transportation use straight-line steps
+  if ((mode == kBypass) != (mode_ == kBypass)) {
+    SetDetectorField(mode == kBypass ? nullptr : fieldMap_);
+  }
+  mode_ = mode;
+  if (mode == kBypass) return;
+
+  const G4double factor = (mode == kRelaxed) ? kRelaxFactor : 1.;
+  const G4double minEpsilon = factor*minEpsilon_, maxEpsilon = factor*maxEpsilon_;
+  // keep the minimum below the maximum in between the two calls
+  if (maxEpsilon >= GetMaximumEpsilonStep()) {
+    SetMaximumEpsilonStep(maxEpsilon);
+    SetMinimumEpsilonStep(minEpsilon);
+  } else {
+    SetMinimumEpsilonStep(minEpsilon);
+    SetMaximumEpsilonStep(maxEpsilon);
+  }
+  SetDeltaOneStep(factor*deltaOneStep_);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
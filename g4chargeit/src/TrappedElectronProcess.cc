@@ -0,0 +1,161 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrappedElectronProcess.cc
+/// \brief Implementation of the TrappedElectronProcess and
+///        TrappedElectronPhysics classes
+//
+
+#include "TrappedElectronProcess.hh"
+
+#include "G4Electron.hh"
+#include "G4Exception.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LossTableManager.hh"
+#include "G4NavigationHistory.hh"
+#include "G4ProcessManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4VTouchable.hh"
+
+#include <atomic>
+
+G4bool TrappedElectronProcess::enabled_ = false;
+G4double TrappedElectronProcess::maxEnergy_ = 1.*keV;
+
+namespace
+{
+  // CSDA range over the mean path length of the electrons (range straggling)
+  const G4double kRangeMargin = 1.1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrappedElectronProcess::TrappedElectronProcess(const G4String& processName)
+ : G4VProcess(processName, fGeneral),
+   lastValid_(false), lastDistance_(0.)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool TrappedElectronProcess::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4Electron::Electron();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrappedElectronProcess::StartTracking(G4Track* track)
+{
+  G4VProcess::StartTracking(track);
+  lastValid_ = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double TrappedElectronProcess::PostStepGetPhysicalInteractionLength(
+    const G4Track& track, G4double, G4ForceCondition* condition)
+{
+  *condition = NotForced;
+
+  // a zero step ends the track at its current position
+  return (enabled_ && IsTrapped(track)) ? 0. : DBL_MAX;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool TrappedElectronProcess::IsTrapped(const G4Track& track)
+{
+  const G4double energy = track.GetKineticEnergy();
+  if (energy <= 0. || energy > maxEnergy_) return false;
+
+  // only in the grains: volumes of another material than the world
+  const G4VTouchable* touchable = track.GetTouchable();
+  const G4VPhysicalVolume* volume = touchable->GetVolume();
+  const G4VPhysicalVolume* world = touchable->GetVolume(touchable->GetHistoryDepth());
+  if (!volume || volume->GetLogicalVolume()->GetMaterial()
+                 == world->GetLogicalVolume()->GetMaterial()) return false;
+
+  const G4double range = G4LossTableManager::Instance()->GetCSDARange(
+      track.GetDefinition(), energy, track.GetMaterialCutsCouple());
+  if (range == DBL_MAX) {
+    static std::atomic<G4bool> warned(false);
+    if (!warned.exchange(true)) {
+      G4ExceptionDescription msg;
+      msg << "No CSDA range tables; /charging/trapElectrons needs /process/eLoss/CSDARange 1."
+          << " Electrons are tracked to the end.";
+      G4Exception("TrappedElectronProcess::IsTrapped", "TrappedElectron001", JustWarning, msg);
+    }
+    return false;
+  }
+  const G4double reach = kRangeMargin * range;
+
+  // the distance to the surface changes by at most the displacement since
+  // it was last computed, which often decides without a new evaluation
+  const G4ThreeVector& position = track.GetPosition();
+  if (lastValid_) {
+    const G4double moved = (position - lastPosition_).mag();
+    if (reach < lastDistance_ - moved) return true;
+    if (reach >= lastDistance_ + moved) return false;
+  }
+
+  const G4ThreeVector local =
+    touchable->GetHistory()->GetTopTransform().TransformPoint(position);
+  lastValid_ = true;
+  lastPosition_ = position;
+  lastDistance_ = touchable->GetSolid()->DistanceToOut(local);
+
+  return reach < lastDistance_;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VParticleChange* TrappedElectronProcess::PostStepDoIt(const G4Track& track, const G4Step&)
+{
+  aParticleChange.Initialize(track);
+  aParticleChange.ProposeLocalEnergyDeposit(track.GetKineticEnergy());
+  aParticleChange.ProposeEnergy(0.);
+  aParticleChange.ProposeTrackStatus(fStopAndKill);
+  return &aParticleChange;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrappedElectronPhysics::TrappedElectronPhysics(const G4String& name)
+ : G4VPhysicsConstructor(name)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrappedElectronPhysics::ConstructProcess()
+{
+  auto* process = new TrappedElectronProcess();
+  process->SetVerboseLevel(verboseLevel);
+  G4Electron::Electron()->GetProcessManager()->AddDiscreteProcess(process);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
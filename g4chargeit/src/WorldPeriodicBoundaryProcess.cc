@@ -0,0 +1,180 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file WorldPeriodicBoundaryProcess.cc
+/// \brief Implementation of the WorldPeriodicBoundaryProcess and
+///        WorldPeriodicBoundaryPhysics classes
+//
+
+#include "WorldPeriodicBoundaryProcess.hh"
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VTouchable.hh"
+
+#include <algorithm>
+#include <cfloat>
+
+G4ThreadLocal PeriodicStatistics WorldPeriodicBoundaryProcess::statistics_;
+
+namespace
+{
+  // distance to a periodic face below which every step is forced
+  const G4double kNearFace = 1.*nm;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PeriodicStatistics& PeriodicStatistics::operator+=(const PeriodicStatistics& other)
+{
+  steps += other.steps;
+  forced += other.forced;
+  limited += other.limited;
+  return *this;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+WorldPeriodicBoundaryProcess::WorldPeriodicBoundaryProcess(const G4String& processName,
+                                                           G4bool periodicX, G4bool periodicY,
+                                                           G4bool periodicZ, G4bool reflectingWalls)
+ : G4PeriodicBoundaryProcess(processName, fNotDefined, periodicX, periodicY, periodicZ,
+                             reflectingWalls),
+   periodicX_(periodicX), periodicY_(periodicY), periodicZ_(periodicZ)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double WorldPeriodicBoundaryProcess::PostStepGetPhysicalInteractionLength(
+    const G4Track& track, G4double, G4ForceCondition* condition)
+{
+  *condition = NotForced;
+
+  const G4VPhysicalVolume* volume = track.GetVolume();
+  if (!volume) return DBL_MAX;
+
+  const G4LogicalVolume* logical = volume->GetLogicalVolume();
+  if (track.GetTouchable()->GetHistoryDepth() != 0 && !logical->IsExtended()) return DBL_MAX;
+
+  const auto* box = dynamic_cast<const G4Box*>(logical->GetSolid());
+  if (!box) {
+    *condition = Forced;
+    return DBL_MAX;
+  }
+  statistics_.steps++;
+
+  // the world box is placed at the origin
+  const G4ThreeVector& position = track.GetPosition();
+  const G4ThreeVector& direction = track.GetMomentumDirection();
+  const G4double half[3] = { box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength() };
+  const G4bool periodic[3] = { periodicX_, periodicY_, periodicZ_ };
+
+  // distance to the nearest periodic face, and along the direction to the
+  // periodic and to the other faces of the box
+  G4double distance = DBL_MAX, rayPeriodic = DBL_MAX, rayOther = DBL_MAX;
+  for (G4int axis = 0; axis < 3; ++axis) {
+    const G4double u = direction[axis];
+    const G4double ray = u > 0. ? (half[axis] - position[axis])/u
+                       : u < 0. ? (-half[axis] - position[axis])/u : DBL_MAX;
+    if (periodic[axis]) {
+      distance = std::min(distance, half[axis] - std::abs(position[axis]));
+      rayPeriodic = std::min(rayPeriodic, ray);
+    } else {
+      rayOther = std::min(rayOther, ray);
+    }
+  }
+
+  // on (or beyond) a periodic face
+  if (distance <= kNearFace) {
+    *condition = Forced;
+    statistics_.forced++;
+    return DBL_MAX;
+  }
+
+  if (track.GetDefinition()->GetPDGCharge() == 0.) {
+    // straight line: only a step leaving through a periodic face can wrap
+    if (rayPeriodic <= rayOther) {
+      *condition = Forced;
+      statistics_.forced++;
+    }
+    return DBL_MAX;
+  }
+
+  // charged: forced after a step this process limited, otherwise the step
+  // is kept short of the nearest periodic face
+  const G4bool limitedLast = track.GetStep()
+      && track.GetStep()->GetPreStepPoint()->GetProcessDefinedStep() == this;
+  if (limitedLast) {
+    statistics_.limited++;
+    *condition = Forced;
+    statistics_.forced++;
+    return DBL_MAX;
+  }
+  return distance - 0.5*kNearFace;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PeriodicStatistics WorldPeriodicBoundaryProcess::TakeStatistics()
+{
+  const PeriodicStatistics statistics = statistics_;
+  statistics_ = PeriodicStatistics();
+  return statistics;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+WorldPeriodicBoundaryPhysics::WorldPeriodicBoundaryPhysics(const G4String& name,
+                                                           G4bool periodicX, G4bool periodicY,
+                                                           G4bool periodicZ, G4bool reflectingWalls)
+ : G4VPhysicsConstructor(name),
+   periodicX_(periodicX), periodicY_(periodicY), periodicZ_(periodicZ),
+   reflectingWalls_(reflectingWalls)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorldPeriodicBoundaryPhysics::ConstructProcess()
+{
+  auto* process = new WorldPeriodicBoundaryProcess("CycBoundary", periodicX_, periodicY_,
+                                                   periodicZ_, reflectingWalls_);
+  process->SetVerboseLevel(verboseLevel);
+
+  auto particleIterator = GetParticleIterator();
+  particleIterator->reset();
+  while ((*particleIterator)()) {
+    G4ParticleDefinition* particle = particleIterator->value();
+    if (process->IsApplicable(*particle)) {
+      particle->GetProcessManager()->AddDiscreteProcess(process);
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......